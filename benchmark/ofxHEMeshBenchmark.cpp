@@ -0,0 +1,235 @@
+#include "ofxHEMesh.h"
+#include "ofxHEMeshOBJLoader.h"
+#include "ofxHEMeshParallel.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+
+/*
+Times building meshes with addFaces(), the path user code and the loaders go
+through, and compares it against the std::map based builder the edge hash
+replaced on the same faces.  Usage:
+
+	ofxHEMeshBenchmark [model.obj] [grid triangles] [repeats]
+
+The model defaults to the example's sphere.obj (also when it's "") and the
+generated grid to 10M triangles.  Each measurement is the best of the repeats.
+The baseline needs several GB and most of a minute per repeat on the default grid.
+*/
+
+#ifndef OFX_HEMESH_BENCHMARK_DATA
+#define OFX_HEMESH_BENCHMARK_DATA "hemeshExample/bin/data"
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// addFaces() as it was before the edge hash: edges are numbered through a
+// std::map of vertex pairs and boundary loops are linked through a set of the
+// unused halfedges and maps from their vertices.  Only kept as a baseline.
+class MapBuilderMesh : public ofxHEMesh {
+public:
+	void addFacesWithMaps(const vector<int>& faceOffsets, const vector<ofxHEMeshVertex>& faceVertices) {
+		std::map<ExplicitEdge, ofxHEMeshHalfedge> explicitEdgeMap;
+		std::set<ofxHEMeshHalfedge> allHalfedges;
+		int nfaces = int(faceOffsets.size())-1;
+		for(int i=0; i < nfaces; ++i) {
+			int begin = faceOffsets[i];
+			int nv = faceOffsets[i+1] - begin;
+			for(int j=0; j < nv; ++j) {
+				ExplicitEdge e = orderedEdge(faceVertices[begin+j], faceVertices[begin + (j+1)%nv]);
+				if(explicitEdgeMap.find(e) == explicitEdgeMap.end()) {
+					ofxHEMeshHalfedge h1 = addEdge();
+					ofxHEMeshHalfedge h1o = halfedgeOpposite(h1);
+					setHalfedgeVertex(h1, e.second);
+					setHalfedgeVertex(h1o, e.first);
+					setVertexHalfedge(e.second, h1);
+					setVertexHalfedge(e.first, h1o);
+					explicitEdgeMap.insert(std::pair<ExplicitEdge, ofxHEMeshHalfedge>(e, h1));
+					allHalfedges.insert(h1);
+					allHalfedges.insert(h1o);
+				}
+			}
+		}
+
+		vector<ofxHEMeshHalfedge> halfedges;
+		for(int i=0; i < nfaces; ++i) {
+			ofxHEMeshFace f = allocateFace();
+			int begin = faceOffsets[i];
+			int nv = faceOffsets[i+1] - begin;
+			halfedges.clear();
+			for(int j=0; j < nv; ++j) {
+				ofxHEMeshVertex v1 = faceVertices[begin+j];
+				ofxHEMeshVertex v2 = faceVertices[begin + (j+1)%nv];
+				ofxHEMeshHalfedge h = explicitEdgeMap.find(orderedEdge(v1, v2))->second;
+				halfedges.push_back(v1 > v2 ? halfedgeOpposite(h) : h);
+			}
+			setFaceHalfedge(f, halfedges[0]);
+			for(int j=0; j < nv; ++j) {
+				ofxHEMeshHalfedge h1 = halfedges[j];
+				ofxHEMeshHalfedge h2 = halfedges[(j+1)%nv];
+				allHalfedges.erase(allHalfedges.find(h1));
+				setHalfedgeNext(h1, h2);
+				setHalfedgePrev(h2, h1);
+				setHalfedgeFace(h1, f);
+			}
+		}
+
+		std::map<ofxHEMeshVertex, ofxHEMeshHalfedge> sinks;
+		std::map<ofxHEMeshVertex, ofxHEMeshHalfedge> sources;
+		for(std::set<ofxHEMeshHalfedge>::const_iterator it = allHalfedges.begin(); it != allHalfedges.end(); ++it) {
+			sinks.insert(std::pair<ofxHEMeshVertex, ofxHEMeshHalfedge>(halfedgeSink(*it), *it));
+			sources.insert(std::pair<ofxHEMeshVertex, ofxHEMeshHalfedge>(halfedgeSource(*it), *it));
+		}
+		for(std::map<ofxHEMeshVertex, ofxHEMeshHalfedge>::const_iterator it = sinks.begin(); it != sinks.end(); ++it) {
+			std::map<ofxHEMeshVertex, ofxHEMeshHalfedge>::const_iterator source = sources.find(it->first);
+			if(source == sources.end()) continue;
+			setHalfedgeNext(it->second, source->second);
+			setHalfedgePrev(source->second, it->second);
+		}
+	}
+
+protected:
+	static ExplicitEdge orderedEdge(ofxHEMeshVertex v1, ofxHEMeshVertex v2) {
+		return v1 > v2 ? ExplicitEdge(v2, v1) : ExplicitEdge(v1, v2);
+	}
+};
+
+// Time addFaces(offsets, vertices) and the std::map baseline on the same faces
+// and report the speedup
+static void compareBuilders(const string& label, const vector<ofxHEMesh::Point>& points,
+	const vector<int>& offsets, const vector<ofxHEMeshVertex>& corners, int repeats)
+{
+	double hashTime = 1e30;
+	double mapTime = 1e30;
+	int hashEdges = 0;
+	int mapEdges = 0;
+	for(int r=0; r < repeats; ++r) {
+		{
+			ofxHEMesh hemesh;
+			hemesh.addVertices(&points[0], points.size());
+			Clock::time_point start = Clock::now();
+			hemesh.addFaces(offsets, corners);
+			hashTime = std::min(hashTime, seconds(start));
+			hashEdges = hemesh.getNumEdges();
+		}
+		{
+			MapBuilderMesh hemesh;
+			hemesh.addVertices(&points[0], points.size());
+			Clock::time_point start = Clock::now();
+			hemesh.addFacesWithMaps(offsets, corners);
+			mapTime = std::min(mapTime, seconds(start));
+			mapEdges = hemesh.getNumEdges();
+		}
+	}
+	if(hashEdges != mapEdges) {
+		printf("%s: the builders made %d and %d edges\n", label.c_str(), hashEdges, mapEdges);
+	}
+	printf("%s: addFaces(offsets, vertices) %.4f s, std::map baseline %.4f s, %.1fx faster\n",
+		label.c_str(), hashTime, mapTime, mapTime/hashTime);
+}
+
+// Parse the model, then build a mesh from all of its groups
+static void benchmarkModel(const string& fileName, int repeats) {
+	double parseTime = 1e30;
+	double buildTime = 1e30;
+	int nfaces = 0;
+	vector<ofxHEMesh::Point> points;
+	vector<int> offsets;
+	vector<ofxHEMeshVertex> corners;
+	for(int r=0; r < repeats; ++r) {
+		ofxHEMeshOBJLoader loader;
+		Clock::time_point start = Clock::now();
+		if(!loader.loadModel(fileName)) {
+			printf("couldn't load %s\n", fileName.c_str());
+			return;
+		}
+		parseTime = std::min(parseTime, seconds(start));
+
+		ofxHEMesh hemesh;
+		start = Clock::now();
+		for(int i=0; i < loader.getNumMeshes(); ++i) {
+			loader.addToHemesh(hemesh, i);
+		}
+		buildTime = std::min(buildTime, seconds(start));
+		nfaces = hemesh.getNumFaces();
+		if(r == repeats-1) {
+			// flatten the loaded faces to compare the builders on
+			for(int i=0; i < hemesh.getNumVertices(); ++i) {
+				points.push_back(hemesh.vertexPoint(ofxHEMeshVertex(i)));
+			}
+			offsets.push_back(0);
+			for(int i=0; i < nfaces; ++i) {
+				ofxHEMeshFaceCirculator fc = hemesh.faceCirculate(ofxHEMeshFace(i));
+				ofxHEMeshFaceCirculator fce = fc;
+				do {
+					corners.push_back(hemesh.halfedgeVertex(*fc));
+					++fc;
+				} while(fc != fce);
+				offsets.push_back(int(corners.size()));
+			}
+		}
+	}
+	printf("%s: %d faces, parse %.4f s, build %.4f s\n", fileName.c_str(), nfaces, parseTime, buildTime);
+	compareBuilders(fileName, points, offsets, corners, repeats);
+}
+
+// A square grid of about ntriangles triangles, built through both flattened
+// addFaces() overloads and the baseline
+static void benchmarkGrid(int ntriangles, int repeats) {
+	int n = std::max(1, int(sqrt(ntriangles/2.)));
+	int row = n+1;
+	vector<ofxHEMesh::Point> points;
+	points.reserve(size_t(row)*row);
+	for(int j=0; j <= n; ++j) {
+		for(int i=0; i <= n; ++i) {
+			points.push_back(ofxHEMesh::Point(i, j, 0));
+		}
+	}
+
+	vector<ofxHEMeshVertex> corners;
+	corners.reserve(size_t(n)*n*6);
+	for(int j=0; j < n; ++j) {
+		for(int i=0; i < n; ++i) {
+			int v = j*row + i;
+			corners.push_back(ofxHEMeshVertex(v));
+			corners.push_back(ofxHEMeshVertex(v+1));
+			corners.push_back(ofxHEMeshVertex(v+row+1));
+			corners.push_back(ofxHEMeshVertex(v));
+			corners.push_back(ofxHEMeshVertex(v+row+1));
+			corners.push_back(ofxHEMeshVertex(v+row));
+		}
+	}
+	vector<int> offsets(corners.size()/3 + 1);
+	for(int i=0; i < offsets.size(); ++i) {
+		offsets[i] = i*3;
+	}
+
+	double sizeTime = 1e30;
+	for(int r=0; r < repeats; ++r) {
+		ofxHEMesh hemesh;
+		hemesh.addVertices(&points[0], points.size());
+		Clock::time_point start = Clock::now();
+		hemesh.addFaces(corners, 3);
+		sizeTime = std::min(sizeTime, seconds(start));
+	}
+	printf("grid: %d triangles, addFaces(vertices, 3) %.4f s\n", int(offsets.size())-1, sizeTime);
+	compareBuilders("grid", points, offsets, corners, repeats);
+}
+
+int main(int argc, char *argv[]) {
+	string model = argc > 1 && argv[1][0] ? argv[1] : OFX_HEMESH_BENCHMARK_DATA "/sphere.obj";
+	int ntriangles = argc > 2 ? atoi(argv[2]) : 10000000;
+	int repeats = argc > 3 ? std::max(1, atoi(argv[3])) : 3;
+
+	printf("%d threads\n", hemesh::getNumThreads());
+	benchmarkModel(model, repeats);
+	benchmarkGrid(ntriangles, repeats);
+	return 0;
+}
@@ -1,10 +1,6 @@
 #pragma once
 
 #include "ofMain.h"
+#include "ofxHEMeshKernel.h"
 
-class GeometryKernel{
-public:
-	typedef float Scalar;
-	typedef ofVec3f	Point;
-	typedef ofVec3f Direction;
-};
\ No newline at end of file
+typedef ofxHEMeshFloatKernel GeometryKernel;
@@ -1,7 +1,14 @@
 #include "ofxHEMesh.h"
 #include "ofxHEMeshOBJLoader.h"
 #include "ofxHEMeshSubdivision.h"
+#include "ofxHEMeshBinaryIO.h"
+#include "ofxHEMeshEdgeHash.h"
+#include "ofxHEMeshParallel.h"
+#include "ofxHEMeshJournal.h"
+#include "ofxHEMeshRefinement.h"
 #include <sstream>
+#include <atomic>
+#include <climits>
 
 
 #define WRAP_NEXT(idx, n) (((idx)+1)%(n))
@@ -12,10 +19,23 @@ using std::ofstream;
 using std::queue;
 using std::set;
 
+// Read a property without copying blocks it shares with a snapshot
+template<typename T>
+static inline const ofxHEMeshProperty<T>& readOnly(const ofxHEMeshProperty<T> *prop) {
+	return *prop;
+}
+
+inline bool ofxHEMesh::journaling() const {
+	return journal && journal->isRecording();
+}
+
 ofxHEMesh::ofxHEMesh()
 :	points(0),
 	topologyDirty(false),
-	geometryDirty(false)
+	geometryDirty(false),
+	allocationPolicy(AppendElements),
+	journal(NULL),
+	changeDepth(0)
 {
 	vertexAdjacency = addVertexProperty<ofxHEMeshVertexAdjacency>("vertex-adjacency", ofxHEMeshVertexAdjacency());
 	halfedgeAdjacency = addHalfedgeProperty<ofxHEMeshHalfedgeAdjacency>("halfedge-adjacency", ofxHEMeshHalfedgeAdjacency());
@@ -23,288 +43,160 @@ ofxHEMesh::ofxHEMesh()
 	points = addVertexProperty<Point>("points", Point());
 }
 
+ofxHEMesh::ofxHEMesh(const ofxHEMesh& src)
+:	vertexProperties(src.vertexProperties),
+	halfedgeProperties(src.halfedgeProperties),
+	edgeProperties(src.edgeProperties),
+	faceProperties(src.faceProperties),
+	liveVertices(src.liveVertices),
+	liveEdges(src.liveEdges),
+	liveFaces(src.liveFaces),
+	topologyDirty(true),
+	geometryDirty(true),
+	allocationPolicy(src.allocationPolicy),
+	freeVertices(src.freeVertices),
+	freeEdges(src.freeEdges),
+	freeFaces(src.freeFaces),
+	journal(NULL),
+	changeDepth(0)
+{
+	bindProperties();
+}
+
+ofxHEMesh::ofxHEMesh(ofxHEMesh&& src)
+:	ofxHEMesh()
+{
+	swap(src);
+}
+
 ofxHEMesh& ofxHEMesh::operator=(const ofxHEMesh& src) {
-	src.vertexProperties.duplicate(vertexProperties);
-	src.halfedgeProperties.duplicate(halfedgeProperties);
-	src.edgeProperties.duplicate(edgeProperties);
-	src.faceProperties.duplicate(faceProperties);
+	if(this == &src) return *this;
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::External);
+	flushChanges();
+	
+	vertexProperties.assign(src.vertexProperties);
+	halfedgeProperties.assign(src.halfedgeProperties);
+	edgeProperties.assign(src.edgeProperties);
+	faceProperties.assign(src.faceProperties);
+	bindProperties();
+	
+	liveVertices = src.liveVertices;
+	liveEdges = src.liveEdges;
+	liveFaces = src.liveFaces;
+	
+	allocationPolicy = src.allocationPolicy;
+	freeVertices = src.freeVertices;
+	freeEdges = src.freeEdges;
+	freeFaces = src.freeFaces;
+	
+	contentsReplaced();
+	return *this;
+}
+
+ofxHEMesh& ofxHEMesh::operator=(ofxHEMesh&& src) {
+	if(this != &src) {
+		// the old contents go with empty rather than staying in src
+		ofxHEMesh empty;
+		swap(src);
+		src.swap(empty);
+	}
+	return *this;
+}
+
+// Property objects stay with their meshes so pointers to them (e.g. from
+// addVertexProperty()) stay valid, only the items are exchanged
+void ofxHEMesh::swap(ofxHEMesh& other) {
+	if(this == &other) return;
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::External);
+	ofxHEMeshJournal::Scope otherScope(other, ofxHEMeshJournal::External);
+	flushChanges();
+	other.flushChanges();
+	
+	vertexProperties.swapContents(other.vertexProperties);
+	halfedgeProperties.swapContents(other.halfedgeProperties);
+	edgeProperties.swapContents(other.edgeProperties);
+	faceProperties.swapContents(other.faceProperties);
+	bindProperties();
+	other.bindProperties();
+	
+	std::swap(liveVertices, other.liveVertices);
+	std::swap(liveEdges, other.liveEdges);
+	std::swap(liveFaces, other.liveFaces);
+	
+	std::swap(allocationPolicy, other.allocationPolicy);
+	std::swap(freeVertices, other.freeVertices);
+	std::swap(freeEdges, other.freeEdges);
+	std::swap(freeFaces, other.freeFaces);
 	
+	contentsReplaced();
+	other.contentsReplaced();
+}
+
+void ofxHEMesh::contentsReplaced() {
+	changes.markAll();
+	topologyDirty = true;
+	geometryDirty = true;
+	notifyGeometryListeners(ofxHEMeshVertex(), &GeometryListener::verticesCleared);
+	notifyGeometryListeners(ofxHEMeshVertex(0), getNumVertices(), &GeometryListener::verticesAdded);
+}
+
+ofxHEMesh ofxHEMesh::snapshot() const {
+	ofxHEMesh mesh(*this);
+	// rank() builds its prefix counts lazily, do it before other threads read
+	mesh.liveVertices.updateRanks();
+	mesh.liveEdges.updateRanks();
+	mesh.liveFaces.updateRanks();
+	return mesh;
+}
+
+void ofxHEMesh::bindProperties() {
 	vertexAdjacency = (ofxHEMeshProperty<ofxHEMeshVertexAdjacency> *)vertexProperties.get("vertex-adjacency");
 	halfedgeAdjacency = (ofxHEMeshProperty<ofxHEMeshHalfedgeAdjacency> *)halfedgeProperties.get("halfedge-adjacency");
 	faceAdjacency = (ofxHEMeshProperty<ofxHEMeshFaceAdjacency> *)faceProperties.get("face-adjacency");
 	points = (ofxHEMeshProperty<Point> *)vertexProperties.get("points");
-	
-	topologyDirty = true;
-	geometryDirty = true;
-	return *this;
 }
 
 void ofxHEMesh::remeshLoop() {
-	// Get the location of new (odd) vertices dividing edges in the subd mesh
-	map<ofxHEMeshHalfedge, ofxHEMeshVertex> edgeVertices;
-	ofxHEMeshEdgeIterator eit = edgesBegin();
-	ofxHEMeshEdgeIterator eite = edgesEnd();
-	for(; eit != eite; ++eit) {
-		ofxHEMeshHalfedge h = *eit;
-		ofxHEMeshHalfedge ho = halfedgeOpposite(h);
-		
-		Point pt = halfedgeMidpoint(h);
-		ofxHEMeshVertex v = addVertex(pt);
-		edgeVertices.insert(std::pair<ofxHEMeshHalfedge, ofxHEMeshVertex>(h, v));
-		edgeVertices.insert(std::pair<ofxHEMeshHalfedge, ofxHEMeshVertex>(halfedgeOpposite(h), v));
-	}
-	
-	// Calculate the subd mesh faces
-	vector<ExplicitFace> faces;
-	faces.reserve(faceAdjacency->size()*4);
-	ofxHEMeshFaceIterator fit = facesBegin();
-	ofxHEMeshFaceIterator fite = facesEnd();
-	for(; fit != fite; ++fit) {
-		ofxHEMeshFaceCirculator fc = faceCirculate(*fit);
-		ofxHEMeshFaceCirculator fce = fc;
-		
-		ExplicitFace innerFace(3);
-		int i=0;
-		do {
-			ExplicitFace cornerFace(3);
-			ofxHEMeshHalfedge h = *fc;
-			cornerFace[0] = halfedgeSink(h);
-			cornerFace[1] = edgeVertices[halfedgeNext(h)];
-			cornerFace[2] = edgeVertices[h];
-			faces.push_back(cornerFace);
-			innerFace[i] = edgeVertices[h];
-			++i;
-			++fc;
-		} while(fc != fce);
-		faces.push_back(innerFace);
-	}
-	
-	halfedgeProperties.clear();
-	faceProperties.clear();
-	addFaces(faces);
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::RemeshLoop);
+	ofxHEMeshRefinement refinement(*this);
+	refinement.apply();
 }
 
 // Assumes the mesh is a triangulation
 void ofxHEMesh::subdivideLoop() {
-
-	// Get the new location of existing (even) vertices in the subd mesh
-	ofxHEMeshVertexIterator vit = verticesBegin();
-	ofxHEMeshVertexIterator vite = verticesEnd();
-	map<ofxHEMeshVertex, Point> newPositions;
-	for(; vit != vite; ++vit) {
-		ofxHEMeshVertexCirculator vc = vertexCirculate(*vit);
-		ofxHEMeshVertexCirculator vce = vc;
-		int valence = vertexValence(*vit);
-		Scalar beta;
-		if(valence == 3) {
-			beta = 3./16.;
-		}
-		else {
-			beta = 3./(8.*valence);
-		}
-		
-		Point nPt = vertexPoint(*vit)*(1.-valence*beta);
-		bool onBoundary = false;
-		do {
-			if(halfedgeIsOnBoundary(*vc)) {
-				onBoundary = true;
-				break;
-			}
-			nPt += vertexPoint(halfedgeSource(*vc))*beta;
-			++vc;
-		} while(vc != vce);
-		
-		if(onBoundary) {
-			ofxHEMeshHalfedge h1 = *vc;
-			ofxHEMeshHalfedge h2 = halfedgeSinkCW(h1);
-			nPt =
-				3./4.*vertexPoint(*vit) +
-				1./8.*(vertexPoint(halfedgeSource(h1)) + vertexPoint(halfedgeSource(h2)));
-		}
-		
-		newPositions.insert(std::pair<ofxHEMeshVertex, Point>(*vit, nPt));
-	}
-
-	// Get the location of new (odd) vertices dividing edges in the subd mesh
-	map<ofxHEMeshHalfedge, ofxHEMeshVertex> edgeVertices;
-	ofxHEMeshEdgeIterator eit = edgesBegin();
-	ofxHEMeshEdgeIterator eite = edgesEnd();
-	for(; eit != eite; ++eit) {
-		ofxHEMeshHalfedge h = *eit;
-		ofxHEMeshHalfedge ho = halfedgeOpposite(h);
-		
-		Point pt = halfedgeMidpoint(h);
-		if(halfedgeIsOnBoundary(h) || halfedgeIsOnBoundary(ho)) {
-			pt = halfedgeMidpoint(h);
-		}
-		else {
-			ofxHEMeshHalfedge hn = halfedgeNext(h);
-			ofxHEMeshHalfedge hon = halfedgeNext(ho);
-			pt =
-				(vertexPoint(halfedgeSource(h)) + vertexPoint(halfedgeSink(h)))*0.375 +
-				(vertexPoint(halfedgeSink(hn)) + vertexPoint(halfedgeSink(hon)))*0.125;
-		}
-		ofxHEMeshVertex v = addVertex(pt);
-		edgeVertices.insert(std::pair<ofxHEMeshHalfedge, ofxHEMeshVertex>(h, v));
-		edgeVertices.insert(std::pair<ofxHEMeshHalfedge, ofxHEMeshVertex>(halfedgeOpposite(h), v));
-	}
-	
-	// Move the existing vertices to their subd mesh positions
-	map<ofxHEMeshVertex, Point>::const_iterator npt_it = newPositions.begin();
-	map<ofxHEMeshVertex, Point>::const_iterator npt_ite = newPositions.end();
-	for(; npt_it != npt_ite; ++npt_it) {
-		vertexMoveTo(npt_it->first, npt_it->second);
-	}
-	
-	// Calculate the subd mesh faces
-	vector<ExplicitFace> faces;
-	faces.reserve(faceAdjacency->size()*4);
-	ofxHEMeshFaceIterator fit = facesBegin();
-	ofxHEMeshFaceIterator fite = facesEnd();
-	for(; fit != fite; ++fit) {
-		ofxHEMeshFaceCirculator fc = faceCirculate(*fit);
-		ofxHEMeshFaceCirculator fce = fc;
-		
-		ExplicitFace innerFace(3);
-		int i=0;
-		do {
-			ExplicitFace cornerFace(3);
-			ofxHEMeshHalfedge h = *fc;
-			cornerFace[0] = halfedgeSink(h);
-			cornerFace[1] = edgeVertices[halfedgeNext(h)];
-			cornerFace[2] = edgeVertices[h];
-			faces.push_back(cornerFace);
-			innerFace[i] = edgeVertices[h];
-			++i;
-			++fc;
-		} while(fc != fce);
-		faces.push_back(innerFace);
-	}
-	
-	halfedgeProperties.clear();
-	faceProperties.clear();
-	addFaces(faces);
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::SubdivideLoop);
+	ofxHEMeshLoopRefinement refinement(*this);
+	refinement.apply();
 }
 
-// Assumes no boundaries
 void ofxHEMesh::subdivideCatmullClark() {
-	map<ofxHEMeshFace, Point> facePoints;
-	map<ofxHEMeshFace, ofxHEMeshVertex> faceVertices;
-	ofxHEMeshFaceIterator fit = facesBegin();
-	ofxHEMeshFaceIterator fite = facesEnd();
-	for(; fit != fite; ++fit) {
-		Point centroid = faceCentroid(*fit);
-		facePoints.insert(std::pair<ofxHEMeshFace, Point>(*fit, centroid));
-		
-		ofxHEMeshVertex v = addVertex(centroid);
-		faceVertices.insert(std::pair<ofxHEMeshFace, ofxHEMeshVertex>(*fit, v));
-	}
-	
-	map<ofxHEMeshHalfedge, Point> edgePoints;
-	map<ofxHEMeshHalfedge, ofxHEMeshVertex> edgeVertices;
-	ofxHEMeshEdgeIterator eit = edgesBegin();
-	ofxHEMeshEdgeIterator eite = edgesEnd();
-	for(; eit != eite; ++eit) {
-		ofxHEMeshHalfedge h = *eit;
-		ofxHEMeshHalfedge ho = halfedgeOpposite(h);
-		
-		Point pt;
-		if(halfedgeIsOnBoundary(h) || halfedgeIsOnBoundary(ho)) {
-			pt = halfedgeMidpoint(h);
-		}
-		else {
-			pt = 0.25*(
-				vertexPoint(halfedgeSink(h)) + vertexPoint(halfedgeSink(ho)) +
-				facePoints[halfedgeFace(h)] + facePoints[halfedgeFace(ho)]
-			);
-		}
-		edgePoints.insert(std::pair<ofxHEMeshHalfedge, Point>(h, pt));
-		edgePoints.insert(std::pair<ofxHEMeshHalfedge, Point>(ho, pt));
-		
-		ofxHEMeshVertex v = addVertex(pt);
-		edgeVertices.insert(std::pair<ofxHEMeshHalfedge, ofxHEMeshVertex>(h, v));
-		edgeVertices.insert(std::pair<ofxHEMeshHalfedge, ofxHEMeshVertex>(ho, v));
-	}
-	
-	ofxHEMeshVertexIterator vit = verticesBegin();
-	ofxHEMeshVertexIterator vite = verticesEnd();
-	for(; vit != vite; ++vit) {
-		Point Q(0, 0, 0);
-		Point R(0, 0, 0);
-		Scalar valence = 0;
-		ofxHEMeshVertexCirculator vc = vertexCirculate(*vit);
-		ofxHEMeshVertexCirculator vce = vc;
-		bool onBoundary = false;
-		do {
-			ofxHEMeshHalfedge h = *vc;
-			if(halfedgeIsOnBoundary(h)) {
-				onBoundary = true;
-				break;
-			}
-			Q += facePoints[halfedgeFace(h)];
-			R += edgePoints[h];
-			++valence;
-			++vc;
-		} while(vc != vce);
-		
-		Point npt;
-		if(onBoundary) {
-			ofxHEMeshHalfedge h1 = *vc;
-			ofxHEMeshHalfedge h2 = halfedgeSinkCW(h1);
-			npt =
-				3./4.*vertexPoint(*vit) +
-				1./8.*(vertexPoint(halfedgeSource(h1)) + vertexPoint(halfedgeSource(h2)));
-		}
-		else {	
-			Q /= valence;
-			R /= valence;
-			Point S = vertexPoint(*vit);
-			npt = (Q + R*2 + S*(valence-3))/valence;
-		}
-		vertexMoveTo(*vit, npt);
-	}
-	
-	vector<ExplicitFace> faces;
-	faces.reserve(faceAdjacency->size()*4);
-	fit = facesBegin();
-	fite = facesEnd();
-	for(; fit != fite; ++fit) {
-		ofxHEMeshFace f = *fit;
-		ofxHEMeshFaceCirculator fc = faceCirculate(f);
-		ofxHEMeshFaceCirculator fce = fc;
-		do {
-			ExplicitFace face(4);
-			ofxHEMeshHalfedge h = *fc;
-			face[0] = edgeVertices[h];
-			face[1] = halfedgeVertex(h);
-			face[2] = edgeVertices[halfedgeNext(h)];
-			face[3] = faceVertices[f];
-			faces.push_back(face);
-			++fc;
-		} while(fc != fce);
-	}
-	
-	halfedgeProperties.clear();
-	faceProperties.clear();
-	addFaces(faces);
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::SubdivideCatmullClark);
+	ofxHEMeshCatmullClarkRefinement refinement(*this);
+	refinement.apply();
 }
 
 void ofxHEMesh::subdivideDooSabin() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::SubdivideDooSabin);
 	ofxHEMeshDooSabinSubdivision subd(*this);
 	subd.apply();
 }
 
 void ofxHEMesh::subdivideModifiedCornerCut(Scalar tension) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::SubdivideModifiedCornerCut);
+	scope.setScalar(tension);
 	ofxHEMeshModifiedCornerCutSubdivision subd(*this, tension);
 	subd.apply();
 }
 
 void ofxHEMesh::facePeel(Scalar thickness) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::FacePeel);
+	scope.setScalar(thickness);
 	ofxHEMeshFacePeel peel(*this, thickness);
 	peel.apply();
 }
 
 void ofxHEMesh::dual() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::Dual);
 	// New vertices will be created in order starting form 0 since
 	// the old vertices will be cleared out
 	int i=0;
@@ -320,12 +212,14 @@ void ofxHEMesh::dual() {
 	}
 	
 	// New faces are the cells around the existing vertices
-	vector<ExplicitFace> faces;
-	faces.reserve(getNumVertices());
+	vector<int> faceOffsets;
+	vector<ofxHEMeshVertex> faces;
+	faceOffsets.reserve(getNumVertices()+1);
+	faces.reserve(halfedgeAdjacency->size());
+	faceOffsets.push_back(0);
 	ofxHEMeshVertexIterator vit = verticesBegin();
 	ofxHEMeshVertexIterator vite = verticesEnd();
 	for(; vit != vite; ++vit) {
-		ExplicitFace face;
 		ofxHEMeshVertexCirculator vc = vertexCirculate(*vit);
 		ofxHEMeshVertexCirculator vce = vc;
 		bool onBoundary = false;
@@ -335,32 +229,31 @@ void ofxHEMesh::dual() {
 				break;
 			}
 			ofxHEMeshFace f = halfedgeFace(*vc);
-			face.push_back(faceVertices[f]);
+			faces.push_back(faceVertices[f]);
 			++vc;
 		} while(vc != vce);
 		
-		if(!onBoundary) {
-			faces.push_back(face);
+		if(onBoundary) {
+			faces.resize(faceOffsets.back());
+		}
+		else {
+			faceOffsets.push_back(faces.size());
 		}
 	}
 	
-	vertexProperties.clear();
-	// Iterates in same order as at top of function so that
-	// vertex indices and centroids match
-	fit = facesBegin();
-	fite = facesEnd();
-	i=0;
-	for(; fit != fite; ++fit) {
-		ofxHEMeshVertex v = addVertex(faceCentroids[i]);
-		++i;
+	clearVertices();
+	// Centroids were gathered in face order so vertex indices match
+	if(!faceCentroids.empty()) {
+		addVertices(&faceCentroids[0], faceCentroids.size());
 	}
 	
-	halfedgeProperties.clear();
-	faceProperties.clear();
-	addFaces(faces);
+	clearHalfedges();
+	clearFaces();
+	addFaces(faceOffsets, faces);
 }
 
 void ofxHEMesh::triangulate() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::Triangulate);
 	int nfaces = getNumFaces();
 	for(int i=0; i < nfaces; ++i) {
 		ofxHEMeshFace f(i);
@@ -381,8 +274,9 @@ void ofxHEMesh::triangulate() {
 }
 
 void ofxHEMesh::centroidTriangulation() {
-	vector<ExplicitFace> faces;
-	faces.reserve(getNumFaces());
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::CentroidTriangulation);
+	vector<ofxHEMeshVertex> faces;
+	faces.reserve(halfedgeAdjacency->size()*3);
 	
 	ofxHEMeshFaceIterator fit = facesBegin();
 	ofxHEMeshFaceIterator fite = facesEnd();
@@ -391,21 +285,20 @@ void ofxHEMesh::centroidTriangulation() {
 		ofxHEMeshFaceCirculator fc = faceCirculate(*fit);
 		ofxHEMeshFaceCirculator fce = fc;
 		do {
-			ExplicitFace face(3);
-			face[0] = v;
-			face[1] = halfedgeSource(*fc);
-			face[2] = halfedgeSink(*fc);
-			faces.push_back(face);
+			faces.push_back(v);
+			faces.push_back(halfedgeSource(*fc));
+			faces.push_back(halfedgeSink(*fc));
 			++fc;
 		} while(fc != fce);
 	}
 	
-	halfedgeProperties.clear();
-	faceProperties.clear();
-	addFaces(faces);
+	clearHalfedges();
+	clearFaces();
+	addFaces(faces, 3);
 }
 
 void ofxHEMesh::reverseFaces() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::ReverseFaces);
 	ofxHEMeshFaceIterator fit = facesBegin();
 	ofxHEMeshFaceIterator fite = facesEnd();
 	for(; fit != fite; ++fit) {
@@ -435,17 +328,42 @@ void ofxHEMesh::reverseFaces() {
 }
 
 void ofxHEMesh::translate(Direction dir) {
-	ofxHEMeshVertexIterator vit = verticesBegin();
-	ofxHEMeshVertexIterator vite = verticesEnd();
-	for(; vit != vite; ++vit) {
-		vertexMove(*vit, dir);
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::Translate);
+	scope.setPoint(dir);
+	if(changeDepth > 0) {
+		// queue the moves with the rest of the transaction
+		ofxHEMeshVertexIterator vit = verticesBegin();
+		ofxHEMeshVertexIterator vite = verticesEnd();
+		for(; vit != vite; ++vit) {
+			vertexMove(*vit, dir);
+		}
+		return;
+	}
+	
+	if(!geometryListeners.empty()) {
+		vector<ofxHEMeshVertex> vertices(getNumLiveVertices());
+		vector<Point> newPoints(getNumLiveVertices());
+		parallelForVertices([&](ofxHEMeshVertex v) {
+			int i = vertexLiveIndex(v);
+			vertices[i] = v;
+			newPoints[i] = vertexPoint(v)+dir;
+		});
+		for(int i=0; i < geometryListeners.size(); ++i) {
+			geometryListeners[i]->verticesWillMove(vertices, newPoints);
+		}
 	}
+	points->unshare(0, getNumVertices());
+	parallelForVertices([&](ofxHEMeshVertex v) {
+		points->get(v.idx) += dir;
+	});
+	changes.markAll();
 	geometryDirty = true;
 }
 
 // Assumes h1 and h2 are two edges to be joined in a face and that
 // their respective faces have the same number of vertices
 void ofxHEMesh::connectFacesSimple(ofxHEMeshHalfedge h1, ofxHEMeshHalfedge h2) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::ConnectFacesSimple, h1.idx, h2.idx);
 	vector<ExplicitFace> faces;
 	ofxHEMeshFaceCirculator fc1(this, h1);
 	ofxHEMeshFaceCirculator fce1 = fc1;
@@ -474,8 +392,8 @@ void ofxHEMesh::connectFacesSimple(ofxHEMeshHalfedge h1, ofxHEMeshHalfedge h2) {
 }
 
 void ofxHEMesh::connectHalfedgesCofacial(ofxHEMeshHalfedge h1, ofxHEMeshHalfedge h2) {
-	ofxHEMeshFace fn(faceProperties.size());
-	faceAdjacency->extend();
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::ConnectHalfedgesCofacial, h1.idx, h2.idx);
+	ofxHEMeshFace fn = allocateFace();
 	
 	ofxHEMeshHalfedge hn = addEdge();
 	ofxHEMeshHalfedge hno(hn.idx+1);
@@ -516,14 +434,19 @@ void ofxHEMesh::connectHalfedgesCofacial(ofxHEMeshHalfedge h1, ofxHEMeshHalfedge
 }
 
 ofxHEMeshVertex ofxHEMesh::splitHalfedgeQuadraticFit(ofxHEMeshHalfedge h) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::SplitHalfedgeQuadraticFit, h.idx);
 	return splitHalfedge(h, halfedgeQuadraticFit(h));
 }
 
 ofxHEMeshVertex ofxHEMesh::splitHalfedge(ofxHEMeshHalfedge h, Scalar t) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::SplitHalfedge, h.idx);
+	scope.setScalar(t);
 	return splitHalfedge(h, halfedgeLerp(h, t));
 }
 
 ofxHEMeshVertex ofxHEMesh::splitHalfedge(ofxHEMeshHalfedge h, Point pt) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::SplitHalfedgeAt, h.idx);
+	scope.setPoint(pt);
 	ofxHEMeshVertex vn = addVertex(pt);
 	ofxHEMeshHalfedge hn = addEdge();
 	ofxHEMeshHalfedge hno(hn.idx+1);
@@ -554,14 +477,19 @@ ofxHEMeshVertex ofxHEMesh::splitHalfedge(ofxHEMeshHalfedge h, Point pt) {
 }
 
 ofxHEMeshVertex ofxHEMesh::collapseHalfedgeQuadraticFit(ofxHEMeshHalfedge h) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::CollapseHalfedgeQuadraticFit, h.idx);
 	return collapseHalfedge(h, halfedgeQuadraticFit(h));
 }
 
 ofxHEMeshVertex ofxHEMesh::collapseHalfedge(ofxHEMeshHalfedge h, Scalar t) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::CollapseHalfedge, h.idx);
+	scope.setScalar(t);
 	return collapseHalfedge(h, halfedgeLerp(h, t));
 }
 
 ofxHEMeshVertex ofxHEMesh::collapseHalfedge(ofxHEMeshHalfedge h, Point pt) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::CollapseHalfedgeAt, h.idx);
+	scope.setPoint(pt);
 	if(halfedgeEndPointsShareOneRing(h)) {
 		return ofxHEMeshVertex();
 	}
@@ -628,45 +556,41 @@ ofxHEMeshHalfedge ofxHEMesh::nearestVertexInFaceToPoint(const Point& pt, ofxHEMe
 }
 
 bool ofxHEMesh::loadOBJModel(string modelName) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::External);
 	ofxHEMeshOBJLoader loader;
-	bool res = loader.loadModel(modelName);
-	if(res) {
-		loader.addToHemesh(*this, 0);
-	}
-	return res;
+	return loader.loadModel(modelName, *this);
+}
+
+bool ofxHEMesh::saveBinary(string fileName) const {
+	return ofxHEMeshBinaryIO::save(*this, fileName);
+}
+
+bool ofxHEMesh::loadBinary(string fileName) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::External);
+	return ofxHEMeshBinaryIO::load(*this, fileName);
 }
 
 void ofxHEMesh::addMesh(const ofMesh& mesh) {
 	ofxHEMeshVertex vstart(vertexAdjacency->size());
 	
 	const vector<ofVec3f>& vertices = mesh.getVertices();
-	vector<ofVec3f>::const_iterator vit = vertices.begin();
-	vector<ofVec3f>::const_iterator vite = vertices.end();
-
-	for(; vit != vite; ++vit) {
-		addVertex(*vit);
+	if(!vertices.empty()) {
+		vstart = addVertices(&vertices[0], vertices.size());
 	}
 	
 	
 	// Assume triangles for now
 	// TOOD: use mesh.getMode()
-	vector< vector<ofxHEMeshVertex> > faces;
+	vector<ofxHEMeshVertex> faces;
 	const vector<ofIndexType>& indices = mesh.getIndices();
-	vector<ofIndexType>::const_iterator iit = indices.begin();
-	vector<ofIndexType>::const_iterator iite = indices.end();
-	
-	faces.reserve(indices.size()/3);
-	while(iit != iite) {
-		vector<ofxHEMeshVertex> face(3);
-		for(int i=0; i < 3; ++i) {
-			ofxHEMeshVertex v = ofxHEMeshVertex((*iit)+vstart.idx);
-			face[i] = v;
-			++iit;
-		}
-		faces.push_back(face);
+	
+	size_t ncorners = indices.size() - indices.size()%3;
+	faces.reserve(ncorners);
+	for(size_t i=0; i < ncorners; ++i) {
+		faces.push_back(ofxHEMeshVertex(indices[i]+vstart.idx));
 	}
 	
-	addFaces(faces);
+	addFaces(faces, 3);
 }
 
 void ofxHEMesh::addMesh(const ofxHEMesh& hemesh) {
@@ -678,57 +602,168 @@ void ofxHEMesh::addMesh(const ofxHEMesh& hemesh) {
 	halfedgeProperties.reserve(halfedgeOffset+hemesh.halfedgeProperties.size());
 	faceProperties.reserve(faceOffset+hemesh.faceProperties.size());
 	
-	map<ofxHEMeshVertex, ofxHEMeshVertex> vertexMap;
+	vector<ofxHEMeshVertex> vertexMap(hemesh.vertexProperties.size());
+	vector<Point> vertexPoints;
+	vertexPoints.reserve(hemesh.vertexProperties.size());
 	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
 	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
 	for(; vit != vite; ++vit) {
-		ofxHEMeshVertex vn = addVertex(hemesh.vertexPoint(*vit));
-		vertexMap.insert(std::pair<ofxHEMeshVertex, ofxHEMeshVertex>(*vit, vn));
+		vertexMap[vit->idx] = ofxHEMeshVertex(vertexOffset + vertexPoints.size());
+		vertexPoints.push_back(hemesh.vertexPoint(*vit));
+	}
+	if(!vertexPoints.empty()) {
+		addVertices(&vertexPoints[0], vertexPoints.size());
 	}
 	
-	vector<ExplicitFace> faces;
+	vector<int> faceOffsets;
+	vector<ofxHEMeshVertex> faces;
+	faceOffsets.reserve(hemesh.faceProperties.size()+1);
+	faces.reserve(hemesh.halfedgeProperties.size());
+	faceOffsets.push_back(0);
 	ofxHEMeshFaceIterator fit = hemesh.facesBegin();
 	ofxHEMeshFaceIterator fite = hemesh.facesEnd();
 	for(; fit != fite; ++fit) {
-		ExplicitFace face;
 		ofxHEMeshFaceCirculator fc = hemesh.faceCirculate(*fit);
 		ofxHEMeshFaceCirculator fce = fc;
 		do {
 			ofxHEMeshVertex v = hemesh.halfedgeVertex(*fc);
-			face.push_back(vertexMap[v]);
+			faces.push_back(vertexMap[v.idx]);
 			++fc;
 		} while(fc != fce);
 		
-		faces.push_back(face);
+		faceOffsets.push_back(faces.size());
 	}
-	addFaces(faces);
+	addFaces(faceOffsets, faces);
 }
 
 ofxHEMeshVertex ofxHEMesh::addVertex(const Point& p) {
-	int idx = vertexProperties.size();
-	vertexProperties.extend();
-	points->set(idx, p);
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::AddVertex);
+	scope.setPoint(p);
+	int idx = -1;
+	while((idx = popFree(VertexElements)) >= 0) {
+		if(idx < getNumVertices() && !vertexHalfedge(ofxHEMeshVertex(idx)).isValid()) {
+			resetElement(VertexElements, idx);
+			break;
+		}
+	}
+	if(idx < 0) {
+		idx = vertexProperties.size();
+		extendElements(VertexElements, 1);
+	}
+	writePoint(ofxHEMeshVertex(idx), p);
+	changes.markVertex(idx);
 	ofxHEMeshVertex v(idx);
 	topologyDirty = true;
 	geometryDirty = true;
-	notifyGeometryListeners(v, &GeometryListener::vertexAdded);
+	vertexWasAdded(v, 1);
 	return v;
 }
 
+ofxHEMeshVertex ofxHEMesh::addVertices(const Point *pts, size_t n) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::AddVertices, int(n));
+	if(scope.hasCommand()) scope.addPoints(pts, n);
+	int vstart = vertexProperties.size();
+	vertexProperties.extend(int(n));
+	if(n > 0) {
+		points->unshare(vstart, vstart+int(n));
+		hemesh::parallelFor(0, int(n), [&](int b, int e) {
+			points->copyFrom(pts+b, vstart+b, vstart+e);
+		}, 1<<16);
+	}
+	verticesAppended(vstart, int(n));
+	return ofxHEMeshVertex(vstart);
+}
+
+void ofxHEMesh::verticesAppended(int vstart, int n) {
+	if(changes.isTracking()) {
+		for(int i=0; i < n; ++i) {
+			changes.markVertex(vstart+i);
+		}
+	}
+	topologyDirty = true;
+	geometryDirty = true;
+	vertexWasAdded(ofxHEMeshVertex(vstart), n);
+}
+
+void ofxHEMesh::vertexWasAdded(ofxHEMeshVertex v, int n) {
+	if(changeDepth > 0) {
+		// extend the last range when the new vertices follow on from it
+		if(!pendingAdds.empty() && pendingAdds.back().first+pendingAdds.back().second == v.idx) {
+			pendingAdds.back().second += n;
+		}
+		else {
+			pendingAdds.push_back(std::pair<int, int>(v.idx, n));
+		}
+	}
+	else if(n == 1) {
+		notifyGeometryListeners(v, &GeometryListener::vertexAdded);
+	}
+	else {
+		notifyGeometryListeners(v, n, &GeometryListener::verticesAdded);
+	}
+}
+
+// Outside of a transaction listeners get one verticesWillMove() and the points
+// are written in parallel.  The writes aren't journaled.
+void ofxHEMesh::moveVertices(const vector<ofxHEMeshVertex>& vertices, const vector<Point>& pts) {
+	if(changeDepth > 0) {
+		for(int i=0; i < vertices.size(); ++i) {
+			vertexMoveTo(vertices[i], pts[i]);
+		}
+		return;
+	}
+	for(int i=0; i < geometryListeners.size(); ++i) {
+		geometryListeners[i]->verticesWillMove(vertices, pts);
+	}
+	points->unshare(0, getNumVertices());
+	hemesh::parallelFor(0, int(vertices.size()), [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			points->get(vertices[i].idx) = pts[i];
+		}
+	});
+	if(changes.isTracking()) {
+		for(int i=0; i < vertices.size(); ++i) {
+			changes.markVertex(vertices[i].idx);
+		}
+	}
+	geometryDirty = true;
+}
+
 ofxHEMeshHalfedge ofxHEMesh::addEdge() {
-	halfedgeProperties.extend();
-	halfedgeProperties.extend();
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::AddEdge);
+	int e;
+	while((e = popFree(HalfedgeElements)) >= 0) {
+		ofxHEMeshHalfedge h(e*2);
+		if(h.idx < getNumHalfedges() && !halfedgeVertex(h).isValid() && !halfedgeVertex(halfedgeOpposite(h)).isValid()) {
+			resetElement(HalfedgeElements, h.idx);
+			resetElement(HalfedgeElements, h.idx+1);
+			if(e < edgeProperties.size()) {
+				resetElement(EdgeElements, e);
+			}
+			return h;
+		}
+	}
+	extendElements(HalfedgeElements, 2);
 	return ofxHEMeshHalfedge(halfedgeProperties.size()-2);
 }
 
-static bool orderVertices(ofxHEMeshVertex& v1, ofxHEMeshVertex& v2) {
-	bool swap = v1 > v2;
-	if(swap) {
-		ofxHEMeshVertex v = v2;
-		v2 = v1;
-		v1 = v;
+ofxHEMeshHalfedge ofxHEMesh::addEdges(size_t n) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::AddEdges, int(n));
+	int hstart = halfedgeProperties.size();
+	extendElements(HalfedgeElements, int(2*n));
+	return ofxHEMeshHalfedge(hstart);
+}
+
+ofxHEMeshFace ofxHEMesh::allocateFace() {
+	int idx;
+	while((idx = popFree(FaceElements)) >= 0) {
+		if(idx < getNumFaces() && !faceHalfedge(ofxHEMeshFace(idx)).isValid()) {
+			resetElement(FaceElements, idx);
+			return ofxHEMeshFace(idx);
+		}
 	}
-	return swap;
+	extendElements(FaceElements, 1);
+	return ofxHEMeshFace(faceProperties.size()-1);
 }
 
 void printExplicitFace(const ofxHEMesh::ExplicitFace& face) {
@@ -747,89 +782,379 @@ void printExplicitFaces(const vector<ofxHEMesh::ExplicitFace>& faces) {
 
 
 void ofxHEMesh::addFaces(const vector<ExplicitFace>& faces) {
-	map<ExplicitEdge, ofxHEMeshHalfedge> explicitEdgeMap;
-	int i, j;
+	int nfaces = int(faces.size());
+	vector<int> faceOffsets(nfaces+1);
+	faceOffsets[0] = 0;
+	for(int i=0; i < nfaces; ++i) {
+		faceOffsets[i+1] = faceOffsets[i] + int(faces[i].size());
+	}
 	
+	vector<ofxHEMeshVertex> faceVertices;
+	faceVertices.reserve(faceOffsets[nfaces]);
+	for(int i=0; i < nfaces; ++i) {
+		faceVertices.insert(faceVertices.end(), faces[i].begin(), faces[i].end());
+	}
+	addFaces(faceOffsets, faceVertices);
+}
+
+void ofxHEMesh::addFaces(const vector<int>& faceOffsets, const vector<ofxHEMeshVertex>& faceVertices) {
+	if(faceOffsets.size() < 2) return;
+	if(faceOffsets.front() != 0 || faceOffsets.back() != int(faceVertices.size())) {
+		throw std::invalid_argument("face offsets don't span the face vertices");
+	}
+	for(int i=1; i < faceOffsets.size(); ++i) {
+		if(faceOffsets[i] < faceOffsets[i-1]) throw std::invalid_argument("face offsets decrease");
+	}
+	if(faceVertices.empty()) return;
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::AddFaces, int(faceOffsets.size())-1);
+	if(scope.hasCommand()) {
+		for(int i=0; i < faceOffsets.size(); ++i) scope.addInt(faceOffsets[i]);
+		for(int i=0; i < faceVertices.size(); ++i) scope.addInt(faceVertices[i].idx);
+	}
+	buildFaces(FaceList(&faceOffsets[0], &faceVertices[0], int(faceOffsets.size())-1));
+}
+
+void ofxHEMesh::addFaces(const vector<ofxHEMeshVertex>& faceVertices, int faceSize) {
+	if(faceVertices.empty() || faceSize <= 0) return;
+	if(faceVertices.size() % faceSize != 0) {
+		throw std::invalid_argument("face vertices aren't a whole number of faces");
+	}
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::AddFacesOfSize, faceSize);
+	if(scope.hasCommand()) {
+		for(int i=0; i < faceVertices.size(); ++i) scope.addInt(faceVertices[i].idx);
+	}
+	buildFaces(FaceList(NULL, &faceVertices[0], int(faceVertices.size())/faceSize, faceSize));
+}
+
+// Below this many face corners, thread startup costs more than it saves
+static const int ParallelBuildThreshold = 1 << 16;
+
+void ofxHEMesh::buildFaces(const FaceList& faces) {
+	if(faces.numCorners() >= ParallelBuildThreshold && hemesh::getNumThreads() > 1) {
+		buildFacesParallel(faces);
+	}
+	else {
+		buildFacesSerial(faces);
+	}
+}
+
+void ofxHEMesh::buildFacesSerial(const FaceList& faces) {
+	const ofxHEMeshVertex *faceVertices = faces.vertices;
+	int nfaces = faces.nfaces;
+	int ncorners = faces.numCorners();
+	int i, j;
 	
-	// Create any edges that don't yet exist
-	set<ofxHEMeshHalfedge> allHalfedges;
-	for(i=0; i < faces.size(); ++i) {
-		const vector<ofxHEMeshVertex>& face = faces[i];
-		int nv = int(face.size());
+	// Number edges in order of first appearance.  The even halfedge of an
+	// edge points to the larger vertex index.
+	ofxHEMeshEdgeHash edgeHash(ncorners);
+	vector<ofxHEMeshVertex> edgeVertices;
+	edgeVertices.reserve(ncorners);
+	vector<ofxHEMeshHalfedge> cornerHalfedges(ncorners);
+	int hstart = halfedgeProperties.size();
+	int nedges = 0;
+	for(i=0; i < nfaces; ++i) {
+		int offset = faces.faceBegin(i);
+		int nv = faces.faceBegin(i+1) - offset;
 		for(j=0; j < nv; ++j) {
-			ofxHEMeshVertex v1 = face[j];
-			ofxHEMeshVertex v2 = face[WRAP_NEXT(j, nv)];
-			bool swap = orderVertices(v1, v2);
-			if(explicitEdgeMap.find(ExplicitEdge(v1, v2)) == explicitEdgeMap.end()) {
-				ofxHEMeshHalfedge h1 = addEdge();
-				ofxHEMeshHalfedge h1o = halfedgeOpposite(h1);
-				setHalfedgeVertex(h1, v2);
-				setHalfedgeVertex(h1o, v1);
-				setVertexHalfedge(v2, h1);
-				setVertexHalfedge(v1, h1o);
-
-				explicitEdgeMap.insert(std::pair<ExplicitEdge, ofxHEMeshHalfedge>(ExplicitEdge(v1, v2), h1));
-				allHalfedges.insert(h1);
-				allHalfedges.insert(h1o);
+			ofxHEMeshVertex v1 = faceVertices[offset + j];
+			ofxHEMeshVertex v2 = faceVertices[offset + WRAP_NEXT(j, nv)];
+			bool inserted;
+			int e = edgeHash.findOrInsert(v1.idx, v2.idx, nedges, inserted);
+			if(inserted) {
+				edgeVertices.push_back(v1 < v2 ? v1 : v2);
+				edgeVertices.push_back(v1 < v2 ? v2 : v1);
+				++nedges;
 			}
+			cornerHalfedges[offset+j] = ofxHEMeshHalfedge(hstart + 2*e + (v1 > v2 ? 1 : 0));
 		}
 	}
 	
-	// Link Halfedges around faces
-	for(i=0; i < faces.size(); ++i) {
-		ofxHEMeshFace f(faceProperties.size());
-		faceAdjacency->extend();
+	// Create all of the new edges in one allocation
+	addEdges(nedges);
+	for(i=0; i < nedges; ++i) {
+		ofxHEMeshHalfedge h1(hstart + 2*i);
+		ofxHEMeshHalfedge h1o(hstart + 2*i + 1);
+		ofxHEMeshVertex v1 = edgeVertices[2*i];
+		ofxHEMeshVertex v2 = edgeVertices[2*i+1];
+		setHalfedgeVertex(h1, v2);
+		setHalfedgeVertex(h1o, v1);
+		setVertexHalfedge(v2, h1);
+		setVertexHalfedge(v1, h1o);
+	}
 	
-		const vector<ofxHEMeshVertex>& face = faces[i];
-		int nv = int(face.size());
-		vector<ofxHEMeshHalfedge> halfedges;
-		for(j=0; j < nv; ++j) {
-			ofxHEMeshVertex v1 = face[j];
-			ofxHEMeshVertex v2 = face[WRAP_NEXT(j, nv)];
-			bool didSwap = orderVertices(v1, v2);
-			auto iter = explicitEdgeMap.find(ExplicitEdge(v1, v2));
-			if(didSwap) halfedges.push_back(halfedgeOpposite(iter->second));
-			else halfedges.push_back(iter->second);
-		}
+	// Link Halfedges around faces
+	int fstart = faceProperties.size();
+	faceProperties.resize(fstart + nfaces);
+	for(i=0; i < nfaces; ++i) {
+		ofxHEMeshFace f(fstart + i);
+		int offset = faces.faceBegin(i);
+		int nv = faces.faceBegin(i+1) - offset;
 		
-		setFaceHalfedge(f, halfedges[0]);
+		setFaceHalfedge(f, cornerHalfedges[offset]);
 		for(j=0; j < nv; ++j) {
-			ofxHEMeshHalfedge h1 = halfedges[j];
-			ofxHEMeshHalfedge h2 = halfedges[WRAP_NEXT(j, nv)];			
-			allHalfedges.erase(allHalfedges.find(h1));
+			ofxHEMeshHalfedge h1 = cornerHalfedges[offset + j];
+			ofxHEMeshHalfedge h2 = cornerHalfedges[offset + WRAP_NEXT(j, nv)];
 			setHalfedgeNext(h1, h2);
 			setHalfedgePrev(h2, h1);
 			setHalfedgeFace(h1, f);
 		}
 	}
 	
-	set<ofxHEMeshHalfedge>::const_iterator ahit = allHalfedges.begin();
-	set<ofxHEMeshHalfedge>::const_iterator ahite = allHalfedges.end();
-	map<ofxHEMeshVertex, ofxHEMeshHalfedge> sinks;
-	map<ofxHEMeshVertex, ofxHEMeshHalfedge> sources;
-	for(; ahit != ahite; ++ahit) {
-		ofxHEMeshHalfedge h = *ahit;
-		sinks.insert(std::pair<ofxHEMeshVertex, ofxHEMeshHalfedge>(halfedgeSink(h), h));
-		sources.insert(std::pair<ofxHEMeshVertex, ofxHEMeshHalfedge>(halfedgeSource(h), h));
+	// Link boundary loops.  For each vertex, the lowest-indexed new
+	// boundary halfedge entering and leaving it are joined.
+	int nvertices = vertexProperties.size();
+	vector<ofxHEMeshHalfedge> sinks(nvertices);
+	vector<ofxHEMeshHalfedge> sources(nvertices);
+	for(i=hstart; i < hstart + 2*nedges; ++i) {
+		ofxHEMeshHalfedge h(i);
+		if(halfedgeIsOnBoundary(h)) {
+			ofxHEMeshVertex vsink = halfedgeSink(h);
+			ofxHEMeshVertex vsource = halfedgeSource(h);
+			if(!sinks[vsink.idx].isValid()) sinks[vsink.idx] = h;
+			if(!sources[vsource.idx].isValid()) sources[vsource.idx] = h;
+		}
 	}
 	
-	map<ofxHEMeshVertex, ofxHEMeshHalfedge>::const_iterator sink_it = sinks.begin();
-	map<ofxHEMeshVertex, ofxHEMeshHalfedge>::const_iterator sink_ite = sinks.end();
-	map<ofxHEMeshVertex, ofxHEMeshHalfedge>::const_iterator source_ite = sources.end();
-	for(; sink_it != sink_ite; ++sink_it) {
-		map<ofxHEMeshVertex, ofxHEMeshHalfedge>::const_iterator source_it = sources.find(sink_it->first);
-		if(source_it == source_ite) {
-			std::cout << halfedgeString(sink_it->second) << " doesn't have a source\n";
+	for(i=0; i < nvertices; ++i) {
+		if(!sinks[i].isValid()) continue;
+		if(!sources[i].isValid()) {
+			std::cout << halfedgeString(sinks[i]) << " doesn't have a source\n";
 			continue;
 		}
-		setHalfedgeNext(sink_it->second, source_it->second);
-		setHalfedgePrev(source_it->second, sink_it->second);
+		setHalfedgeNext(sinks[i], sources[i]);
+		setHalfedgePrev(sources[i], sinks[i]);
+	}
+	topologyDirty = true;
+}
+
+struct ofxHEMeshCornerKey {
+	uint64_t key;
+	int corner;
+};
+
+static bool cornerKeyLess(const ofxHEMeshCornerKey& a, const ofxHEMeshCornerKey& b) {
+	return a.key < b.key || (a.key == b.key && a.corner < b.corner);
+}
+
+static void atomicMin(std::atomic<int>& a, int v) {
+	int cur = a.load(std::memory_order_relaxed);
+	while(v < cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+static void atomicMax(std::atomic<int>& a, int v) {
+	int cur = a.load(std::memory_order_relaxed);
+	while(v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+// Produces exactly the same element numbering and links as buildFacesSerial
+// for manifold input: edges are numbered by the first corner that uses them,
+// vertices link to their newest incoming halfedge and boundary loops join
+// the lowest-indexed halfedges at each vertex.
+void ofxHEMesh::buildFacesParallel(const FaceList& faces) {
+	const ofxHEMeshVertex *faceVertices = faces.vertices;
+	int nfaces = faces.nfaces;
+	int ncorners = faces.numCorners();
+	int hstart = halfedgeProperties.size();
+	int nchunks = hemesh::getNumThreads();
+	
+	// Generate an edge key for each face corner
+	vector<ofxHEMeshCornerKey> keys(ncorners);
+	hemesh::parallelFor(0, nfaces, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			int offset = faces.faceBegin(i);
+			int nv = faces.faceBegin(i+1) - offset;
+			for(int j=0; j < nv; ++j) {
+				ofxHEMeshVertex v1 = faceVertices[offset + j];
+				ofxHEMeshVertex v2 = faceVertices[offset + WRAP_NEXT(j, nv)];
+				keys[offset+j].key = ofxHEMeshEdgeHash::key(v1.idx, v2.idx);
+				keys[offset+j].corner = offset+j;
+			}
+		}
+	});
+	hemesh::parallelSort(keys, cornerKeyLess);
+	
+	// Split the sorted keys into chunks that don't straddle a run of equal keys
+	vector<int> runChunks(nchunks+1);
+	for(int i=0; i <= nchunks; ++i) {
+		int k = int((long long)ncorners*i/nchunks);
+		while(k > 0 && k < ncorners && keys[k].key == keys[k-1].key) ++k;
+		runChunks[i] = k;
+	}
+	
+	// Mark the first corner using each edge
+	vector<int> cornerEdge(ncorners, 0);
+	hemesh::parallelFor(0, nchunks, [&](int b, int e) {
+		for(int c=b; c < e; ++c) {
+			for(int k=runChunks[c]; k < runChunks[c+1]; ++k) {
+				if(k == runChunks[c] || keys[k].key != keys[k-1].key) {
+					cornerEdge[keys[k].corner] = 1;
+				}
+			}
+		}
+	}, 1);
+	
+	// Number edges in order of first appearance with a chunked prefix sum
+	vector<int> chunkEdges(nchunks+1, 0);
+	hemesh::parallelFor(0, nchunks, [&](int b, int e) {
+		for(int c=b; c < e; ++c) {
+			int cb = int((long long)ncorners*c/nchunks);
+			int ce = int((long long)ncorners*(c+1)/nchunks);
+			int count = 0;
+			for(int k=cb; k < ce; ++k) count += cornerEdge[k];
+			chunkEdges[c+1] = count;
+		}
+	}, 1);
+	for(int c=0; c < nchunks; ++c) {
+		chunkEdges[c+1] += chunkEdges[c];
+	}
+	int nedges = chunkEdges[nchunks];
+	
+	hemesh::parallelFor(0, nchunks, [&](int b, int e) {
+		for(int c=b; c < e; ++c) {
+			int cb = int((long long)ncorners*c/nchunks);
+			int ce = int((long long)ncorners*(c+1)/nchunks);
+			int edge = chunkEdges[c];
+			for(int k=cb; k < ce; ++k) {
+				if(cornerEdge[k]) {
+					cornerEdge[k] = edge;
+					++edge;
+				}
+				else {
+					cornerEdge[k] = -1;
+				}
+			}
+		}
+	}, 1);
+	
+	// Give every corner its halfedge and record the vertices of each edge
+	vector<uint64_t> edgeKeys(nedges);
+	vector<ofxHEMeshHalfedge> cornerHalfedges(ncorners);
+	hemesh::parallelFor(0, nchunks, [&](int b, int e) {
+		for(int c=b; c < e; ++c) {
+			int k = runChunks[c];
+			while(k < runChunks[c+1]) {
+				int edge = cornerEdge[keys[k].corner];
+				int smaller = int(keys[k].key >> 32);
+				edgeKeys[edge] = keys[k].key;
+				do {
+					int corner = keys[k].corner;
+					int flip = faceVertices[corner].idx > smaller ? 1 : 0;
+					cornerHalfedges[corner] = ofxHEMeshHalfedge(hstart + 2*edge + flip);
+					++k;
+				} while(k < runChunks[c+1] && keys[k].key == keys[k-1].key);
+			}
+		}
+	}, 1);
+	
+	// Create all of the new edges in one allocation
+	addEdges(nedges);
+	ofxHEMeshProperty<ofxHEMeshHalfedgeAdjacency>& hadj = *halfedgeAdjacency;
+	hadj.unshare(hstart, hstart + 2*nedges);
+	int nvertices = vertexProperties.size();
+	vector<std::atomic<int> > newest(nvertices);
+	hemesh::parallelFor(0, nvertices, [&](int b, int e) {
+		for(int i=b; i < e; ++i) newest[i].store(ofxHEMeshNode::Invalid, std::memory_order_relaxed);
+	});
+	hemesh::parallelFor(0, nedges, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			int smaller = int(edgeKeys[i] >> 32);
+			int larger = int(edgeKeys[i] & 0xffffffff);
+			int h1 = hstart + 2*i;
+			hadj.get(h1).v = ofxHEMeshVertex(larger);
+			hadj.get(h1+1).v = ofxHEMeshVertex(smaller);
+			atomicMax(newest[larger], h1);
+			atomicMax(newest[smaller], h1+1);
+		}
+	});
+	ofxHEMeshProperty<ofxHEMeshVertexAdjacency>& vadj = *vertexAdjacency;
+	vadj.unshare(0, nvertices);
+	hemesh::parallelFor(0, nvertices, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			int h = newest[i].load(std::memory_order_relaxed);
+			if(h != ofxHEMeshNode::Invalid) vadj.get(i).he = ofxHEMeshHalfedge(h);
+		}
+	});
+	
+	// Link Halfedges around faces
+	int fstart = faceProperties.size();
+	faceProperties.resize(fstart + nfaces);
+	ofxHEMeshProperty<ofxHEMeshFaceAdjacency>& fadj = *faceAdjacency;
+	fadj.unshare(fstart, fstart + nfaces);
+	hemesh::parallelFor(0, nfaces, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			ofxHEMeshFace f(fstart + i);
+			int offset = faces.faceBegin(i);
+			int nv = faces.faceBegin(i+1) - offset;
+			fadj.get(f.idx).he = cornerHalfedges[offset];
+			for(int j=0; j < nv; ++j) {
+				ofxHEMeshHalfedge h1 = cornerHalfedges[offset + j];
+				ofxHEMeshHalfedge h2 = cornerHalfedges[offset + WRAP_NEXT(j, nv)];
+				hadj.get(h1.idx).next = h2;
+				hadj.get(h2.idx).prev = h1;
+				hadj.get(h1.idx).f = f;
+			}
+		}
+	});
+	
+	// Link boundary loops through the lowest-indexed boundary halfedges at each vertex
+	vector<std::atomic<int> > sinks(nvertices);
+	vector<std::atomic<int> > sources(nvertices);
+	hemesh::parallelFor(0, nvertices, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			sinks[i].store(INT_MAX, std::memory_order_relaxed);
+			sources[i].store(INT_MAX, std::memory_order_relaxed);
+		}
+	});
+	hemesh::parallelFor(hstart, hstart + 2*nedges, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			if(!hadj.get(i).f.isValid()) {
+				atomicMin(sinks[hadj.get(i).v.idx], i);
+				atomicMin(sources[hadj.get(i^1).v.idx], i);
+			}
+		}
+	});
+	
+	vector<unsigned char> missingSource(nvertices, 0);
+	hemesh::parallelFor(0, nvertices, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			int sink = sinks[i].load(std::memory_order_relaxed);
+			int source = sources[i].load(std::memory_order_relaxed);
+			if(sink == INT_MAX) continue;
+			if(source == INT_MAX) {
+				missingSource[i] = 1;
+				continue;
+			}
+			hadj.get(sink).next = ofxHEMeshHalfedge(source);
+			hadj.get(source).prev = ofxHEMeshHalfedge(sink);
+		}
+	});
+	for(int i=0; i < nvertices; ++i) {
+		if(missingSource[i]) {
+			std::cout << halfedgeString(ofxHEMeshHalfedge(sinks[i].load())) << " doesn't have a source\n";
+		}
+	}
+	
+	// Adjacency was written directly so bring the live sets up to date
+	liveVertices.rebuild(0, nvertices, [&](int i) { return vadj.get(i).he.isValid(); });
+	liveEdges.rebuild(hstart/2, hstart/2 + nedges, [&](int i) { return true; });
+	liveFaces.rebuild(fstart, fstart + nfaces, [&](int i) { return true; });
+	if(changes.isTracking()) {
+		for(int i=0; i < nfaces; ++i) {
+			changes.markFace(fstart+i);
+		}
+		for(int i=0; i < ncorners; ++i) {
+			changes.markVertex(faceVertices[i].idx);
+		}
 	}
 	topologyDirty = true;
 }
 
 
 ofxHEMeshFace ofxHEMesh::addFace(const ExplicitFace& vertices) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::AddFace);
+	if(scope.hasCommand()) {
+		for(int i=0; i < vertices.size(); ++i) scope.addInt(vertices[i].idx);
+	}
 	vector<ofxHEMeshHalfedge> halfedges;
 	vector<bool> exists;
 	
@@ -858,8 +1183,7 @@ ofxHEMeshFace ofxHEMesh::addFace(const ExplicitFace& vertices) {
 		exists.push_back(hExists);
 	}
 	
-	ofxHEMeshFace f(faceProperties.size());
-	faceAdjacency->extend();
+	ofxHEMeshFace f = allocateFace();
 	topologyDirty = true;
 
 	// set the face of halfedges and create any new ones necessary
@@ -929,8 +1253,30 @@ ofxHEMeshFace ofxHEMesh::addFace(const ExplicitFace& vertices) {
 
 void ofxHEMesh::removeVertex(ofxHEMeshVertex v) {
 	if(!v.isValid()) throw std::invalid_argument("attempting to remove invalid vertex");
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::RemoveVertex, v.idx);
+	flushChanges();
 	notifyGeometryListeners(v, &GeometryListener::vertexWillBeRemoved);
-	
+	detachVertex(v);
+}
+
+void ofxHEMesh::removeVertices(const vector<ofxHEMeshVertex>& vertices) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::RemoveVertices);
+	if(scope.hasCommand()) {
+		for(int i=0; i < vertices.size(); ++i) scope.addInt(vertices[i].idx);
+	}
+	for(int i=0; i < vertices.size(); ++i) {
+		if(!vertices[i].isValid()) throw std::invalid_argument("attempting to remove invalid vertex");
+	}
+	flushChanges();
+	for(int i=0; i < geometryListeners.size(); ++i) {
+		geometryListeners[i]->verticesWillBeRemoved(vertices);
+	}
+	for(int i=0; i < vertices.size(); ++i) {
+		detachVertex(vertices[i]);
+	}
+}
+
+void ofxHEMesh::detachVertex(ofxHEMeshVertex v) {
 	ofxHEMeshHalfedge h = vertexHalfedge(v);
 	if(h.isValid()) {
 		do {
@@ -943,12 +1289,17 @@ void ofxHEMesh::removeVertex(ofxHEMeshVertex v) {
 		while(h.isValid());
 	}
 	setVertexHalfedge(v, ofxHEMeshHalfedge());
+	if(allocationPolicy == RecycleElements) {
+		pushFree(VertexElements, v.idx);
+	}
 	topologyDirty = true;
 	geometryDirty = true;
 }
 
 void ofxHEMesh::removeAllVertices() {
-	vertexAdjacency->clear();
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::RemoveAllVertices);
+	flushChanges();
+	clearVertices();
 	topologyDirty = true;
 	geometryDirty = true;
 	notifyGeometryListeners(ofxHEMeshVertex(), &GeometryListener::verticesCleared);
@@ -956,6 +1307,7 @@ void ofxHEMesh::removeAllVertices() {
 
 
 bool ofxHEMesh::removeHalfedge(ofxHEMeshHalfedge h) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::RemoveHalfedge, h.idx);
 	ofxHEMeshFace f = halfedgeFace(h);
 	ofxHEMeshHalfedge ho = halfedgeOpposite(h);
 	ofxHEMeshFace f2 = halfedgeFace(ho);
@@ -990,8 +1342,9 @@ bool ofxHEMesh::removeHalfedge(ofxHEMeshHalfedge h) {
 	else {
 		setVertexHalfedge(v, h2p);
 		setVertexHalfedge(v2, h1p);
-		setFaceHalfedge(f, ofxHEMeshHalfedge());
-		setFaceHalfedge(f2, h1p);
+		// either side may be the boundary, which has no face
+		if(f.isValid()) setFaceHalfedge(f, ofxHEMeshHalfedge());
+		if(f2.isValid()) setFaceHalfedge(f2, h1p);
 	
 		// set all halfedges to the common face
 		ofxHEMeshHalfedge hh = h1p;
@@ -1004,13 +1357,21 @@ bool ofxHEMesh::removeHalfedge(ofxHEMeshHalfedge h) {
 }
 
 void ofxHEMesh::eraseHalfedge(ofxHEMeshHalfedge h) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::EraseHalfedge, h.idx);
 	ofxHEMeshHalfedge ho = halfedgeOpposite(h);
-	halfedgeAdjacency->set(h.idx, ofxHEMeshHalfedgeAdjacency());
-	halfedgeAdjacency->set(ho.idx, ofxHEMeshHalfedgeAdjacency());
+	if(allocationPolicy == RecycleElements && (halfedgeVertex(h).isValid() || halfedgeVertex(ho).isValid())) {
+		pushFree(HalfedgeElements, h.idx/2);
+	}
+	markHalfedgeChanged(h);
+	markHalfedgeChanged(ho);
+	writeHalfedgeAdjacency(h, ofxHEMeshHalfedgeAdjacency());
+	writeHalfedgeAdjacency(ho, ofxHEMeshHalfedgeAdjacency());
+	liveEdges.set(h.idx/2, false);
 	topologyDirty = true;
 }
 
 void ofxHEMesh::removeFace(ofxHEMeshFace f) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::RemoveFace, f.idx);
 	ofxHEMeshHalfedge h = faceHalfedge(f);
 	ofxHEMeshHalfedge hstart = h;
 	do {
@@ -1019,10 +1380,14 @@ void ofxHEMesh::removeFace(ofxHEMeshFace f) {
 	}
 	while(h != hstart);
 	setFaceHalfedge(f, ofxHEMeshHalfedge());
+	if(allocationPolicy == RecycleElements) {
+		pushFree(FaceElements, f.idx);
+	}
 	topologyDirty = true;
 }
 
 bool ofxHEMesh::removeFaceIfDegenerate(ofxHEMeshFace f) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::RemoveFaceIfDegenerate, f.idx);
 	bool degenerate = faceIsDegenerate(f);
 	if(degenerate) {
 		ofxHEMeshHalfedge hprev = faceHalfedge(f);
@@ -1034,6 +1399,125 @@ bool ofxHEMesh::removeFaceIfDegenerate(ofxHEMeshFace f) {
 	return degenerate;
 }
 
+static inline void remapNode(ofxHEMeshNode& node, const vector<int>& indexMap) {
+	if(node.isValid()) {
+		node.idx = node.idx < int(indexMap.size()) ? indexMap[node.idx] : ofxHEMeshNode::Invalid;
+	}
+}
+
+// Apply remap to the first n items of prop, which hold T
+template<typename T, typename Fn>
+static void remapItems(ofxHEMeshPropertyBase *prop, Fn remap) {
+	int n = prop->size();
+	for(int b=0; b < prop->numBlocks() && (b << ofxHEMeshPropertyBase::BlockBits) < n; ++b) {
+		T *values = (T *)prop->rawBlock(b);
+		int nb = std::min(int(ofxHEMeshPropertyBase::BlockSize), n - (b << ofxHEMeshPropertyBase::BlockBits));
+		for(int i=0; i < nb; ++i) remap(values[i]);
+	}
+}
+
+// Renumber the element references held by properties with an index or adjacency type
+static void remapProperties(ofxHEMeshPropertySet& properties, const ofxHEMesh::CompactionMaps& maps) {
+	for(int j=0; j < properties.getNumProperties(); ++j) {
+		ofxHEMeshPropertyBase *prop = properties.getProperty(j);
+		if(!prop) continue;
+		switch(prop->getType()) {
+			case ofxHEMeshPropertyBase::VertexIndex:
+				remapItems<ofxHEMeshVertex>(prop, [&](ofxHEMeshVertex& v) { remapNode(v, maps.vertices); });
+				break;
+			case ofxHEMeshPropertyBase::HalfedgeIndex:
+				remapItems<ofxHEMeshHalfedge>(prop, [&](ofxHEMeshHalfedge& h) { remapNode(h, maps.halfedges); });
+				break;
+			case ofxHEMeshPropertyBase::FaceIndex:
+				remapItems<ofxHEMeshFace>(prop, [&](ofxHEMeshFace& f) { remapNode(f, maps.faces); });
+				break;
+			case ofxHEMeshPropertyBase::VertexAdjacency:
+				remapItems<ofxHEMeshVertexAdjacency>(prop, [&](ofxHEMeshVertexAdjacency& adj) {
+					remapNode(adj.he, maps.halfedges);
+				});
+				break;
+			case ofxHEMeshPropertyBase::HalfedgeAdjacency:
+				remapItems<ofxHEMeshHalfedgeAdjacency>(prop, [&](ofxHEMeshHalfedgeAdjacency& adj) {
+					remapNode(adj.v, maps.vertices);
+					remapNode(adj.f, maps.faces);
+					remapNode(adj.prev, maps.halfedges);
+					remapNode(adj.next, maps.halfedges);
+				});
+				break;
+			case ofxHEMeshPropertyBase::FaceAdjacency:
+				remapItems<ofxHEMeshFaceAdjacency>(prop, [&](ofxHEMeshFaceAdjacency& adj) {
+					remapNode(adj.he, maps.halfedges);
+				});
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+ofxHEMesh::CompactionMaps ofxHEMesh::compact() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::Compact);
+	flushChanges();
+	CompactionMaps maps;
+	
+	int nv = getNumVertices();
+	int nlivev = 0;
+	maps.vertices.resize(nv);
+	for(int i=0; i < nv; ++i) {
+		maps.vertices[i] = vertexHalfedge(ofxHEMeshVertex(i)).isValid() ? nlivev++ : -1;
+	}
+	
+	// Halfedges move in pairs so opposites stay adjacent
+	int ne = getNumEdges();
+	int nlivee = 0;
+	vector<int> edgeMap(ne);
+	maps.halfedges.resize(ne*2);
+	for(int i=0; i < ne; ++i) {
+		ofxHEMeshHalfedge h(i*2);
+		bool live = halfedgeVertex(h).isValid() || halfedgeVertex(halfedgeOpposite(h)).isValid();
+		edgeMap[i] = live ? nlivee++ : -1;
+		maps.halfedges[i*2] = live ? edgeMap[i]*2 : -1;
+		maps.halfedges[i*2+1] = live ? edgeMap[i]*2+1 : -1;
+	}
+	
+	int nf = getNumFaces();
+	int nlivef = 0;
+	maps.faces.resize(nf);
+	for(int i=0; i < nf; ++i) {
+		maps.faces[i] = faceHalfedge(ofxHEMeshFace(i)).isValid() ? nlivef++ : -1;
+	}
+	
+	vertexProperties.compactItems(maps.vertices, nlivev);
+	halfedgeProperties.compactItems(maps.halfedges, nlivee*2);
+	edgeProperties.compactItems(edgeMap, nlivee);
+	faceProperties.compactItems(maps.faces, nlivef);
+	
+	remapProperties(vertexProperties, maps);
+	remapProperties(halfedgeProperties, maps);
+	remapProperties(edgeProperties, maps);
+	remapProperties(faceProperties, maps);
+	clearFreeLists();
+	rebuildLiveSets();
+	
+	topologyDirty = true;
+	geometryDirty = true;
+	for(int i=0; i < geometryListeners.size(); ++i) {
+		geometryListeners[i]->verticesCompacted(maps.vertices);
+	}
+	return maps;
+}
+
+ofxHEMesh::Fragmentation ofxHEMesh::getFragmentation() const {
+	Fragmentation stats;
+	stats.numVertices = getNumVertices();
+	stats.numHalfedges = getNumHalfedges();
+	stats.numFaces = getNumFaces();
+	stats.numLiveVertices = getNumLiveVertices();
+	stats.numLiveHalfedges = getNumLiveHalfedges();
+	stats.numLiveFaces = getNumLiveFaces();
+	return stats;
+}
+
 int ofxHEMesh::getNumVertices() const {
 	return (int)vertexAdjacency->size();
 }
@@ -1051,12 +1535,8 @@ int ofxHEMesh::getNumFaces() const {
 }
 
 ofxHEMeshFaceIterator ofxHEMesh::facesBegin() const {
-	ofxHEMeshFace f(0);
-	if(faceAdjacency->size() > 0) {
-		while(!faceHalfedge(f).isValid()) {
-			++f.idx;
-		}
-	}
+	int n = faceAdjacency->size();
+	ofxHEMeshFace f(liveFaces.next(0, n));
 	return ofxHEMeshFaceIterator(this, f);
 }
 
@@ -1065,12 +1545,8 @@ ofxHEMeshFaceIterator ofxHEMesh::facesEnd() const {
 }
 
 ofxHEMeshEdgeIterator ofxHEMesh::edgesBegin() const {
-	ofxHEMeshHalfedge h(0);
-	if(halfedgeAdjacency->size() > 0) {
-		while(!halfedgeFace(h).isValid()) {
-			++h.idx;
-		}
-	}
+	int n = getNumEdges();
+	ofxHEMeshHalfedge h(2*liveEdges.next(0, n));
 	return ofxHEMeshEdgeIterator(this, h);
 }
 
@@ -1079,12 +1555,8 @@ ofxHEMeshEdgeIterator ofxHEMesh::edgesEnd() const {
 }
 
 ofxHEMeshVertexIterator ofxHEMesh::verticesBegin() const {
-	ofxHEMeshVertex v(0);
-	if(vertexAdjacency->size() > 0) {
-		while(!vertexHalfedge(v).isValid()) {
-			++v.idx;
-		}
-	}
+	int n = vertexAdjacency->size();
+	ofxHEMeshVertex v(liveVertices.next(0, n));
 	return ofxHEMeshVertexIterator(this, v);
 }
 
@@ -1105,22 +1577,28 @@ ofxHEMeshVertexCirculator ofxHEMesh::vertexCirculate(const ofxHEMeshVertex& v) c
 }
 
 ofxHEMeshHalfedge ofxHEMesh::vertexHalfedge(ofxHEMeshVertex v) const {
-	return vertexAdjacency->get(v.idx).he;
+	return readOnly(vertexAdjacency).get(v.idx).he;
 }
 
 
 void ofxHEMesh::setVertexHalfedge(ofxHEMeshVertex v, ofxHEMeshHalfedge h) {
+	if(journaling()) journal->recordAdjacency(ofxHEMeshJournal::SetVertexHalfedge, v.idx, vertexHalfedge(v).idx, h.idx);
 	vertexAdjacency->get(v.idx).he = h;
+	liveVertices.set(v.idx, h.isValid());
+	changes.markVertex(v.idx);
 }
 
 
 ofxHEMeshHalfedge ofxHEMesh::faceHalfedge(ofxHEMeshFace f) const {
-	return faceAdjacency->get(f.idx).he;
+	return readOnly(faceAdjacency).get(f.idx).he;
 }
 
 
 void ofxHEMesh::setFaceHalfedge(ofxHEMeshFace f, ofxHEMeshHalfedge h) {
+	if(journaling()) journal->recordAdjacency(ofxHEMeshJournal::SetFaceHalfedge, f.idx, faceHalfedge(f).idx, h.idx);
 	faceAdjacency->get(f.idx).he = h;
+	liveFaces.set(f.idx, h.isValid());
+	changes.markFace(f.idx);
 }
 
 
@@ -1131,22 +1609,55 @@ ofxHEMeshHalfedge ofxHEMesh::halfedgeOpposite(ofxHEMeshHalfedge h) const {
 
 
 ofxHEMeshVertex ofxHEMesh::halfedgeVertex(ofxHEMeshHalfedge h) const {
-	return halfedgeAdjacency->get(h.idx).v;
+	return readOnly(halfedgeAdjacency).get(h.idx).v;
 }
 
 
 void ofxHEMesh::setHalfedgeVertex(ofxHEMeshHalfedge h, ofxHEMeshVertex v) {
+	if(journaling()) journal->recordAdjacency(ofxHEMeshJournal::SetHalfedgeVertex, h.idx, halfedgeVertex(h).idx, v.idx);
+	markHalfedgeChanged(h);
 	halfedgeAdjacency->get(h.idx).v = v;
+	changes.markVertex(v.idx);
+	if(v.isValid()) liveEdges.set(h.idx/2, true);
+	else updateEdgeLiveness(h.idx/2);
+}
+
+void ofxHEMesh::updateEdgeLiveness(int e) {
+	ofxHEMeshHalfedge h(e*2);
+	liveEdges.set(e, halfedgeVertex(h).isValid() || halfedgeVertex(halfedgeOpposite(h)).isValid());
+}
+
+// Recompute liveness from the adjacency after it was written in bulk
+void ofxHEMesh::rebuildLiveSets() {
+	const ofxHEMeshProperty<ofxHEMeshVertexAdjacency>& vadj = *vertexAdjacency;
+	const ofxHEMeshProperty<ofxHEMeshHalfedgeAdjacency>& hadj = *halfedgeAdjacency;
+	const ofxHEMeshProperty<ofxHEMeshFaceAdjacency>& fadj = *faceAdjacency;
+	liveVertices.rebuild(0, getNumVertices(), [&](int i) { return vadj.get(i).he.isValid(); });
+	liveEdges.rebuild(0, getNumEdges(), [&](int i) { return hadj.get(2*i).v.isValid() || hadj.get(2*i+1).v.isValid(); });
+	liveFaces.rebuild(0, getNumFaces(), [&](int i) { return fadj.get(i).he.isValid(); });
+	changes.markAll();
 }
 
 
 ofxHEMeshFace ofxHEMesh::halfedgeFace(ofxHEMeshHalfedge h) const {
-	return halfedgeAdjacency->get(h.idx).f;
+	return readOnly(halfedgeAdjacency).get(h.idx).f;
 }
 
 
 void ofxHEMesh::setHalfedgeFace(ofxHEMeshHalfedge h, ofxHEMeshFace f) {
+	if(journaling()) journal->recordAdjacency(ofxHEMeshJournal::SetHalfedgeFace, h.idx, halfedgeFace(h).idx, f.idx);
+	markHalfedgeChanged(h);
 	halfedgeAdjacency->get(h.idx).f = f;
+	changes.markFace(f.idx);
+}
+
+// Log the halfedge's sink and face, whose neighbourhoods it's part of
+void ofxHEMesh::markHalfedgeChanged(ofxHEMeshHalfedge h) {
+	if(changes.isTracking()) {
+		const ofxHEMeshHalfedgeAdjacency& adj = readOnly(halfedgeAdjacency).get(h.idx);
+		changes.markVertex(adj.v.idx);
+		changes.markFace(adj.f.idx);
+	}
 }
 
 
@@ -1161,21 +1672,26 @@ ofxHEMeshVertex ofxHEMesh::halfedgeSink(ofxHEMeshHalfedge h) const {
 
 
 ofxHEMeshHalfedge ofxHEMesh::halfedgeNext(ofxHEMeshHalfedge h) const {
-	return halfedgeAdjacency->get(h.idx).next;
+	return readOnly(halfedgeAdjacency).get(h.idx).next;
 }
 
 
 void ofxHEMesh::setHalfedgeNext(ofxHEMeshHalfedge h, ofxHEMeshHalfedge next) {
+	if(journaling()) journal->recordAdjacency(ofxHEMeshJournal::SetHalfedgeNext, h.idx, halfedgeNext(h).idx, next.idx);
+	markHalfedgeChanged(h);
 	halfedgeAdjacency->get(h.idx).next = next;
 }
 
 
 ofxHEMeshHalfedge ofxHEMesh::halfedgePrev(ofxHEMeshHalfedge h) const {
-	return halfedgeAdjacency->get(h.idx).prev;
+	return readOnly(halfedgeAdjacency).get(h.idx).prev;
 }
 
 
 void ofxHEMesh::setHalfedgePrev(ofxHEMeshHalfedge h, ofxHEMeshHalfedge prev) {
+	if(journaling()) journal->recordAdjacency(ofxHEMeshJournal::SetHalfedgePrev, h.idx, halfedgePrev(h).idx, prev.idx);
+	markHalfedgeChanged(h);
+	markHalfedgeChanged(halfedgeOpposite(h));
 	halfedgeAdjacency->get(h.idx).prev = prev;
 }
 
@@ -1226,9 +1742,14 @@ void ofxHEMesh::linkHalfedges(ofxHEMeshHalfedge prev, ofxHEMeshHalfedge next) {
 }
 
 void ofxHEMesh::swapHalfedgeAdjacency(ofxHEMeshHalfedge src, ofxHEMeshHalfedge dst) {
-	ofxHEMeshHalfedgeAdjacency tmp = halfedgeAdjacency->get(src.idx);
-	halfedgeAdjacency->set(src.idx, halfedgeAdjacency->get(dst.idx));
-	halfedgeAdjacency->set(dst.idx, tmp);
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::SwapHalfedgeAdjacency, src.idx, dst.idx);
+	markHalfedgeChanged(src);
+	markHalfedgeChanged(dst);
+	ofxHEMeshHalfedgeAdjacency tmp = readOnly(halfedgeAdjacency).get(src.idx);
+	writeHalfedgeAdjacency(src, readOnly(halfedgeAdjacency).get(dst.idx));
+	writeHalfedgeAdjacency(dst, tmp);
+	updateEdgeLiveness(src.idx/2);
+	updateEdgeLiveness(dst.idx/2);
 	linkHalfedges(dst, halfedgeNext(dst));
 	linkHalfedges(halfedgePrev(dst), dst);
 	
@@ -1331,6 +1852,17 @@ bool ofxHEMesh::halfedgeIsInFace(ofxHEMeshFace f, ofxHEMeshHalfedge h) const {
 	return false;
 }
 
+bool ofxHEMesh::halfedgeIsOnBoundaryLoop(ofxHEMeshHalfedge h) const {
+	ofxHEMeshHalfedge hh = h;
+	// a broken loop may never return to h
+	for(int i=0; i < getNumHalfedges(); ++i) {
+		if(!hh.isValid() || halfedgeFace(hh).isValid()) return false;
+		hh = halfedgeNext(hh);
+		if(hh == h) return true;
+	}
+	return false;
+}
+
 bool ofxHEMesh::halfedgeLinksToVertex(ofxHEMeshVertex v, ofxHEMeshHalfedge h) const {
 	ofxHEMeshVertexCirculator vc = vertexCirculate(v);
 	ofxHEMeshVertexCirculator vce = vc;
@@ -1348,15 +1880,87 @@ bool ofxHEMesh::halfedgeLinksToVertex(ofxHEMeshVertex v, ofxHEMeshHalfedge h) co
 }
 
 void ofxHEMesh::vertexMove(ofxHEMeshVertex v, const Direction& dir) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::VertexMove, v.idx);
+	scope.setPoint(dir);
 	vertexMoveTo(v, vertexPoint(v)+dir);
 }
 
 void ofxHEMesh::vertexMoveTo(ofxHEMeshVertex v, const Point& p) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::VertexMoveTo, v.idx);
+	scope.setPoint(p);
+	if(changeDepth > 0) {
+		if(pendingMoveSlots.size() <= v.idx) {
+			pendingMoveSlots.resize(getNumVertices(), -1);
+		}
+		int& slot = pendingMoveSlots[v.idx];
+		if(slot >= 0) {
+			pendingPoints[slot] = p;
+		}
+		else {
+			slot = int(pendingMoves.size());
+			pendingMoves.push_back(v);
+			pendingPoints.push_back(p);
+		}
+		return;
+	}
 	notifyGeometryListeners(v, p, &GeometryListener::vertexWillBeMovedTo);
-	points->set(v.idx, p);
+	writePoint(v, p);
+	changes.markVertex(v.idx);
 	geometryDirty = true;
 }
 
+bool ofxHEMesh::readChanges(int cursor, vector<ofxHEMeshVertex>& vertices, vector<ofxHEMeshFace>& faces) {
+	vector<int> vidx, fidx;
+	bool tracked = changes.read(cursor, vidx, fidx);
+	vertices.resize(vidx.size());
+	for(int i=0; i < vidx.size(); ++i) {
+		vertices[i] = ofxHEMeshVertex(vidx[i]);
+	}
+	faces.resize(fidx.size());
+	for(int i=0; i < fidx.size(); ++i) {
+		faces[i] = ofxHEMeshFace(fidx[i]);
+	}
+	return tracked;
+}
+
+void ofxHEMesh::beginChanges() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::BeginChanges);
+	++changeDepth;
+}
+
+void ofxHEMesh::commitChanges() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::CommitChanges);
+	if(changeDepth == 0) throw std::invalid_argument("commitChanges() without beginChanges()");
+	if(changeDepth == 1) {
+		flushChanges();
+	}
+	--changeDepth;
+}
+
+// Deliver and apply the pending changes, leaving the transaction open
+void ofxHEMesh::flushChanges() {
+	if(changeDepth == 0) return;
+	
+	for(int i=0; i < pendingAdds.size(); ++i) {
+		notifyGeometryListeners(ofxHEMeshVertex(pendingAdds[i].first), pendingAdds[i].second, &GeometryListener::verticesAdded);
+	}
+	pendingAdds.clear();
+	
+	if(!pendingMoves.empty()) {
+		for(int i=0; i < geometryListeners.size(); ++i) {
+			geometryListeners[i]->verticesWillMove(pendingMoves, pendingPoints);
+		}
+		for(int i=0; i < pendingMoves.size(); ++i) {
+			writePoint(pendingMoves[i], pendingPoints[i]);
+			pendingMoveSlots[pendingMoves[i].idx] = -1;
+			changes.markVertex(pendingMoves[i].idx);
+		}
+		pendingMoves.clear();
+		pendingPoints.clear();
+		geometryDirty = true;
+	}
+}
+
 ofxHEMesh::Point ofxHEMesh::centroid() const {
 	Point c(0, 0, 0);
 	Scalar n = 0;
@@ -1371,32 +1975,22 @@ ofxHEMesh::Point ofxHEMesh::centroid() const {
 }
 
 ofxHEMesh::Scalar ofxHEMesh::meanEdgeLength() const {
-	ofxHEMeshEdgeIterator eit = edgesBegin();
-	ofxHEMeshEdgeIterator eite = edgesEnd();
-	Scalar res = 0;
-	Scalar n = 0;
-	for(; eit != eite; ++eit) {
-		res += halfedgeLength(*eit);
-		++n;
-	}
-	return res/n;
+	Scalar res = parallelReduceEdges(Scalar(0), [&](ofxHEMeshHalfedge h) {
+		return halfedgeLength(h);
+	}, std::plus<Scalar>());
+	return res/getNumLiveEdges();
 }
 
 ofxHEMesh::Scalar ofxHEMesh::edgeLengthVariance(Scalar expected) const {
-	ofxHEMeshEdgeIterator eit = edgesBegin();
-	ofxHEMeshEdgeIterator eite = edgesEnd();
-	Scalar res = 0;
-	Scalar n = 0;
-	for(; eit != eite; ++eit) {
-		Scalar v = halfedgeLength(*eit) - expected;
-		res += v*v;
-		++n;
-	}
-	return res/n;
+	Scalar res = parallelReduceEdges(Scalar(0), [&](ofxHEMeshHalfedge h) {
+		Scalar v = halfedgeLength(h) - expected;
+		return v*v;
+	}, std::plus<Scalar>());
+	return res/getNumLiveEdges();
 }
 
 ofxHEMesh::Point ofxHEMesh::vertexPoint(ofxHEMeshVertex v) const {
-	return points->get(v.idx);
+	return readOnly(points).get(v.idx);
 }
 
 ofxHEMesh::Direction ofxHEMesh::angleWeightedVertexNormal(ofxHEMeshVertex v) const {
@@ -1582,7 +2176,18 @@ ofxHEMesh::Scalar ofxHEMesh::angleAtVertex(ofxHEMeshHalfedge h) const {
 }
 
 ofxHEMesh::Scalar ofxHEMesh::halfedgeAngle(ofxHEMeshHalfedge h) const {
-
+	ofxHEMeshFace f1 = halfedgeFace(h);
+	ofxHEMeshFace f2 = halfedgeFace(halfedgeOpposite(h));
+	if(!f1.isValid() || !f2.isValid()) {
+		return 0;
+	}
+	Direction n1 = faceNormal(f1);
+	Direction n2 = faceNormal(f2);
+	Direction e = halfedgeDirection(h);
+	e.normalize();
+	Direction n12 = n1;
+	n12.cross(n2);
+	return atan2(n12.dot(e), n1.dot(n2));
 }
 
 ofxHEMesh::Direction ofxHEMesh::halfedgeRotated(ofxHEMeshHalfedge h) const {
@@ -1716,15 +2321,101 @@ bool ofxHEMesh::withinTriangle(const ofxHEMeshTriangle& tri, const Point& pt) co
 }
 
 void ofxHEMesh::clearVertices() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::ClearVertices);
+	flushChanges();
 	vertexProperties.clear();
+	liveVertices.clear();
+	changes.markAll();
+	freeVertices.clear();
 }
 
 void ofxHEMesh::clearHalfedges() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::ClearHalfedges);
 	halfedgeProperties.clear();
+	liveEdges.clear();
+	changes.markAll();
+	freeEdges.clear();
 }
 
 void ofxHEMesh::clearFaces() {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::ClearFaces);
 	faceProperties.clear();
+	liveFaces.clear();
+	changes.markAll();
+	freeFaces.clear();
+}
+
+void ofxHEMesh::clearFreeLists() {
+	freeVertices.clear();
+	freeEdges.clear();
+	freeFaces.clear();
+}
+
+ofxHEMeshPropertySet& ofxHEMesh::elementProperties(int kind) {
+	switch(kind) {
+		case VertexElements: return vertexProperties;
+		case HalfedgeElements: return halfedgeProperties;
+		case EdgeElements: return edgeProperties;
+		default: return faceProperties;
+	}
+}
+
+ofxHEMesh::FreeList& ofxHEMesh::freeList(int kind) {
+	switch(kind) {
+		case VertexElements: return freeVertices;
+		case FaceElements: return freeFaces;
+		default: return freeEdges;
+	}
+}
+
+int ofxHEMesh::popFree(ElementKind kind) {
+	int idx = freeList(kind).pop();
+	if(idx >= 0 && journaling()) journal->recordFreePop(kind, idx);
+	return idx;
+}
+
+void ofxHEMesh::pushFree(ElementKind kind, int idx) {
+	FreeList& list = freeList(kind);
+	if(journaling() && (idx >= int(list.freed.size()) || !list.freed[idx])) {
+		journal->recordFreePush(kind, idx);
+	}
+	list.push(idx);
+}
+
+void ofxHEMesh::resetElement(ElementKind kind, int idx) {
+	if(journaling()) journal->recordReset(kind, idx);
+	elementProperties(kind).resetItem(idx);
+}
+
+void ofxHEMesh::extendElements(ElementKind kind, int n) {
+	ofxHEMeshPropertySet& properties = elementProperties(kind);
+	if(journaling()) journal->recordSize(kind, properties.size(), properties.size()+n);
+	if(n == 1) properties.extend();
+	else properties.extend(n);
+}
+
+void ofxHEMesh::writeHalfedgeAdjacency(ofxHEMeshHalfedge h, const ofxHEMeshHalfedgeAdjacency& adj) {
+	if(journaling()) {
+		const ofxHEMeshHalfedgeAdjacency& old = readOnly(halfedgeAdjacency).get(h.idx);
+		journal->recordAdjacency(ofxHEMeshJournal::SetHalfedgeVertex, h.idx, old.v.idx, adj.v.idx);
+		journal->recordAdjacency(ofxHEMeshJournal::SetHalfedgeFace, h.idx, old.f.idx, adj.f.idx);
+		journal->recordAdjacency(ofxHEMeshJournal::SetHalfedgeNext, h.idx, old.next.idx, adj.next.idx);
+		journal->recordAdjacency(ofxHEMeshJournal::SetHalfedgePrev, h.idx, old.prev.idx, adj.prev.idx);
+	}
+	halfedgeAdjacency->set(h.idx, adj);
+}
+
+void ofxHEMesh::writePoint(ofxHEMeshVertex v, const Point& p) {
+	if(journaling()) journal->recordPoint(v.idx, readOnly(points).get(v.idx), p);
+	points->set(v.idx, p);
+}
+
+void ofxHEMesh::setAllocationPolicy(AllocationPolicy policy) {
+	ofxHEMeshJournal::Scope scope(*this, ofxHEMeshJournal::SetAllocationPolicy, int(policy));
+	allocationPolicy = policy;
+	if(policy == AppendElements) {
+		clearFreeLists();
+	}
 }
 
 string ofxHEMesh::halfedgeString(ofxHEMeshHalfedge h) const {
@@ -1789,7 +2480,7 @@ bool ofxHEMesh::verifyConnectivity() const {
 						halfedgeNext(h).idx << "(" << halfedgeString(halfedgeNext(h)) << ")\n";
 				res = false;
 			}
-			if(!halfedgeIsInFace(halfedgeFace(h), h)) {
+			if(halfedgeFace(h).isValid() ? !halfedgeIsInFace(halfedgeFace(h), h) : !halfedgeIsOnBoundaryLoop(h)) {
 				std::cout << h.idx << "(" << halfedgeString(h) << ") is not in face " << halfedgeFace(h).idx << "\n";
 				res = false;
 			}
@@ -2,7 +2,11 @@
 #include "ofxHEMeshPropertySet.h"
 #include "ofxHEMeshAdjacency.h"
 #include "ofxHEMeshIterators.h"
-#include "ofMain.h"
+#include "ofxHEMeshLiveSet.h"
+#include "ofxHEMeshChangeLog.h"
+#include "ofxHEMeshParallel.h"
+#include "ofxHEMeshKernel.h"
+#include "ofxHEMeshPlatform.h"
 #include <vector>
 #include <map>
 #include <set>
@@ -17,44 +21,152 @@ using std::map;
 using std::set;
 using std::string;
 
+OFX_HEMESH_PROPERTY_TYPE(ofVec3f, Vec3f)
+OFX_HEMESH_PROPERTY_TYPE(ofxHEMeshVertex, VertexIndex)
+OFX_HEMESH_PROPERTY_TYPE(ofxHEMeshHalfedge, HalfedgeIndex)
+OFX_HEMESH_PROPERTY_TYPE(ofxHEMeshFace, FaceIndex)
+OFX_HEMESH_PROPERTY_TYPE(ofxHEMeshVertexAdjacency, VertexAdjacency)
+OFX_HEMESH_PROPERTY_TYPE(ofxHEMeshHalfedgeAdjacency, HalfedgeAdjacency)
+OFX_HEMESH_PROPERTY_TYPE(ofxHEMeshFaceAdjacency, FaceAdjacency)
+
+class ofxHEMeshJournal;
 
 class ofxHEMesh{
 public:
 	friend class ofxHEMeshFaceIterator;
 	friend class ofxHEMeshEdgeIterator;
 	friend class ofxHEMeshVertexIterator;
+	friend class ofxHEMeshOBJLoader;
+	friend class ofxHEMeshBinaryIO;
+	friend class ofxHEMeshJournal;
+	friend class ofxHEMeshRefinement;
+	friend class ofxHEMeshCatmullClarkRefinement;
+	friend class ofxHEMeshStencilTable;
 	typedef std::pair<ofxHEMeshVertex, ofxHEMeshVertex> ExplicitEdge;
 	typedef vector<ofxHEMeshVertex> ExplicitFace;
 	
+	// Copies and moves take the elements, properties and allocation state.
+	// Geometry listeners, change cursors, the journal and open transactions
+	// belong to the mesh object and stay where they are, and so do its property
+	// objects: copy assignment shares the source's blocks, which is O(#blocks),
+	// and moves and swap() exchange the properties' blocks in O(#properties)
+	// (see ofxHEMeshPropertySet::assign() and swapContents()).  Properties only
+	// the destination has are kept with default values, so they aren't part of
+	// the copy.  When a mesh's contents are replaced its listeners are told the
+	// vertices were cleared and added, and its cursors see everything as changed.
 	ofxHEMesh();
+	ofxHEMesh(const ofxHEMesh& src);
+	// Leaves src empty
+	ofxHEMesh(ofxHEMesh&& src);
 	~ofxHEMesh() {}
 	
 	ofxHEMesh& operator=(const ofxHEMesh& src);
+	// Frees this mesh's old contents and leaves src empty
+	ofxHEMesh& operator=(ofxHEMesh&& src);
+	// Exchange contents without copying items
+	void swap(ofxHEMesh& other);
+	// Copy sharing this mesh's property blocks, which are only copied as either
+	// mesh writes to them.  It can be read from other threads while this mesh
+	// keeps changing, but has to be taken on the thread changing this mesh.
+	ofxHEMesh snapshot() const;
 	
 
 	/////////////////////////////////////////////////////////
 	// Geometric quantities
-	typedef float Scalar;
-	typedef ofVec3f Point;
-	typedef ofVec3f Direction;
+	// Points are stored with the float kernel, ofxHEMeshKernelGeometry computes
+	// with other kernels, see ofxHEMeshKernel.h
+	typedef ofxHEMeshFloatKernel Kernel;
+	typedef Kernel::Scalar Scalar;
+	typedef Kernel::Point Point;
+	typedef Kernel::Direction Direction;
 	/////////////////////////////////////////////////////////
 
 	class GeometryListener{
 	public:
 		typedef void (GeometryListener::*MemberFn)(ofxHEMeshVertex v);
 		typedef void (GeometryListener::*MemberFnPt)(ofxHEMeshVertex v, Point p);
+		typedef void (GeometryListener::*MemberFnRange)(ofxHEMeshVertex v, int n);
 	
 		virtual void verticesCleared(ofxHEMeshVertex v) = 0;
 		virtual void vertexAdded(ofxHEMeshVertex v) = 0;
+		// Vertices v .. v+n-1 were added, see ofxHEMesh::addVertices
+		virtual void verticesAdded(ofxHEMeshVertex v, int n) {
+			for(int i=0; i < n; ++i) {
+				vertexAdded(ofxHEMeshVertex(v.idx+i));
+			}
+		}
 		virtual void vertexWillBeMovedTo(ofxHEMeshVertex v, Point p) = 0;
+		// vertices[i] will be moved to points[i], sent for a batch of moves
+		virtual void verticesWillMove(const vector<ofxHEMeshVertex>& vertices, const vector<Point>& points) {
+			for(int i=0; i < vertices.size(); ++i) {
+				vertexWillBeMovedTo(vertices[i], points[i]);
+			}
+		}
 		virtual void vertexWillBeRemoved(ofxHEMeshVertex v) = 0;
+		virtual void verticesWillBeRemoved(const vector<ofxHEMeshVertex>& vertices) {
+			for(int i=0; i < vertices.size(); ++i) {
+				vertexWillBeRemoved(vertices[i]);
+			}
+		}
+		// Vertex i is now vertexMap[i] (-1 if it was removed), see ofxHEMesh::compact
+		virtual void verticesCompacted(const vector<int>& vertexMap) {}
+	};
+	
+	// Old to new element indices produced by compact(), -1 for removed elements
+	struct CompactionMaps {
+		vector<int> vertices;
+		vector<int> halfedges;
+		vector<int> faces;
+	};
+	
+	// How slots of removed elements are treated.  AppendElements (the default)
+	// never reuses a slot so indices only grow.  RecycleElements keeps the slots
+	// freed by removeVertex, eraseHalfedge and removeFace on free lists and hands
+	// them back out from addVertex, addEdge, addFace and the local operations
+	// built on them, resetting all of their properties.  addFaces always appends.
+	enum AllocationPolicy {
+		AppendElements,
+		RecycleElements
+	};
+	
+	// The kinds of element, each with its own property set
+	enum ElementKind {
+		VertexElements,
+		HalfedgeElements,
+		EdgeElements,
+		FaceElements
+	};
+	
+	// Allocated and live element counts
+	struct Fragmentation {
+		Fragmentation()
+		: numVertices(0), numLiveVertices(0),
+			numHalfedges(0), numLiveHalfedges(0),
+			numFaces(0), numLiveFaces(0)
+		{}
+		
+		// Fraction of all element slots that hold removed elements
+		float deadFraction() const {
+			int total = numVertices + numHalfedges + numFaces;
+			int live = numLiveVertices + numLiveHalfedges + numLiveFaces;
+			return total > 0 ? float(total-live)/float(total) : 0.f;
+		}
+	
+		int numVertices;
+		int numLiveVertices;
+		int numHalfedges;
+		int numLiveHalfedges;
+		int numFaces;
+		int numLiveFaces;
 	};
 
 
 	/////////////////////////////////////////////////////////
 	// Mesh-level modifications
+	// 1-to-4 refinement of a triangle mesh, see ofxHEMeshRefinement
 	void remeshLoop();
 	void subdivideLoop();
+	// Creases come from the halfedge property "sharpness", see ofxHEMeshCatmullClarkRefinement
 	void subdivideCatmullClark();
 	void subdivideDooSabin();
 	void subdivideModifiedCornerCut(Scalar tension);
@@ -87,28 +199,65 @@ public:
 	
 	/////////////////////////////////////////////////////////
 	// Add combinatorial elements
+	// Appends all of the file's groups, see ofxHEMeshOBJLoader
 	bool loadOBJModel(string modelName);
+	// Native binary format holding the raw property arrays, see ofxHEMeshBinaryIO
+	bool saveBinary(string fileName) const;
+	bool loadBinary(string fileName);
 	void addMesh(const ofMesh& mesh);
 	void addMesh(const ofxHEMesh& hemesh);
 	ofxHEMeshVertex addVertex(const Point& p);
+	// Append n vertices in one allocation and notify listeners once.  Returns the
+	// first new vertex.  Always appends, regardless of the allocation policy.
+	ofxHEMeshVertex addVertices(const Point *pts, size_t n);
 	ofxHEMeshHalfedge addEdge();
+	// Append n unconnected edges and return the first new halfedge
+	ofxHEMeshHalfedge addEdges(size_t n);
 	void addFaces(const vector<ExplicitFace>& faces);
+	// Flattened face list: face i uses faceVertices[faceOffsets[i]] .. faceVertices[faceOffsets[i+1]-1].
+	// Throws std::invalid_argument unless the offsets run from 0 to faceVertices.size() without decreasing.
+	void addFaces(const vector<int>& faceOffsets, const vector<ofxHEMeshVertex>& faceVertices);
+	// Flattened face list where every face has faceSize vertices (e.g. all triangles).
+	// Throws std::invalid_argument if faceVertices.size() isn't a multiple of faceSize.
+	void addFaces(const vector<ofxHEMeshVertex>& faceVertices, int faceSize);
 	ofxHEMeshFace addFace(const ExplicitFace& vertices);
 	
 	// Remove combinatorial elements
 	void removeVertex(ofxHEMeshVertex v);
+	// Remove several vertices with a single verticesWillBeRemoved notification
+	void removeVertices(const vector<ofxHEMeshVertex>& vertices);
 	void removeAllVertices();
 	bool removeHalfedge(ofxHEMeshHalfedge h);
 	void eraseHalfedge(ofxHEMeshHalfedge h);
 	void removeFace(ofxHEMeshFace f);
 	bool removeFaceIfDegenerate(ofxHEMeshFace f);
 	
+	// Squeeze removed elements out of every property set and renumber all
+	// references to them.  Vertices without a halfedge count as removed, the
+	// same as for iteration.  Properties holding element indices or adjacency
+	// are remapped; other properties just move with their elements.
+	CompactionMaps compact();
+	Fragmentation getFragmentation() const;
+	
+	void setAllocationPolicy(AllocationPolicy policy);
+	AllocationPolicy getAllocationPolicy() const { return allocationPolicy; }
+	
 	
 	// Number of combinatorial elements (some could be inactive)
 	int getNumVertices() const;
 	int getNumEdges() const;
 	int getNumHalfedges() const;
 	int getNumFaces() const;
+	// Number of live elements, getNum*() count slots including removed ones
+	int getNumLiveVertices() const { return liveVertices.count(); }
+	int getNumLiveEdges() const { return liveEdges.count(); }
+	int getNumLiveHalfedges() const { return liveEdges.count()*2; }
+	int getNumLiveFaces() const { return liveFaces.count(); }
+	// Dense numbering of live elements (0 .. getNumLive*()-1) in slot order,
+	// e.g. for matrix rows.  Only meaningful for live elements.
+	int vertexLiveIndex(ofxHEMeshVertex v) const { return liveVertices.rank(v.idx); }
+	int edgeLiveIndex(ofxHEMeshHalfedge h) const { return liveEdges.rank(h.idx/2); }
+	int faceLiveIndex(ofxHEMeshFace f) const { return liveFaces.rank(f.idx); }
 	
 	// Iterate combinatorial elements
 	ofxHEMeshFaceIterator facesBegin() const;
@@ -121,6 +270,72 @@ public:
 	ofxHEMeshPolygonSplitter splitPolygon(const ofxHEMeshFace& f) const;
 	ofxHEMeshVertexCirculator vertexCirculate(const ofxHEMeshVertex& v) const;
 	
+	// Call fn on every live element from the thread pool, in chunks of grain slots
+	// (hemesh::getGrainSize() when grain <= 0).  fn may use the *LiveIndex()
+	// functions but mustn't change connectivity.  Edges are passed as their even halfedge.
+	template<typename Fn>
+	void parallelForVertices(Fn fn, int grain=0) const {
+		parallelForLive(liveVertices, getNumVertices(), [&](int i) { fn(ofxHEMeshVertex(i)); }, grain);
+	}
+	
+	template<typename Fn>
+	void parallelForEdges(Fn fn, int grain=0) const {
+		parallelForLive(liveEdges, getNumEdges(), [&](int i) { fn(ofxHEMeshHalfedge(i*2)); }, grain);
+	}
+	
+	template<typename Fn>
+	void parallelForFaces(Fn fn, int grain=0) const {
+		parallelForLive(liveFaces, getNumFaces(), [&](int i) { fn(ofxHEMeshFace(i)); }, grain);
+	}
+	
+	// Fold fn(element) over the live elements with combine(a, b), see hemesh::parallelReduce.
+	// With hemesh::setDeterministicReductions(true) the result doesn't depend on the thread count.
+	template<typename T, typename Fn, typename Combine>
+	T parallelReduceVertices(T identity, Fn fn, Combine combine, int grain=0) const {
+		return parallelReduceLive(liveVertices, getNumVertices(), identity, [&](int i) { return fn(ofxHEMeshVertex(i)); }, combine, grain);
+	}
+	
+	template<typename T, typename Fn, typename Combine>
+	T parallelReduceEdges(T identity, Fn fn, Combine combine, int grain=0) const {
+		return parallelReduceLive(liveEdges, getNumEdges(), identity, [&](int i) { return fn(ofxHEMeshHalfedge(i*2)); }, combine, grain);
+	}
+	
+	template<typename T, typename Fn, typename Combine>
+	T parallelReduceFaces(T identity, Fn fn, Combine combine, int grain=0) const {
+		return parallelReduceLive(liveFaces, getNumFaces(), identity, [&](int i) { return fn(ofxHEMeshFace(i)); }, combine, grain);
+	}
+	
+	// The loops behind the functions above.  Chunks split the slot range; dead
+	// slots inside a chunk are skipped
+	template<typename Fn>
+	void parallelForLive(const ofxHEMeshLiveSet& live, int n, Fn fn, int grain) const {
+		prepareLiveIndices();
+		hemesh::parallelFor(0, n, [&](int b, int e) {
+			for(int i=live.next(b, e); i < e; i=live.next(i+1, e)) {
+				fn(i);
+			}
+		}, grain > 0 ? grain : hemesh::getGrainSize());
+	}
+	
+	template<typename T, typename Fn, typename Combine>
+	T parallelReduceLive(const ofxHEMeshLiveSet& live, int n, T identity, Fn fn, Combine combine, int grain) const {
+		prepareLiveIndices();
+		return hemesh::parallelReduce(0, n, identity, [&](int b, int e) {
+			T res = identity;
+			for(int i=live.next(b, e); i < e; i=live.next(i+1, e)) {
+				res = combine(res, fn(i));
+			}
+			return res;
+		}, combine, grain > 0 ? grain : hemesh::getGrainSize());
+	}
+	
+	// Build the rank tables up front so *LiveIndex() can be called from several threads
+	void prepareLiveIndices() const {
+		liveVertices.updateRanks();
+		liveEdges.updateRanks();
+		liveFaces.updateRanks();
+	}
+	
 	// Set + get connectivity
 	ofxHEMeshHalfedge vertexHalfedge(ofxHEMeshVertex v) const;
 	void setVertexHalfedge(ofxHEMeshVertex v, ofxHEMeshHalfedge h);
@@ -155,12 +370,34 @@ public:
 	void vertexOneRing(ofxHEMeshVertex v, set<ofxHEMeshVertex>& oneRing) const;
 	bool verticesShareOneRing(ofxHEMeshVertex v1, ofxHEMeshVertex v2) const;
 	bool halfedgeIsInFace(ofxHEMeshFace f, ofxHEMeshHalfedge h) const;
+	// Whether following next from boundary halfedge h returns to it through boundary halfedges only
+	bool halfedgeIsOnBoundaryLoop(ofxHEMeshHalfedge h) const;
 	bool halfedgeLinksToVertex(ofxHEMeshVertex v, ofxHEMeshHalfedge h) const;
 	
 	// Geometric modification
 	void vertexMove(ofxHEMeshVertex v, const Direction& dir);
 	void vertexMoveTo(ofxHEMeshVertex v, const Point& p);
 	
+	// Batch geometry listener notifications.  Between beginChanges() and the
+	// matching commitChanges(), added vertices are reported in ranges and moves
+	// are delayed: vertexPoint() keeps returning the old position until commit,
+	// when listeners get one verticesWillMove() and the new positions are
+	// written.  Moving a vertex twice keeps the last position.  Calls may nest;
+	// only the outermost commit delivers the changes.  Vertex removal and
+	// clearing flush pending changes first since listeners need the old topology.
+	void beginChanges();
+	void commitChanges();
+	bool isChanging() const { return changeDepth > 0; }
+	
+	// Track which vertices and faces change, see ofxHEMeshChangeLog.  Each consumer
+	// adds its own cursor and reads the changes made since its last read: moved
+	// vertices and elements whose connectivity changed, including removed ones.
+	// readChanges() returns false when everything should be treated as changed,
+	// e.g. after compact(), on a cursor's first read.
+	int addChangeCursor() { return changes.addCursor(); }
+	void removeChangeCursor(int cursor) { changes.removeCursor(cursor); }
+	bool readChanges(int cursor, vector<ofxHEMeshVertex>& vertices, vector<ofxHEMeshFace>& faces);
+	
 	// Geometric properties
 	Point centroid() const;
 	Scalar meanEdgeLength() const;
@@ -185,6 +422,8 @@ public:
 	Scalar halfedgeLength(ofxHEMeshHalfedge h) const;
 	Direction halfedgeDirection(ofxHEMeshHalfedge h) const;
 	Scalar angleAtVertex(ofxHEMeshHalfedge h) const;
+	// Signed dihedral angle between the faces on either side of h, 0 when flat
+	// or on the boundary and positive where the surface is convex
 	Scalar halfedgeAngle(ofxHEMeshHalfedge h) const;
 	Direction halfedgeRotated(ofxHEMeshHalfedge h) const;
 	Point halfedgeQuadraticFit(ofxHEMeshHalfedge h) const;
@@ -213,6 +452,48 @@ public:
 		return faceProperties.add(name, def);
 	}
 	
+	// Handles look a property up once by name so per-element access doesn't go
+	// through a string lookup.  Invalid if no property of that name and type exists.
+	template<typename T>
+	ofxHEMeshPropertyHandle<T> getVertexPropertyHandle(const string &name) const {
+		return vertexProperties.handle<T>(name);
+	}
+	
+	template<typename T>
+	ofxHEMeshPropertyHandle<T> getHalfedgePropertyHandle(const string &name) const {
+		return halfedgeProperties.handle<T>(name);
+	}
+	
+	template<typename T>
+	ofxHEMeshPropertyHandle<T> getEdgePropertyHandle(const string &name) const {
+		return edgeProperties.handle<T>(name);
+	}
+	
+	template<typename T>
+	ofxHEMeshPropertyHandle<T> getFacePropertyHandle(const string &name) const {
+		return faceProperties.handle<T>(name);
+	}
+	
+	template<typename T>
+	ofxHEMeshProperty<T>& vertexProperty(ofxHEMeshPropertyHandle<T> handle) { return vertexProperties.get(handle); }
+	template<typename T>
+	const ofxHEMeshProperty<T>& vertexProperty(ofxHEMeshPropertyHandle<T> handle) const { return vertexProperties.get(handle); }
+	
+	template<typename T>
+	ofxHEMeshProperty<T>& halfedgeProperty(ofxHEMeshPropertyHandle<T> handle) { return halfedgeProperties.get(handle); }
+	template<typename T>
+	const ofxHEMeshProperty<T>& halfedgeProperty(ofxHEMeshPropertyHandle<T> handle) const { return halfedgeProperties.get(handle); }
+	
+	template<typename T>
+	ofxHEMeshProperty<T>& edgeProperty(ofxHEMeshPropertyHandle<T> handle) { return edgeProperties.get(handle); }
+	template<typename T>
+	const ofxHEMeshProperty<T>& edgeProperty(ofxHEMeshPropertyHandle<T> handle) const { return edgeProperties.get(handle); }
+	
+	template<typename T>
+	ofxHEMeshProperty<T>& faceProperty(ofxHEMeshPropertyHandle<T> handle) { return faceProperties.get(handle); }
+	template<typename T>
+	const ofxHEMeshProperty<T>& faceProperty(ofxHEMeshPropertyHandle<T> handle) const { return faceProperties.get(handle); }
+	
 	void clearVertices();
 	void clearHalfedges();
 	void clearFaces();
@@ -242,6 +523,10 @@ public:
 	bool verifyConnectivity() const;
 	/////////////////////////////////////////////////////////
 
+	// Journal recording the edits, see ofxHEMeshJournal which attaches itself
+	ofxHEMeshJournal * getJournal() const { return journal; }
+	void setJournal(ofxHEMeshJournal *journal) { this->journal = journal; }
+
 	void addGeometryListener(GeometryListener *listener) {
 		geometryListeners.push_back(listener);
 	}
@@ -253,6 +538,13 @@ public:
 		}
 	}
 	
+	void notifyGeometryListeners(ofxHEMeshVertex v, int n, GeometryListener::MemberFnRange f) {
+		for(int i=0; i < geometryListeners.size(); ++i) {
+			GeometryListener& listener = *geometryListeners[i];
+			((listener).*(f))(v, n);
+		}
+	}
+	
 	void notifyGeometryListeners(ofxHEMeshVertex v, Point p, GeometryListener::MemberFnPt f) {
 		for(int i=0; i < geometryListeners.size(); ++i) {
 			GeometryListener& listener = *geometryListeners[i];
@@ -262,6 +554,82 @@ public:
 
 
 protected:
+	// Non-owning view of a flattened face list.  Face i has the vertices
+	// vertices[faceBegin(i)] .. vertices[faceBegin(i+1)-1].  When offsets is
+	// NULL every face has faceSize vertices.
+	struct FaceList {
+		FaceList(const int *offsets, const ofxHEMeshVertex *vertices, int nfaces, int faceSize=0)
+		: offsets(offsets), vertices(vertices), nfaces(nfaces), faceSize(faceSize)
+		{}
+		
+		int faceBegin(int i) const { return offsets ? offsets[i] : i*faceSize; }
+		int numCorners() const { return faceBegin(nfaces); }
+	
+		const int *offsets;
+		const ofxHEMeshVertex *vertices;
+		int nfaces;
+		int faceSize;
+	};
+
+	// Slots of removed elements waiting to be reused
+	struct FreeList {
+		void push(int idx) {
+			if(idx >= int(freed.size())) freed.resize(idx+1, 0);
+			if(!freed[idx]) {
+				freed[idx] = 1;
+				slots.push_back(idx);
+			}
+		}
+		
+		int pop() {
+			if(slots.empty()) return -1;
+			int idx = slots.back();
+			slots.pop_back();
+			freed[idx] = 0;
+			return idx;
+		}
+		
+		void clear() {
+			slots.clear();
+			freed.clear();
+		}
+	
+		vector<int> slots;
+		vector<char> freed;
+	};
+	
+	ofxHEMeshFace allocateFace();
+	void clearFreeLists();
+	ofxHEMeshPropertySet& elementProperties(int kind);
+	FreeList& freeList(int kind);
+	
+	// Element bookkeeping and writes the setters don't cover, recorded with the
+	// journal when there is one
+	bool journaling() const;
+	int popFree(ElementKind kind);
+	void pushFree(ElementKind kind, int idx);
+	void resetElement(ElementKind kind, int idx);
+	void extendElements(ElementKind kind, int n);
+	void writeHalfedgeAdjacency(ofxHEMeshHalfedge h, const ofxHEMeshHalfedgeAdjacency& adj);
+	void writePoint(ofxHEMeshVertex v, const Point& p);
+	// Point the adjacency and points members at the properties in the sets
+	void bindProperties();
+	// Mark everything changed and reset the listeners after the contents were replaced
+	void contentsReplaced();
+
+	void flushChanges();
+	void updateEdgeLiveness(int e);
+	void rebuildLiveSets();
+	void markHalfedgeChanged(ofxHEMeshHalfedge h);
+	void detachVertex(ofxHEMeshVertex v);
+	void vertexWasAdded(ofxHEMeshVertex v, int n);
+	// Finish adding vertices vstart .. vstart+n-1 once their points are written
+	void verticesAppended(int vstart, int n);
+	void moveVertices(const vector<ofxHEMeshVertex>& vertices, const vector<Point>& pts);
+
+	void buildFaces(const FaceList& faces);
+	void buildFacesSerial(const FaceList& faces);
+	void buildFacesParallel(const FaceList& faces);
 
 	ofxHEMeshPropertySet vertexProperties;
 	ofxHEMeshPropertySet halfedgeProperties;
@@ -273,10 +641,29 @@ protected:
 	ofxHEMeshProperty<ofxHEMeshFaceAdjacency> *faceAdjacency;
 	
 	ofxHEMeshProperty<Point>* points;
+	// A vertex is live if it has a halfedge, an edge if either halfedge has a
+	// vertex and a face if it has a halfedge.  Kept up to date by the setters.
+	ofxHEMeshLiveSet liveVertices;
+	ofxHEMeshLiveSet liveEdges;
+	ofxHEMeshLiveSet liveFaces;
+	ofxHEMeshChangeLog changes;
 	bool topologyDirty;
 	bool geometryDirty;
 	
+	AllocationPolicy allocationPolicy;
+	FreeList freeVertices;
+	FreeList freeEdges;
+	FreeList freeFaces;
+	
 	vector<GeometryListener *> geometryListeners;
+	ofxHEMeshJournal *journal;
+	
+	// Pending changes, see beginChanges()
+	int changeDepth;
+	vector<std::pair<int, int> > pendingAdds;
+	vector<ofxHEMeshVertex> pendingMoves;
+	vector<Point> pendingPoints;
+	vector<int> pendingMoveSlots;
 };
 
 void printExplicitFace(const ofxHEMesh::ExplicitFace& face);
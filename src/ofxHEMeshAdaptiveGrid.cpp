@@ -102,6 +102,15 @@ void ofxHEMeshAdaptiveGrid::vertexAdded(ofxHEMeshVertex v) {
 	addVertexToGrid(v, vertexToCoord(v));
 }
 
+void ofxHEMeshAdaptiveGrid::verticesAdded(ofxHEMeshVertex v, int n) {
+	// Share one accessor so its cached nodes are reused across the range
+	Int64Grid::Accessor accessor = grid.getAccessor();
+	for(int i=0; i < n; ++i) {
+		ofxHEMeshVertex vi(v.idx+i);
+		addVertexToGrid(accessor, vi, vertexToCoord(vi));
+	}
+}
+
 void ofxHEMeshAdaptiveGrid::vertexWillBeMovedTo(ofxHEMeshVertex v, Point p) {
 	Coord c1 = vertexToCoord(v);
 	Coord c = pointToCoord(p);
@@ -111,10 +120,47 @@ void ofxHEMeshAdaptiveGrid::vertexWillBeMovedTo(ofxHEMeshVertex v, Point p) {
 	}
 }
 
+void ofxHEMeshAdaptiveGrid::verticesWillMove(const vector<ofxHEMeshVertex>& vertices, const vector<Point>& points) {
+	Int64Grid::Accessor accessor = grid.getAccessor();
+	for(int i=0; i < vertices.size(); ++i) {
+		Coord c1 = vertexToCoord(vertices[i]);
+		Coord c = pointToCoord(points[i]);
+		if(c != c1) {
+			removeVertexFromGrid(accessor, vertices[i], c1);
+			addVertexToGrid(accessor, vertices[i], c);
+		}
+	}
+}
+
 void ofxHEMeshAdaptiveGrid::vertexWillBeRemoved(ofxHEMeshVertex v) {;
 	removeVertexFromGrid(v, vertexToCoord(v));
 }
 
+void ofxHEMeshAdaptiveGrid::verticesWillBeRemoved(const vector<ofxHEMeshVertex>& vertices) {
+	Int64Grid::Accessor accessor = grid.getAccessor();
+	for(int i=0; i < vertices.size(); ++i) {
+		removeVertexFromGrid(accessor, vertices[i], vertexToCoord(vertices[i]));
+	}
+}
+
+void ofxHEMeshAdaptiveGrid::verticesCompacted(const vector<int>& vertexMap) {
+	vector<Coord> removed;
+	for(Int64Grid::ValueOnIter it = grid.beginValueOn(); it; ++it) {
+		int idx = int(*it);
+		if(idx >= 0 && idx < vertexMap.size() && vertexMap[idx] >= 0) {
+			it.setValue(vertexMap[idx]);
+		}
+		else {
+			removed.push_back(it.getCoord());
+		}
+	}
+	
+	Int64Grid::Accessor accessor = grid.getAccessor();
+	for(int i=0; i < removed.size(); ++i) {
+		accessor.setValueOff(removed[i], ofxHEMeshNode::Invalid);
+	}
+}
+
 ofxHEMeshVertex ofxHEMeshAdaptiveGrid::vertexAt(Coord c) const {
 	Int64Grid::ConstAccessor accessor = grid.getAccessor();
 	return ofxHEMeshVertex(accessor.getValue(c));
@@ -122,6 +168,10 @@ ofxHEMeshVertex ofxHEMeshAdaptiveGrid::vertexAt(Coord c) const {
 
 void ofxHEMeshAdaptiveGrid::addVertexToGrid(ofxHEMeshVertex v, Coord c) {
 	Int64Grid::Accessor accessor = grid.getAccessor();
+	addVertexToGrid(accessor, v, c);
+}
+
+void ofxHEMeshAdaptiveGrid::addVertexToGrid(Int64Grid::Accessor& accessor, ofxHEMeshVertex v, Coord c) {
 	if(!accessor.isValueOn(c)) {
 		accessor.setValueOn(c, v.idx);
 	}
@@ -129,6 +179,10 @@ void ofxHEMeshAdaptiveGrid::addVertexToGrid(ofxHEMeshVertex v, Coord c) {
 
 void ofxHEMeshAdaptiveGrid::removeVertexFromGrid(ofxHEMeshVertex v, Coord c) {
 	Int64Grid::Accessor accessor = grid.getAccessor();
+	removeVertexFromGrid(accessor, v, c);
+}
+
+void ofxHEMeshAdaptiveGrid::removeVertexFromGrid(Int64Grid::Accessor& accessor, ofxHEMeshVertex v, Coord c) {
 	if(int(accessor.getValue(c)) == v.idx) {
 		// find another vertex to replace
 		ofxHEMeshVertexCirculator vc = vertexCirculate(v);
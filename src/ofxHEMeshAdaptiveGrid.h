@@ -49,8 +49,12 @@ public:
 	
 	void verticesCleared(ofxHEMeshVertex v);
 	void vertexAdded(ofxHEMeshVertex v);
+	void verticesAdded(ofxHEMeshVertex v, int n);
 	void vertexWillBeMovedTo(ofxHEMeshVertex v, Point p);
+	void verticesWillMove(const vector<ofxHEMeshVertex>& vertices, const vector<Point>& points);
 	void vertexWillBeRemoved(ofxHEMeshVertex v);
+	void verticesWillBeRemoved(const vector<ofxHEMeshVertex>& vertices);
+	void verticesCompacted(const vector<int>& vertexMap);
 	
 	ofxHEMeshVertex vertexAt(Coord c) const;
 	const Int64Grid& getGrid() const { return grid; }
@@ -63,6 +67,9 @@ protected:
 
 	void addVertexToGrid(ofxHEMeshVertex v, Coord c);
 	void removeVertexFromGrid(ofxHEMeshVertex v, Coord c);
+	// Versions sharing an accessor across a batch of changes
+	void addVertexToGrid(Int64Grid::Accessor& accessor, ofxHEMeshVertex v, Coord c);
+	void removeVertexFromGrid(Int64Grid::Accessor& accessor, ofxHEMeshVertex v, Coord c);
 	Coord vertexToCoord(ofxHEMeshVertex v);
 	
 
@@ -0,0 +1,297 @@
+#include "ofxHEMeshBinaryIO.h"
+#include "ofxHEMeshMappedFile.h"
+#include "ofxHEMeshParallel.h"
+#include <fstream>
+#include <string.h>
+#include <stdint.h>
+
+
+static const char Magic[4] = {'H', 'E', 'M', 'B'};
+static const uint32_t Version = 1;
+static const uint32_t ByteOrderMark = 0x01020304;
+static const uint32_t NumSets = 4;
+static const int DataAlignment = 16;
+
+struct ofxHEMeshBinaryHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t numSets;
+};
+
+struct ofxHEMeshBinarySetHeader {
+	int32_t count;
+	int32_t numProperties;
+};
+
+struct ofxHEMeshBinaryPropertyHeader {
+	uint32_t nameLength;
+	int32_t type;
+	int32_t elementSize;
+	int32_t count;
+};
+
+// A property found in a file, pointing into the mapped data
+struct ofxHEMeshBinaryProperty {
+	int set;
+	string name;
+	int type;
+	int elementSize;
+	int count;
+	const char *data;
+};
+
+
+static size_t alignedSize(size_t n) {
+	return (n + DataAlignment-1) & ~size_t(DataAlignment-1);
+}
+
+template<typename T>
+static bool readValue(const char *&p, const char *end, T& v) {
+	if(size_t(end-p) < sizeof(T)) return false;
+	memcpy(&v, p, sizeof(T));
+	p += sizeof(T);
+	return true;
+}
+
+// Whether the adjacency in prop only refers to Invalid or to elements within
+// the stored set counts.  Other properties are always valid.
+static bool validAdjacency(const ofxHEMeshBinaryProperty& prop, const int *counts) {
+	// sets the fields of each type's items refer to, in order
+	static const int vertexFields[] = {1};
+	static const int halfedgeFields[] = {0, 3, 1, 1};
+	static const int faceFields[] = {1};
+	const int *fields;
+	int nfields;
+	switch(prop.type) {
+		case ofxHEMeshPropertyBase::VertexAdjacency: fields = vertexFields; nfields = 1; break;
+		case ofxHEMeshPropertyBase::HalfedgeAdjacency: fields = halfedgeFields; nfields = 4; break;
+		case ofxHEMeshPropertyBase::FaceAdjacency: fields = faceFields; nfields = 1; break;
+		default: return true;
+	}
+	if(prop.elementSize != nfields*int(sizeof(int32_t))) {
+		return false;
+	}
+
+	return hemesh::parallelReduce(0, prop.count, true, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			const char *item = prop.data + size_t(i)*size_t(prop.elementSize);
+			for(int j=0; j < nfields; ++j) {
+				int32_t idx;
+				memcpy(&idx, item + j*sizeof(int32_t), sizeof(idx));
+				if(idx != ofxHEMeshNode::Invalid && (idx < 0 || idx >= counts[fields[j]])) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}, [](bool a, bool b) { return a && b; }, 1<<16);
+}
+
+static ofxHEMeshPropertyBase * addProperty(ofxHEMeshPropertySet& properties, const string& name, int type) {
+	switch(type) {
+		case ofxHEMeshPropertyBase::Int8: return properties.add<char>(name, 0);
+		case ofxHEMeshPropertyBase::UInt8: return properties.add<unsigned char>(name, 0);
+		case ofxHEMeshPropertyBase::Int32: return properties.add<int>(name, 0);
+		case ofxHEMeshPropertyBase::UInt32: return properties.add<unsigned int>(name, 0);
+		case ofxHEMeshPropertyBase::Float32: return properties.add<float>(name, 0);
+		case ofxHEMeshPropertyBase::Float64: return properties.add<double>(name, 0);
+		case ofxHEMeshPropertyBase::Vec3f: return properties.add<ofVec3f>(name, ofVec3f());
+		case ofxHEMeshPropertyBase::VertexIndex: return properties.add<ofxHEMeshVertex>(name, ofxHEMeshVertex());
+		case ofxHEMeshPropertyBase::HalfedgeIndex: return properties.add<ofxHEMeshHalfedge>(name, ofxHEMeshHalfedge());
+		case ofxHEMeshPropertyBase::FaceIndex: return properties.add<ofxHEMeshFace>(name, ofxHEMeshFace());
+		case ofxHEMeshPropertyBase::VertexAdjacency: return properties.add<ofxHEMeshVertexAdjacency>(name, ofxHEMeshVertexAdjacency());
+		case ofxHEMeshPropertyBase::HalfedgeAdjacency: return properties.add<ofxHEMeshHalfedgeAdjacency>(name, ofxHEMeshHalfedgeAdjacency());
+		case ofxHEMeshPropertyBase::FaceAdjacency: return properties.add<ofxHEMeshFaceAdjacency>(name, ofxHEMeshFaceAdjacency());
+		default: return NULL;
+	}
+}
+
+
+bool ofxHEMeshBinaryIO::save(const ofxHEMesh& hemesh, const string& fileName) {
+	std::ofstream stream(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!stream.is_open()) {
+		ofLogError("ofxHEMeshBinaryIO") << "save(): couldn't open \"" << fileName << "\" for writing";
+		return false;
+	}
+
+	const ofxHEMeshPropertySet *sets[NumSets] = {
+		&hemesh.vertexProperties,
+		&hemesh.halfedgeProperties,
+		&hemesh.edgeProperties,
+		&hemesh.faceProperties
+	};
+
+	ofxHEMeshBinaryHeader header;
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.byteOrder = ByteOrderMark;
+	header.numSets = NumSets;
+	stream.write((const char *)&header, sizeof(header));
+	size_t pos = sizeof(header);
+
+	const char padding[DataAlignment] = {0};
+	for(int i=0; i < NumSets; ++i) {
+		vector<const ofxHEMeshPropertyBase *> properties;
+		for(int j=0; j < sets[i]->getNumProperties(); ++j) {
+			const ofxHEMeshPropertyBase *prop = sets[i]->getProperty(j);
+			if(!prop) continue;
+			if(prop->getType() == ofxHEMeshPropertyBase::Unknown) {
+				ofLogWarning("ofxHEMeshBinaryIO") << "save(): property " << prop->getName() << " has no type tag, not saving it";
+			}
+			else {
+				properties.push_back(prop);
+			}
+		}
+
+		ofxHEMeshBinarySetHeader setHeader;
+		setHeader.count = sets[i]->size();
+		setHeader.numProperties = int(properties.size());
+		stream.write((const char *)&setHeader, sizeof(setHeader));
+		pos += sizeof(setHeader);
+
+		for(int j=0; j < properties.size(); ++j) {
+			const ofxHEMeshPropertyBase *prop = properties[j];
+			ofxHEMeshBinaryPropertyHeader propHeader;
+			propHeader.nameLength = uint32_t(prop->getName().size());
+			propHeader.type = prop->getType();
+			propHeader.elementSize = prop->elementSize();
+			// one item per element, slots past a property's own size hold its default
+			propHeader.count = sets[i]->size();
+			stream.write((const char *)&propHeader, sizeof(propHeader));
+			stream.write(prop->getName().data(), propHeader.nameLength);
+			pos += sizeof(propHeader) + propHeader.nameLength;
+
+			stream.write(padding, alignedSize(pos) - pos);
+			pos = alignedSize(pos);
+
+			size_t nbytes = size_t(propHeader.count)*size_t(propHeader.elementSize);
+			pos += nbytes;
+			if(prop->rawData()) {
+				stream.write((const char *)prop->rawData(), nbytes);
+				continue;
+			}
+			// shared with a copy, its blocks are written back to back
+			size_t blockBytes = size_t(ofxHEMeshPropertyBase::BlockSize)*size_t(propHeader.elementSize);
+			for(int b=0; nbytes > 0; ++b) {
+				size_t n = std::min(nbytes, blockBytes);
+				stream.write((const char *)prop->rawBlock(b), n);
+				nbytes -= n;
+			}
+		}
+	}
+	return stream.good();
+}
+
+bool ofxHEMeshBinaryIO::load(ofxHEMesh& hemesh, const string& fileName) {
+	ofxHEMeshMappedFile file;
+	if(!file.open(fileName)) {
+		ofLogError("ofxHEMeshBinaryIO") << "load(): couldn't read \"" << fileName << "\"";
+		return false;
+	}
+
+	// Read and validate the layout before touching the mesh
+	const char *data = file.data();
+	const char *end = data+file.size();
+	const char *p = data;
+	ofxHEMeshBinaryHeader header;
+	if(!readValue(p, end, header) || memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+		ofLogError("ofxHEMeshBinaryIO") << "load(): \"" << fileName << "\" isn't a binary mesh file";
+		return false;
+	}
+	if(header.byteOrder != ByteOrderMark || header.version != Version || header.numSets != NumSets) {
+		ofLogError("ofxHEMeshBinaryIO") << "load(): unsupported version or byte order in \"" << fileName << "\"";
+		return false;
+	}
+
+	int counts[NumSets];
+	vector<ofxHEMeshBinaryProperty> properties;
+	for(int i=0; i < NumSets; ++i) {
+		ofxHEMeshBinarySetHeader setHeader;
+		bool valid = readValue(p, end, setHeader) && setHeader.count >= 0 && setHeader.numProperties >= 0;
+		for(int j=0; valid && j < setHeader.numProperties; ++j) {
+			ofxHEMeshBinaryPropertyHeader propHeader;
+			valid = readValue(p, end, propHeader) &&
+				propHeader.elementSize > 0 && propHeader.count >= 0 &&
+				propHeader.nameLength <= size_t(end-p);
+			if(!valid) break;
+
+			ofxHEMeshBinaryProperty prop;
+			prop.set = i;
+			prop.name = string(p, propHeader.nameLength);
+			prop.type = propHeader.type;
+			prop.elementSize = propHeader.elementSize;
+			prop.count = propHeader.count;
+			p += propHeader.nameLength;
+
+			size_t pos = alignedSize(p-data);
+			size_t nbytes = size_t(prop.count)*size_t(prop.elementSize);
+			valid = pos <= file.size() && nbytes <= file.size()-pos;
+			if(!valid) break;
+
+			prop.data = data+pos;
+			p = data+pos+nbytes;
+			properties.push_back(prop);
+		}
+
+		if(!valid) {
+			ofLogError("ofxHEMeshBinaryIO") << "load(): \"" << fileName << "\" is truncated or corrupt";
+			return false;
+		}
+		counts[i] = setHeader.count;
+	}
+
+	// Every property has one item per element of its set and the adjacency
+	// only refers to stored elements, otherwise later reads would run wild
+	for(int i=0; i < properties.size(); ++i) {
+		const ofxHEMeshBinaryProperty& prop = properties[i];
+		if(prop.count != counts[prop.set] || !validAdjacency(prop, counts)) {
+			ofLogError("ofxHEMeshBinaryIO") << "load(): property " << prop.name << " in \"" << fileName << "\" is corrupt";
+			return false;
+		}
+	}
+
+	hemesh.flushChanges();
+	
+	// Reset every property to its default then copy in the stored arrays
+	ofxHEMeshPropertySet *sets[NumSets] = {
+		&hemesh.vertexProperties,
+		&hemesh.halfedgeProperties,
+		&hemesh.edgeProperties,
+		&hemesh.faceProperties
+	};
+	for(int i=0; i < NumSets; ++i) {
+		sets[i]->clear();
+		sets[i]->resize(counts[i]);
+	}
+
+	for(int i=0; i < properties.size(); ++i) {
+		const ofxHEMeshBinaryProperty& src = properties[i];
+		ofxHEMeshPropertySet& set = *sets[src.set];
+		ofxHEMeshPropertyBase *prop = set.get(src.name);
+		if(!prop) {
+			prop = addProperty(set, src.name, src.type);
+			if(!prop) {
+				ofLogWarning("ofxHEMeshBinaryIO") << "load(): property " << src.name << " has an unknown type, not loading it";
+				continue;
+			}
+		}
+		if(prop->getType() != src.type || prop->elementSize() != src.elementSize) {
+			ofLogWarning("ofxHEMeshBinaryIO") << "load(): property " << src.name << " doesn't match the stored type, not loading it";
+			continue;
+		}
+
+		prop->resize(src.count);
+		if(src.count > 0) {
+			memcpy(prop->rawData(), src.data, size_t(src.count)*size_t(src.elementSize));
+		}
+	}
+
+	hemesh.clearFreeLists();
+	hemesh.rebuildLiveSets();
+	hemesh.topologyDirty = true;
+	hemesh.geometryDirty = true;
+	hemesh.notifyGeometryListeners(ofxHEMeshVertex(), &ofxHEMesh::GeometryListener::verticesCleared);
+	hemesh.notifyGeometryListeners(ofxHEMeshVertex(0), counts[0], &ofxHEMesh::GeometryListener::verticesAdded);
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "ofxHEMesh.h"
+
+/*
+Native binary format storing the raw arrays of a mesh's vertex, halfedge, edge
+and face property sets.  Adjacency is stored as-is, so loading a mesh doesn't
+rebuild any connectivity.
+
+	header:       "HEMB", version, byte-order mark, number of property sets
+	property set: element count, number of properties
+	property:     name length, type tag, element size, element count, name,
+	              then the elements starting on a 16-byte boundary
+
+All values are written in the host's byte order; files with a different byte
+order are rejected.  Properties whose element type has no tag (see
+ofxHEMeshPropertyTraits) are skipped when saving.  On load, properties already
+on the mesh are filled by name and tagged properties it doesn't have are added.
+*/
+class ofxHEMeshBinaryIO{
+public:
+	static bool save(const ofxHEMesh& hemesh, const string& fileName);
+	static bool load(ofxHEMesh& hemesh, const string& fileName);
+};
@@ -0,0 +1,134 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+
+using std::vector;
+
+/*
+Records which vertices and faces were touched so several consumers (drawing,
+simulation, ...) can each catch up on the changes at their own pace.  Each
+consumer owns a cursor into a shared log and read() returns the elements logged
+since that cursor last read, deduplicated.
+
+Nothing is logged while there are no cursors.  When changes can't be described
+element by element (bulk rebuilds, compaction) or the log grows well past the
+number of elements, cursors are flagged instead and read() reports that
+everything should be treated as changed.
+*/
+class ofxHEMeshChangeLog {
+public:
+	ofxHEMeshChangeLog()
+	:	numCursors(0), start(0), maxIndex(0)
+	{}
+
+	int addCursor() {
+		Cursor c;
+		c.pos = start + log.size();
+		c.everything = true;
+		for(int i=0; i < cursors.size(); ++i) {
+			if(!cursors[i].active) {
+				cursors[i] = c;
+				++numCursors;
+				return i;
+			}
+		}
+		cursors.push_back(c);
+		++numCursors;
+		return int(cursors.size())-1;
+	}
+
+	void removeCursor(int cursor) {
+		if(cursor < 0 || cursor >= cursors.size() || !cursors[cursor].active) return;
+		cursors[cursor].active = false;
+		--numCursors;
+		if(numCursors == 0) {
+			start += log.size();
+			log.clear();
+		}
+	}
+
+	bool isTracking() const { return numCursors > 0; }
+
+	void markVertex(int idx) {
+		if(numCursors > 0 && idx >= 0) push(idx*2);
+	}
+
+	void markFace(int idx) {
+		if(numCursors > 0 && idx >= 0) push(idx*2+1);
+	}
+
+	// Every cursor will see everything as changed
+	void markAll() {
+		for(int i=0; i < cursors.size(); ++i) {
+			cursors[i].everything = true;
+		}
+		start += log.size();
+		log.clear();
+	}
+
+	// Indices logged since the cursor last read, sorted and unique.  Returns
+	// false if the changes weren't tracked and everything should be updated.
+	bool read(int cursor, vector<int>& vertices, vector<int>& faces) {
+		vertices.clear();
+		faces.clear();
+		Cursor& c = cursors[cursor];
+		bool tracked = !c.everything;
+		if(tracked) {
+			for(size_t i=c.pos-start; i < log.size(); ++i) {
+				if(log[i] & 1) faces.push_back(log[i] >> 1);
+				else vertices.push_back(log[i] >> 1);
+			}
+			sortUnique(vertices);
+			sortUnique(faces);
+		}
+		c.everything = false;
+		c.pos = start + log.size();
+		trim();
+		return tracked;
+	}
+
+protected:
+	struct Cursor {
+		Cursor() : active(true), pos(0), everything(true) {}
+
+		bool active;
+		size_t pos;
+		bool everything;
+	};
+
+	void push(int entry) {
+		maxIndex = std::max(maxIndex, entry);
+		// past this it's cheaper to update everything
+		if(log.size() >= 2*size_t(maxIndex) + 4096) {
+			markAll();
+		}
+		log.push_back(entry);
+	}
+
+	static void sortUnique(vector<int>& v) {
+		std::sort(v.begin(), v.end());
+		v.erase(std::unique(v.begin(), v.end()), v.end());
+	}
+
+	// Forget entries every cursor has read once they make up half the log
+	void trim() {
+		size_t minPos = start + log.size();
+		for(int i=0; i < cursors.size(); ++i) {
+			if(cursors[i].active && !cursors[i].everything) {
+				minPos = std::min(minPos, cursors[i].pos);
+			}
+		}
+		size_t n = minPos - start;
+		if(n > 0 && n*2 >= log.size()) {
+			log.erase(log.begin(), log.begin()+n);
+			start = minPos;
+		}
+	}
+
+	vector<int> log;
+	vector<Cursor> cursors;
+	int numCursors;
+	// Log position of log[0]
+	size_t start;
+	int maxIndex;
+};
@@ -1,42 +1,64 @@
 #include "ofxHEMeshDEC.h"
+#include "ofxHEMeshGeometry.h"
+#include "ofxHEMeshKernelGeometry.h"
 
 namespace hemesh {
 
+// The mesh's own kernel reads the batched caches, others compute on the fly
+template<typename Kernel>
+struct DECGeometry {
+	typedef ofxHEMeshKernelGeometry<Kernel> Type;
+	static void update(Type& geometry) {}
+};
+
+template<>
+struct DECGeometry<ofxHEMesh::Kernel> {
+	typedef ofxHEMeshGeometry Type;
+	static void update(Type& geometry) { geometry.update(); }
+};
+
+template<typename Kernel>
 void hodgeStar0Form(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& star0) {
-	int n = hemesh.getNumVertices();
+	int n = hemesh.getNumLiveVertices();
 	star0.resize(n, n);
 	star0.reserve(n);
 	
-	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
-	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
-	for(; vit != vite; ++vit) {
-		ofxHEMeshVertex v = *vit;
-		star0.insert(v.idx, v.idx) = hemesh.vertexArea(v);
+	typename DECGeometry<Kernel>::Type geometry(hemesh);
+	DECGeometry<Kernel>::update(geometry);
+	vector<double> areas(n);
+	hemesh.parallelForVertices([&](ofxHEMeshVertex v) {
+		areas[hemesh.vertexLiveIndex(v)] = geometry.vertexArea(v);
+	});
+	for(int i=0; i < n; ++i) {
+		star0.insert(i, i) = areas[i];
 	}
 }
 
+template<typename Kernel>
 void hodgeStar1Form(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& star1) {
-	int n = hemesh.getNumEdges();
+	int n = hemesh.getNumLiveEdges();
 	star1.resize(n, n);
 	star1.reserve(n);
 	
-	ofxHEMeshEdgeIterator eit = hemesh.edgesBegin();
-	ofxHEMeshEdgeIterator eite = hemesh.edgesEnd();
-	for(; eit != eite; ++eit) {
-		ofxHEMeshHalfedge h = *eit;
+	typename DECGeometry<Kernel>::Type geometry(hemesh);
+	DECGeometry<Kernel>::update(geometry);
+	vector<double> weights(n);
+	hemesh.parallelForEdges([&](ofxHEMeshHalfedge h) {
 		ofxHEMeshHalfedge ho = hemesh.halfedgeOpposite(h);
-		ofxHEMesh::Scalar cotAlpha = hemesh.halfedgeCotan(h);
-		ofxHEMesh::Scalar cotBeta  = hemesh.halfedgeCotan(ho);
-		int eidx = h.idx/2;
-		star1.insert(eidx, eidx) = (cotAlpha + cotBeta)*0.5;
+		typename Kernel::Scalar cotAlpha = geometry.halfedgeCotan(h);
+		typename Kernel::Scalar cotBeta  = geometry.halfedgeCotan(ho);
+		weights[hemesh.edgeLiveIndex(h)] = (cotAlpha + cotBeta)*0.5;
+	});
+	for(int i=0; i < n; ++i) {
+		star1.insert(i, i) = weights[i];
 	}
 }
 
 typedef Eigen::Triplet<double> Tripletd;
 
 void exteriorDerivative0Form(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& d0) {
-	int nV = hemesh.getNumVertices();
-	int nE = hemesh.getNumEdges();
+	int nV = hemesh.getNumLiveVertices();
+	int nE = hemesh.getNumLiveEdges();
 	d0.resize(nE, nV);
 	
 	//d0.reserve(nE*2);
@@ -50,34 +72,38 @@ void exteriorDerivative0Form(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double
 		ofxHEMeshHalfedge h = *eit;
 		ofxHEMeshVertex v1 = hemesh.halfedgeSink(h);
 		ofxHEMeshVertex v2 = hemesh.halfedgeSource(h);
-		int eidx = h.idx/2;
-		entries.push_back(Tripletd(eidx, v1.idx, 1));
-		entries.push_back(Tripletd(eidx, v2.idx, -1));
+		int eidx = hemesh.edgeLiveIndex(h);
+		entries.push_back(Tripletd(eidx, hemesh.vertexLiveIndex(v1), 1));
+		entries.push_back(Tripletd(eidx, hemesh.vertexLiveIndex(v2), -1));
 	}
 	d0.setFromTriplets(entries.begin(), entries.end());
 }
 
+template<typename Kernel>
 void laplacian(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& L) {
 	Eigen::SparseMatrix<double> d0;
 	Eigen::SparseMatrix<double> star1;
 	exteriorDerivative0Form(hemesh, d0);
-	hodgeStar1Form(hemesh, star1);
+	hodgeStar1Form<Kernel>(hemesh, star1);
 	L = d0.transpose()*star1*d0;
 }
 
 
 
-MeanCurvatureNormals::MeanCurvatureNormals(ofxHEMesh& hemesh)
+template<typename Kernel>
+MeanCurvatureNormals<Kernel>::MeanCurvatureNormals(ofxHEMesh& hemesh)
 :	hemesh(hemesh)
 {}
 
-void MeanCurvatureNormals::build() {
-	laplacian(hemesh, L);
+template<typename Kernel>
+void MeanCurvatureNormals<Kernel>::build() {
+	laplacian<Kernel>(hemesh, L);
 	getPositions();
 	normals = L*positions;
 }
 
-void MeanCurvatureNormals::getNormals(vector<ofxHEMesh::Direction>& normals) {
+template<typename Kernel>
+void MeanCurvatureNormals<Kernel>::getNormals(vector<Direction>& normals) {
 	normals.resize(hemesh.getNumVertices());
 	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
 	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
@@ -86,31 +112,37 @@ void MeanCurvatureNormals::getNormals(vector<ofxHEMesh::Direction>& normals) {
 	}
 }
 
-ofxHEMesh::Direction MeanCurvatureNormals::getNormal(ofxHEMeshVertex v) {
-	return ofxHEMesh::Direction(normals(v.idx, 0), normals(v.idx, 1), normals(v.idx, 2));
+template<typename Kernel>
+typename Kernel::Direction MeanCurvatureNormals<Kernel>::getNormal(ofxHEMeshVertex v) {
+	int vidx = hemesh.vertexLiveIndex(v);
+	return Direction(normals(vidx, 0), normals(vidx, 1), normals(vidx, 2));
 }
 
-void MeanCurvatureNormals::getPositions() {
+template<typename Kernel>
+void MeanCurvatureNormals<Kernel>::getPositions() {
 	positions.resize(L.rows(), 3);
 	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
 	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
 	for(; vit != vite; ++vit) {
 		ofxHEMeshVertex v = *vit;
 		ofxHEMesh::Point pos = hemesh.vertexPoint(v);
-		positions(v.idx, 0) = (double)pos[0];
-		positions(v.idx, 1) = (double)pos[1];
-		positions(v.idx, 2) = (double)pos[2];
+		int vidx = hemesh.vertexLiveIndex(v);
+		positions(vidx, 0) = (double)pos[0];
+		positions(vidx, 1) = (double)pos[1];
+		positions(vidx, 2) = (double)pos[2];
 	}
 }
 
 
-MeanCurvatureFlow::MeanCurvatureFlow(ofxHEMesh& hemesh)
+template<typename Kernel>
+MeanCurvatureFlow<Kernel>::MeanCurvatureFlow(ofxHEMesh& hemesh)
 : hemesh(hemesh)
 {}
 		
-void MeanCurvatureFlow::step(double amt) {
-	laplacian(hemesh, L);
-	hodgeStar0Form(hemesh, star0);
+template<typename Kernel>
+bool MeanCurvatureFlow<Kernel>::step(double amt) {
+	laplacian<Kernel>(hemesh, L);
+	hodgeStar0Form<Kernel>(hemesh, star0);
 	getPositions();
 	
 	Eigen::SparseMatrix<double> A = star0 + amt*L;
@@ -130,41 +162,50 @@ void MeanCurvatureFlow::step(double amt) {
 	}
 	
 	setPositions(newPositions);
+	return true;
 }
 
-void MeanCurvatureFlow::getPositions() {
+template<typename Kernel>
+void MeanCurvatureFlow<Kernel>::getPositions() {
 	positions.resize(L.rows(), 3);
 	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
 	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
 	for(; vit != vite; ++vit) {
 		ofxHEMeshVertex v = *vit;
 		ofxHEMesh::Point pos = hemesh.vertexPoint(v);
-		positions(v.idx, 0) = (double)pos[0];
-		positions(v.idx, 1) = (double)pos[1];
-		positions(v.idx, 2) = (double)pos[2];
+		int vidx = hemesh.vertexLiveIndex(v);
+		positions(vidx, 0) = (double)pos[0];
+		positions(vidx, 1) = (double)pos[1];
+		positions(vidx, 2) = (double)pos[2];
 	}
 }
 
-void MeanCurvatureFlow::setPositions(Eigen::Matrix<double, Eigen::Dynamic, 3> &newPositions) {
+template<typename Kernel>
+void MeanCurvatureFlow<Kernel>::setPositions(Eigen::Matrix<double, Eigen::Dynamic, 3> &newPositions) {
+	hemesh.beginChanges();
 	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
 	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
 	for(; vit != vite; ++vit) {
 		ofxHEMeshVertex v = *vit;
+		int vidx = hemesh.vertexLiveIndex(v);
 		hemesh.vertexMoveTo(v, ofxHEMesh::Point(
-			newPositions(v.idx, 0),
-			newPositions(v.idx, 1),
-			newPositions(v.idx, 2)
+			newPositions(vidx, 0),
+			newPositions(vidx, 1),
+			newPositions(vidx, 2)
 		));
 	}
+	hemesh.commitChanges();
 }
 
-Geodesics::Geodesics(ofxHEMesh& hemesh)
+template<typename Kernel>
+Geodesics<Kernel>::Geodesics(ofxHEMesh& hemesh)
 : hemesh(hemesh)
 {}
 
-void Geodesics::build(vector<ofxHEMeshVertex>& impulseLocations, double dt, vector<ofxHEMesh::Scalar>& distances) {
-	hodgeStar0Form(hemesh, star0);
-	hodgeStar1Form(hemesh, star1);
+template<typename Kernel>
+bool Geodesics<Kernel>::build(vector<ofxHEMeshVertex>& impulseLocations, double dt, vector<Scalar>& distances) {
+	hodgeStar0Form<Kernel>(hemesh, star0);
+	hodgeStar1Form<Kernel>(hemesh, star1);
 	exteriorDerivative0Form(hemesh, d0);
 	L = d0.transpose()*star1*d0;
 	L += (1.0e-8)*star0;
@@ -191,7 +232,7 @@ void Geodesics::build(vector<ofxHEMeshVertex>& impulseLocations, double dt, vect
 	
 	
 	// extract geodesic
-	vector<ofxHEMesh::Direction> vectorField(hemesh.getNumFaces());
+	vector<Direction> vectorField(hemesh.getNumLiveFaces());
 	computeVectorField(u, vectorField);
 	
 	Eigen::Matrix<double, Eigen::Dynamic, 1> div;
@@ -211,29 +252,34 @@ void Geodesics::build(vector<ofxHEMeshVertex>& impulseLocations, double dt, vect
 		return false;
 	}
 	
+	// Matrices are indexed by live vertex, distances by vertex
 	double minPhi = phi.minCoeff();
-	distances.resize(hemesh.getNumVertices());
-	for(int i=0; i < phi.rows(); ++i) {
-		distances[i] = phi(i)-minPhi;
+	distances.assign(hemesh.getNumVertices(), 0);
+	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
+	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
+	for(; vit != vite; ++vit) {
+		distances[(*vit).idx] = phi(hemesh.vertexLiveIndex(*vit))-minPhi;
 	}
+	return true;
 }
 
-int Geodesics::buildImpulseSignal(vector<ofxHEMeshVertex>& impulseLocations) {
-	u0.resize(hemesh.getNumVertices(), 1);
+template<typename Kernel>
+int Geodesics<Kernel>::buildImpulseSignal(vector<ofxHEMeshVertex>& impulseLocations) {
+	u0.resize(hemesh.getNumLiveVertices(), 1);
 	u0.setZero();
 	for(int i=0; i < impulseLocations.size(); ++i) {
-		u0(impulseLocations[i].idx) = 1;
+		u0(hemesh.vertexLiveIndex(impulseLocations[i])) = 1;
 	}
 	return impulseLocations.size();
 }
 
-void Geodesics::computeVectorField(Eigen::Matrix<double, Eigen::Dynamic, 1>& u, vector<ofxHEMesh::Direction>& vectorField) {
-	ofxHEMeshFaceIterator fit = hemesh.facesBegin();
-	ofxHEMeshFaceIterator fite = hemesh.facesEnd();
-	for(; fit != fite; ++fit) {
+template<typename Kernel>
+void Geodesics<Kernel>::computeVectorField(Eigen::Matrix<double, Eigen::Dynamic, 1>& u, vector<Direction>& vectorField) {
+	ofxHEMeshKernelGeometry<Kernel> geometry(hemesh);
+	hemesh.parallelForFaces([&](ofxHEMeshFace f) {
 		// if( f->isBoundary() ) continue;
 		
-		ofxHEMeshHalfedge hij = hemesh.faceHalfedge(*fit);
+		ofxHEMeshHalfedge hij = hemesh.faceHalfedge(f);
 		ofxHEMeshHalfedge hjk = hemesh.halfedgeNext(hij);
 		ofxHEMeshHalfedge hki = hemesh.halfedgeNext(hjk);
 		
@@ -241,46 +287,59 @@ void Geodesics::computeVectorField(Eigen::Matrix<double, Eigen::Dynamic, 1>& u,
 		ofxHEMeshVertex vj = hemesh.halfedgeVertex(hij);
 		ofxHEMeshVertex vk = hemesh.halfedgeVertex(hjk);
 		
-		double ui = u(vi.idx);
-		double uj = u(vj.idx);
-		double uk = u(vk.idx);
+		double ui = u(hemesh.vertexLiveIndex(vi));
+		double uj = u(hemesh.vertexLiveIndex(vj));
+		double uk = u(hemesh.vertexLiveIndex(vk));
 		
-		ofxHEMesh::Direction eij90 = hemesh.halfedgeRotated(hij);
-		ofxHEMesh::Direction ejk90 = hemesh.halfedgeRotated(hjk);
-		ofxHEMesh::Direction eki90 = hemesh.halfedgeRotated(hki);
+		Direction eij90 = geometry.halfedgeRotated(hij);
+		Direction ejk90 = geometry.halfedgeRotated(hjk);
+		Direction eki90 = geometry.halfedgeRotated(hki);
 		
-		// Precision issues with floats
-		double fA = hemesh.faceArea(*fit);
-		double X = 0.5*(ui*double(ejk90.x) + uj*double(eki90.x) + uk*double(eij90.x))/fA;
-		double Y = 0.5*(ui*double(ejk90.y) + uj*double(eki90.y) + uk*double(eij90.y))/fA;
-		double Z = 0.5*(ui*double(ejk90.z) + uj*double(eki90.z) + uk*double(eij90.z))/fA;
+		// Precision issues with floats, use ofxHEMeshDoubleKernel
+		double fA = geometry.faceArea(f);
+		double X = 0.5*(ui*double(ejk90[0]) + uj*double(eki90[0]) + uk*double(eij90[0]))/fA;
+		double Y = 0.5*(ui*double(ejk90[1]) + uj*double(eki90[1]) + uk*double(eij90[1]))/fA;
+		double Z = 0.5*(ui*double(ejk90[2]) + uj*double(eki90[2]) + uk*double(eij90[2]))/fA;
 
 		double len = sqrt(X*X + Y*Y + Z*Z);
 		X /= -len;
 		Y /= -len;
 		Z /= -len;
-		vectorField[(*fit).idx] = ofVec3f(X, Y, Z);
-	}
+		vectorField[hemesh.faceLiveIndex(f)] = Direction(X, Y, Z);
+	});
 }
 
-void Geodesics::computeDivergence(Eigen::Matrix<double, Eigen::Dynamic, 1>& div, vector<ofxHEMesh::Direction>& vectorField) {
-	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
-	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
-	div.resize(hemesh.getNumVertices());
-	for(; vit != vite; ++vit) {
+template<typename Kernel>
+void Geodesics<Kernel>::computeDivergence(Eigen::Matrix<double, Eigen::Dynamic, 1>& div, vector<Direction>& vectorField) {
+	ofxHEMeshKernelGeometry<Kernel> geometry(hemesh);
+	div.resize(hemesh.getNumLiveVertices());
+	hemesh.parallelForVertices([&](ofxHEMeshVertex v) {
 		double sum = 0;
-		ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(*vit);
+		ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
 		ofxHEMeshVertexCirculator vce = vc;
 		do {
 			// TODO: check boundary
-			ofxHEMesh::Direction n = hemesh.halfedgeRotated(hemesh.halfedgePrev(*vc));
-			ofxHEMesh::Direction vv = vectorField[hemesh.halfedgeFace(*vc).idx];
+			Direction n = geometry.halfedgeRotated(hemesh.halfedgePrev(*vc));
+			Direction vv = vectorField[hemesh.faceLiveIndex(hemesh.halfedgeFace(*vc))];
 			sum += n.dot(vv);			
 			++vc;
 		} while(vc != vce);
 		
-		div((*vit).idx) = sum;
-	}
+		div(hemesh.vertexLiveIndex(v)) = sum;
+	});
 }
 
+
+#define OFX_HEMESH_DEC_INSTANTIATE(K) \
+	template void hodgeStar0Form<K>(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& star0); \
+	template void hodgeStar1Form<K>(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& star1); \
+	template void laplacian<K>(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& L); \
+	template class MeanCurvatureNormals<K>; \
+	template class MeanCurvatureFlow<K>; \
+	template class Geodesics<K>;
+
+OFX_HEMESH_DEC_INSTANTIATE(ofxHEMeshFloatKernel)
+OFX_HEMESH_DEC_INSTANTIATE(ofxHEMeshDoubleKernel)
+OFX_HEMESH_DEC_INSTANTIATE(ofxHEMeshSIMDKernel)
+
 } // hemesh::
\ No newline at end of file
@@ -1,20 +1,34 @@
 #pragma once
 #include "ofxHEMesh.h"
+#include "ofxHEMeshKernel.h"
 #include "Eigen/Sparse"
 
+/*
+The operators and solvers take the kernel their geometry is computed with.  The
+default is the mesh's own float kernel, which reads ofxHEMeshGeometry's caches;
+ofxHEMeshDoubleKernel computes areas, cotangents and gradients in double from
+the same mesh.  They're instantiated for the kernels in ofxHEMeshKernel.h.
+*/
+
 namespace hemesh {
 
+	template<typename Kernel=ofxHEMesh::Kernel>
 	void hodgeStar0Form(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& star0);
+	template<typename Kernel=ofxHEMesh::Kernel>
 	void hodgeStar1Form(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& star1);
 	void exteriorDerivative0Form(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& d0);
+	template<typename Kernel=ofxHEMesh::Kernel>
 	void laplacian(const ofxHEMesh& hemesh, Eigen::SparseMatrix<double>& L);
 
+	template<typename Kernel=ofxHEMesh::Kernel>
 	class MeanCurvatureNormals{
 	public:
+		typedef typename Kernel::Direction Direction;
+
 		MeanCurvatureNormals(ofxHEMesh& hemesh);
-		void getNormals(vector<ofxHEMesh::Direction>& normals);
-		ofxHEMesh::Direction getNormal(ofxHEMeshVertex v);
-		//ofxHEMesh::Scalar getMeanCurvature(ofxHEMeshVertex v);
+		void getNormals(vector<Direction>& normals);
+		Direction getNormal(ofxHEMeshVertex v);
+		//Scalar getMeanCurvature(ofxHEMeshVertex v);
 		
 		void build();
 		
@@ -27,11 +41,13 @@ namespace hemesh {
 		Eigen::Matrix<double, Eigen::Dynamic, 3> normals;
 	};
 	
+	template<typename Kernel=ofxHEMesh::Kernel>
 	class MeanCurvatureFlow{
 	public:
 		MeanCurvatureFlow(ofxHEMesh& hemesh);
 		
-		void step(double amt);
+		// Returns false if the solve failed, leaving the mesh unchanged
+		bool step(double amt);
 		
 	protected:
 		void getPositions();
@@ -43,16 +59,21 @@ namespace hemesh {
 		Eigen::Matrix<double, Eigen::Dynamic, 3> positions;
 	};
 	
+	template<typename Kernel=ofxHEMesh::Kernel>
 	class Geodesics{
 	public:
+		typedef typename Kernel::Scalar Scalar;
+		typedef typename Kernel::Direction Direction;
+
 		Geodesics(ofxHEMesh& hemesh);
 		
-		void build(vector<ofxHEMeshVertex>& impulseLocations, double dt, vector<ofxHEMesh::Scalar>& distances);
+		// Returns false if a solve failed, leaving distances unchanged
+		bool build(vector<ofxHEMeshVertex>& impulseLocations, double dt, vector<Scalar>& distances);
 		
 	protected:
 		int buildImpulseSignal(vector<ofxHEMeshVertex>& impulseLocations);
-		void computeVectorField(Eigen::Matrix<double, Eigen::Dynamic, 1>& u, vector<ofxHEMesh::Direction>& vectorField);
-		void computeDivergence(Eigen::Matrix<double, Eigen::Dynamic, 1>& div, vector<ofxHEMesh::Direction>& vectorField);
+		void computeVectorField(Eigen::Matrix<double, Eigen::Dynamic, 1>& u, vector<Direction>& vectorField);
+		void computeDivergence(Eigen::Matrix<double, Eigen::Dynamic, 1>& div, vector<Direction>& vectorField);
 	
 		ofxHEMesh& hemesh;
 		Eigen::Matrix<double, Eigen::Dynamic, 1> u0;
@@ -2,8 +2,12 @@
 
 ofxHEMeshDraw::ofxHEMeshDraw(ofxHEMesh& hemesh, NormalType normalType)
 :	hemesh(hemesh),
+	geometry(hemesh),
 	normalType(normalType),
 	meshVertexNormals(NULL),
+	limit(NULL),
+	limitScheme(ofxHEMeshLimit::CatmullClark),
+	drawLimitPoints(false),
 	drawVertices(false),
 	drawVertexLabels(false),
 	drawEdges(false),
@@ -16,18 +20,27 @@ ofxHEMeshDraw::ofxHEMeshDraw(ofxHEMesh& hemesh, NormalType normalType)
 	normalScale(0.05)
 {
 	setMaterial(BlackMaterial);
+	changeCursor = hemesh.addChangeCursor();
 }
 
 
 ofxHEMeshDraw::~ofxHEMeshDraw() {
+	hemesh.removeChangeCursor(changeCursor);
 	if(material) delete material;
+	if(limit) delete limit;
 }
 
 void ofxHEMeshDraw::draw(const ofCamera& camera) {
 	if(hemesh.getTopologyDirty()) {
-		if(normalType == VertexNormals) {
+		// everything gets rebuilt so the logged changes aren't needed
+		hemesh.readChanges(changeCursor, changedVertices, changedFaces);
+
+		if(normalType == VertexNormals || normalType == LimitNormals) {
 			calculateVertexNormals = true;
 		}
+		if(normalType == LimitNormals || drawLimitPoints) {
+			updateLimit();
+		}
 		if(drawEdges.enabled) {
 			updateEdges();
 		}
@@ -49,21 +62,36 @@ void ofxHEMeshDraw::draw(const ofCamera& camera) {
 		hemesh.setGeometryDirty(false);
 	}
 	else if(hemesh.getGeometryDirty()) {
-		if(normalType == VertexNormals) {
-			calculateVertexNormals = true;
+		bool tracked = hemesh.readChanges(changeCursor, changedVertices, changedFaces);
+		if(normalType == LimitNormals || drawLimitPoints) {
+			updateLimit();
 		}
 		
+		const ofVec3f *pts = gather(hemesh.getPoints(), uploadPoints);
 		if(drawEdges.enabled) {
-			edges.setVertexData(hemesh.getPoints().ptr(), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
+			edges.setVertexData(pts, hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
 		}
 		if(drawBoundaryEdges.enabled) {
-			boundaryEdges.setVertexData(hemesh.getPoints().ptr(), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
+			boundaryEdges.setVertexData(pts, hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
 		}
 		if(drawFaces.enabled) {
-			faces.setVertexData(hemesh.getPoints().ptr(), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
+			if(drawLimitPoints) pts = gather(limit->getPoints(), uploadLimitPoints);
+			faces.setVertexData(pts, hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
 		}
-		if(drawVertexNormals && calculateVertexNormals) {
-			updateVertexNormals();
+		if(normalType == VertexNormals || normalType == LimitNormals || drawVertexNormals) {
+			// Limit normals depend on more than the one-rings, updateLimit() redid them all
+			if(tracked && meshVertexNormals && normalType != LimitNormals) {
+				updateChangedVertexNormals();
+			}
+			else {
+				updateVertexNormals();
+			}
+			if((normalType == VertexNormals || normalType == LimitNormals) && drawFaces.enabled) {
+				faces.setNormalData(gather(*meshVertexNormals, uploadNormals), meshVertexNormals->size(), GL_DYNAMIC_DRAW);
+			}
+			if(drawVertexNormals) {
+				updateVertexNormalVectors();
+			}
 		}
 		hemesh.setGeometryDirty(false);
 	}
@@ -198,6 +226,26 @@ ofxHEMeshDraw& ofxHEMeshDraw::setDrawVertexNormals(bool v) {
 	return *this;
 }
 
+ofxHEMeshLimit::Scheme ofxHEMeshDraw::getLimitScheme() const {
+	return limitScheme;
+}
+
+ofxHEMeshDraw& ofxHEMeshDraw::setLimitScheme(ofxHEMeshLimit::Scheme v) {
+	limitScheme = v;
+	hemesh.setTopologyDirty(true);
+	return *this;
+}
+
+bool ofxHEMeshDraw::getDrawLimitPoints() const {
+	return drawLimitPoints;
+}
+
+ofxHEMeshDraw& ofxHEMeshDraw::setDrawLimitPoints(bool v) {
+	drawLimitPoints = v;
+	hemesh.setTopologyDirty(true);
+	return *this;
+}
+
 void ofxHEMeshDraw::setMaterial(MaterialType matType) {
 	bool usingArbTex = ofGetUsingArbTex();
 	ofDisableArbTex();
@@ -273,7 +321,7 @@ void ofxHEMeshDraw::vertexNormalVectors(vector<ofVec3f> &points, ofxHEMesh::Scal
 	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
 	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
 	for(; vit != vite; ++vit) {
-		ofxHEMesh::Point pt = hemesh.vertexPoint(*vit);
+		ofxHEMesh::Point pt = drawLimitPoints ? limit->limitPoint(*vit) : hemesh.vertexPoint(*vit);
 		ofxHEMesh::Point pt2 = pt + meshVertexNormals->get((*vit).idx);
 		points.push_back(pt);
 		points.push_back(pt2);
@@ -297,11 +345,20 @@ void ofxHEMeshDraw::boundaryEdgeIndices(vector<ofIndexType>& indices) {
 	}
 }
 
+// Contiguous properties are uploaded straight from their storage
+const ofVec3f * ofxHEMeshDraw::gather(const ofxHEMeshProperty<ofVec3f>& prop, vector<ofVec3f>& buffer) {
+	if(prop.ptr()) return prop.ptr();
+	buffer.resize(prop.size());
+	if(buffer.empty()) return NULL;
+	prop.copyTo(&buffer[0], 0, prop.size());
+	return &buffer[0];
+}
+
 void ofxHEMeshDraw::updateEdges() {
 	vector<ofIndexType> indices;
-	indices.reserve(hemesh.getNumEdges()*2);
+	indices.reserve(hemesh.getNumLiveEdges()*2);
 	edgeIndices(indices);
-	edges.setVertexData(hemesh.getPoints().ptr(), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
+	edges.setVertexData(gather(hemesh.getPoints(), uploadPoints), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
 	edges.setIndexData(&indices[0], indices.size(), GL_DYNAMIC_DRAW);
 	drawEdges.needsUpdate = false;
 }
@@ -309,18 +366,23 @@ void ofxHEMeshDraw::updateEdges() {
 void ofxHEMeshDraw::updateBoundaryEdges() {
 	vector<ofIndexType> indices;
 	boundaryEdgeIndices(indices);
-	boundaryEdges.setVertexData(hemesh.getPoints().ptr(), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
+	boundaryEdges.setVertexData(gather(hemesh.getPoints(), uploadPoints), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
 	boundaryEdges.setIndexData(&indices[0], indices.size(), GL_DYNAMIC_DRAW);
 	drawEdges.needsUpdate = false;
 }
 
 void ofxHEMeshDraw::updateFaces() {
 	vector<ofIndexType> indices;
-	indices.reserve(hemesh.getNumFaces()*3);	// minimally have triangle faces
+	indices.reserve(hemesh.getNumLiveFaces()*3);	// minimally have triangle faces
 	faceIndices(indices);
-	faces.setVertexData(hemesh.getPoints().ptr(), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
-	if(normalType == VertexNormals) {
-		faces.setNormalData(meshVertexNormals->ptr(), meshVertexNormals->size(), GL_DYNAMIC_DRAW);
+	if(drawLimitPoints) {
+		faces.setVertexData(gather(limit->getPoints(), uploadLimitPoints), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
+	}
+	else {
+		faces.setVertexData(gather(hemesh.getPoints(), uploadPoints), hemesh.getPoints().size(), GL_DYNAMIC_DRAW);
+	}
+	if(normalType == VertexNormals || normalType == LimitNormals) {
+		faces.setNormalData(gather(*meshVertexNormals, uploadNormals), meshVertexNormals->size(), GL_DYNAMIC_DRAW);
 	}
 	faces.setIndexData(&indices[0], indices.size(), GL_DYNAMIC_DRAW);
 	drawFaces.needsUpdate = false;
@@ -329,6 +391,7 @@ void ofxHEMeshDraw::updateFaces() {
 void ofxHEMeshDraw::updateNormals() {
 	switch(normalType) {
 		case VertexNormals:
+		case LimitNormals:
 			updateVertexNormals();
 			break;
 			
@@ -345,21 +408,38 @@ void ofxHEMeshDraw::updateNormals() {
 }
 
 void ofxHEMeshDraw::updateVertexNormals() {
+	if(normalType == LimitNormals) {
+		// Filled in by updateLimit()
+		meshVertexNormals = hemesh.addVertexProperty<ofxHEMesh::Direction>("limit-normals");
+		calculateVertexNormals = false;
+		return;
+	}
 	if(!meshVertexNormals) {
 		meshVertexNormals = hemesh.addVertexProperty<ofxHEMesh::Direction>("vertex-normals");
 	}
 
-	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
-	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
-	for(; vit != vite; ++vit) {
-		meshVertexNormals->set((*vit).idx, hemesh.angleWeightedVertexNormal(*vit));
-	}
+	geometry.update();
+	geometry.angleWeightedVertexNormals(*meshVertexNormals);
 	calculateVertexNormals = false;
 }
 
+// Only the one-rings around moved vertices need new normals
+void ofxHEMeshDraw::updateChangedVertexNormals() {
+	geometry.update(changedVertices, changedFaces, affectedVertices);
+	geometry.angleWeightedVertexNormals(*meshVertexNormals, affectedVertices);
+}
+
+void ofxHEMeshDraw::updateLimit() {
+	if(!limit) {
+		limit = new ofxHEMeshLimit(hemesh, limitScheme);
+	}
+	limit->setScheme(limitScheme);
+	limit->update();
+}
+
 void ofxHEMeshDraw::updateVertexNormalVectors() {
 	vector<ofVec3f> points;
-	points.reserve(hemesh.getNumVertices()*2);
+	points.reserve(hemesh.getNumLiveVertices()*2);
 	vertexNormalVectors(points, normalScale);
 	vertexNormals.setVertexData(&points[0], points.size(), GL_DYNAMIC_DRAW);
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include "ofxHEMesh.h"
+#include "ofxHEMeshGeometry.h"
+#include "ofxHEMeshLimit.h"
 
 
 class ofxHEMeshDraw {
@@ -7,7 +9,9 @@ public:
 	enum NormalType{
 		VertexNormals = 0,
 		FaceNormals,
-		NoNormals
+		NoNormals,
+		// Normals of the subdivision surface, see setLimitScheme()
+		LimitNormals
 	};
 	
 	enum MaterialType{
@@ -50,6 +54,11 @@ public:
 	ofxHEMeshDraw& setDrawFaces(bool v);
 	bool getDrawVertexNormals() const;
 	ofxHEMeshDraw& setDrawVertexNormals(bool v);
+	ofxHEMeshLimit::Scheme getLimitScheme() const;
+	ofxHEMeshDraw& setLimitScheme(ofxHEMeshLimit::Scheme v);
+	// Draw the faces at their vertices' limit points instead of the mesh's points
+	bool getDrawLimitPoints() const;
+	ofxHEMeshDraw& setDrawLimitPoints(bool v);
 	
 	ofShader * getMaterial() { return material; }
 	void setMaterial(MaterialType matType);
@@ -68,12 +77,19 @@ protected:
 	void updateFaces();
 	void updateNormals();
 	void updateVertexNormals();
+	void updateChangedVertexNormals();
 	void updateVertexNormalVectors();
+	void updateLimit();
+	const ofVec3f * gather(const ofxHEMeshProperty<ofVec3f>& prop, vector<ofVec3f>& buffer);
 
 
 	ofxHEMesh& hemesh;
+	ofxHEMeshGeometry geometry;
 	NormalType normalType;
 	ofxHEMeshProperty<ofVec3f> *meshVertexNormals;
+	ofxHEMeshLimit *limit;
+	ofxHEMeshLimit::Scheme limitScheme;
+	bool drawLimitPoints;
 	Property drawVertices;
 	Property drawVertexLabels;
 	Property drawEdges;
@@ -89,4 +105,12 @@ protected:
 	ofVbo faces;
 	ofVbo vertexNormals;
 	float normalScale;
+	int changeCursor;
+	vector<ofxHEMeshVertex> changedVertices;
+	vector<ofxHEMeshFace> changedFaces;
+	vector<ofxHEMeshVertex> affectedVertices;
+	// Properties shared with a copy aren't contiguous, they're gathered here for upload
+	vector<ofVec3f> uploadPoints;
+	vector<ofVec3f> uploadNormals;
+	vector<ofVec3f> uploadLimitPoints;
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+
+using std::vector;
+
+/*
+Flat open-addressing hash table mapping an undirected vertex pair to an integer
+(typically an edge index).  Keys are packed into 64 bits with the smaller vertex
+index in the high word so that (v1, v2) and (v2, v1) address the same slot.
+Storage is two flat arrays allocated once up front, so building connectivity
+for large meshes doesn't spend its time allocating tree nodes.
+*/
+class ofxHEMeshEdgeHash {
+public:
+	enum {
+		NotFound = -1
+	};
+
+	ofxHEMeshEdgeHash(int expectedEdges=0)
+	:	mask(0), count(0)
+	{
+		reserve(expectedEdges);
+	}
+
+	// Size the table for n edges without rehashing, discarding any contents
+	void reserve(int n) {
+		uint64_t capacity = 16;
+		while(capacity < uint64_t(n)*2) {
+			capacity <<= 1;
+		}
+		keys.assign(capacity, EmptyKey());
+		values.resize(capacity);
+		mask = capacity-1;
+		count = 0;
+	}
+
+	// Returns the value stored for the pair or stores value if the pair is new
+	int findOrInsert(int v1, int v2, int value, bool& inserted) {
+		if(uint64_t(count+1)*2 > mask+1) {
+			grow();
+		}
+
+		uint64_t k = key(v1, v2);
+		uint64_t slot = hash(k) & mask;
+		while(keys[slot] != EmptyKey()) {
+			if(keys[slot] == k) {
+				inserted = false;
+				return values[slot];
+			}
+			slot = (slot+1) & mask;
+		}
+		keys[slot] = k;
+		values[slot] = value;
+		++count;
+		inserted = true;
+		return value;
+	}
+
+	int find(int v1, int v2) const {
+		uint64_t k = key(v1, v2);
+		uint64_t slot = hash(k) & mask;
+		while(keys[slot] != EmptyKey()) {
+			if(keys[slot] == k) {
+				return values[slot];
+			}
+			slot = (slot+1) & mask;
+		}
+		return NotFound;
+	}
+
+	int size() const { return count; }
+
+	static uint64_t key(int v1, int v2) {
+		if(v1 > v2) {
+			int v = v1;
+			v1 = v2;
+			v2 = v;
+		}
+		return (uint64_t(uint32_t(v1)) << 32) | uint64_t(uint32_t(v2));
+	}
+
+protected:
+	static uint64_t EmptyKey() { return ~uint64_t(0); }
+
+	static uint64_t hash(uint64_t k) {
+		k *= 0x9E3779B97F4A7C15ULL;
+		return k ^ (k >> 29);
+	}
+
+	void grow() {
+		vector<uint64_t> oldKeys;
+		vector<int> oldValues;
+		oldKeys.swap(keys);
+		oldValues.swap(values);
+
+		uint64_t capacity = (mask+1)*2;
+		keys.assign(capacity, EmptyKey());
+		values.resize(capacity);
+		mask = capacity-1;
+		for(size_t i=0; i < oldKeys.size(); ++i) {
+			if(oldKeys[i] != EmptyKey()) {
+				uint64_t slot = hash(oldKeys[i]) & mask;
+				while(keys[slot] != EmptyKey()) {
+					slot = (slot+1) & mask;
+				}
+				keys[slot] = oldKeys[i];
+				values[slot] = oldValues[i];
+			}
+		}
+	}
+
+	vector<uint64_t> keys;
+	vector<int> values;
+	uint64_t mask;
+	int count;
+};
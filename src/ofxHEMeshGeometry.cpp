@@ -0,0 +1,239 @@
+#include "ofxHEMeshGeometry.h"
+#include <math.h>
+
+typedef ofxHEMesh::Scalar Scalar;
+
+// Triangles gathered for one batched update.  Corner i of a triangle is the
+// sink of halfedges[i], and halfedges[i+1] leaves it.
+struct ofxHEMeshTriangleBlock {
+	enum { Size = 256 };
+
+	ofxHEMeshTriangleBlock() : n(0) {}
+
+	void add(const ofxHEMesh& hemesh, ofxHEMeshFace f, ofxHEMeshHalfedge h0) {
+		ofxHEMeshHalfedge h[3];
+		h[0] = h0;
+		h[1] = hemesh.halfedgeNext(h[0]);
+		h[2] = hemesh.halfedgeNext(h[1]);
+		faces[n] = f.idx;
+		for(int i=0; i < 3; ++i) {
+			ofxHEMesh::Point p = hemesh.vertexPoint(hemesh.halfedgeVertex(h[i]));
+			halfedges[i][n] = h[i].idx;
+			x[i][n] = p.x;
+			y[i][n] = p.y;
+			z[i][n] = p.z;
+		}
+		++n;
+	}
+
+	int n;
+	int faces[Size];
+	int halfedges[3][Size];
+	Scalar x[3][Size];
+	Scalar y[3][Size];
+	Scalar z[3][Size];
+
+	// Results
+	Scalar nx[Size];
+	Scalar ny[Size];
+	Scalar nz[Size];
+	Scalar area[Size];
+	Scalar angle[3][Size];
+	Scalar cotan[3][Size];
+};
+
+// atan2(y, x) for y >= 0 without branches so the callers' loops vectorize.
+// The polynomial is Abramowitz & Stegun 4.4.49 (error below 2e-8 on [0, 1]).
+static inline Scalar angleFromSinCos(Scalar y, Scalar x) {
+	Scalar ax = fabsf(x);
+	Scalar hi = ax > y ? ax : y;
+	Scalar lo = ax > y ? y : ax;
+	Scalar t = hi > 0 ? lo/hi : 0;
+	Scalar t2 = t*t;
+	Scalar r = t*(1 + t2*(-0.3333314528f + t2*(0.1999355085f + t2*(-0.1420889944f + t2*(0.1065626393f +
+		t2*(-0.0752896400f + t2*(0.0429096138f + t2*(-0.0161657367f + t2*0.0028662257f))))))));
+	r = y > ax ? Scalar(M_PI_2) - r : r;
+	return x < 0 ? Scalar(M_PI) - r : r;
+}
+
+static void computeTriangles(ofxHEMeshTriangleBlock& b) {
+	for(int j=0; j < b.n; ++j) {
+		// edge i runs from corner i-1 to corner i
+		Scalar ex[3], ey[3], ez[3];
+		for(int i=0; i < 3; ++i) {
+			int prev = (i+2)%3;
+			ex[i] = b.x[i][j] - b.x[prev][j];
+			ey[i] = b.y[i][j] - b.y[prev][j];
+			ez[i] = b.z[i][j] - b.z[prev][j];
+		}
+
+		// the same cross product as ofxHEMesh::faceNormal
+		Scalar cx = ey[0]*ez[1] - ez[0]*ey[1];
+		Scalar cy = ez[0]*ex[1] - ex[0]*ez[1];
+		Scalar cz = ex[0]*ey[1] - ey[0]*ex[1];
+		Scalar len = sqrtf(cx*cx + cy*cy + cz*cz);
+		Scalar invLen = len > 0 ? 1/len : 0;
+		b.nx[j] = cx*invLen;
+		b.ny[j] = cy*invLen;
+		b.nz[j] = cz*invLen;
+		b.area[j] = 0.5f*len;
+
+		// every corner's edge pair spans the same parallelogram, so its sine
+		// term is len and the angle is atan2(len, cosine term)
+		for(int i=0; i < 3; ++i) {
+			int next = (i+1)%3;
+			Scalar dot = -(ex[i]*ex[next] + ey[i]*ey[next] + ez[i]*ez[next]);
+			b.angle[i][j] = angleFromSinCos(len, dot);
+			b.cotan[i][j] = dot*invLen;
+		}
+	}
+}
+
+ofxHEMeshGeometry::ofxHEMeshGeometry(const ofxHEMesh& hemesh)
+:	hemesh(hemesh)
+{}
+
+void ofxHEMeshGeometry::update() {
+	resize();
+	updateFaces(hemesh.getNumFaces(), NULL);
+}
+
+void ofxHEMeshGeometry::update(const vector<ofxHEMeshVertex>& vertices, const vector<ofxHEMeshFace>& faces, vector<ofxHEMeshVertex>& affected) {
+	resize();
+
+	// faces that changed or touch a changed vertex
+	vector<int> dirtyFaces;
+	for(int i=0; i < faces.size(); ++i) {
+		if(hemesh.faceHalfedge(faces[i]).isValid()) {
+			dirtyFaces.push_back(faces[i].idx);
+		}
+	}
+	for(int i=0; i < vertices.size(); ++i) {
+		if(!hemesh.vertexHalfedge(vertices[i]).isValid()) continue;
+		ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(vertices[i]);
+		ofxHEMeshVertexCirculator vce = vc;
+		do {
+			ofxHEMeshFace f = hemesh.halfedgeFace(*vc);
+			if(f.isValid()) dirtyFaces.push_back(f.idx);
+			++vc;
+		} while(vc != vce);
+	}
+	std::sort(dirtyFaces.begin(), dirtyFaces.end());
+	dirtyFaces.erase(std::unique(dirtyFaces.begin(), dirtyFaces.end()), dirtyFaces.end());
+	if(!dirtyFaces.empty()) {
+		updateFaces(int(dirtyFaces.size()), &dirtyFaces[0]);
+	}
+
+	// vertices whose one-ring includes a dirty face
+	affected.clear();
+	for(int i=0; i < vertices.size(); ++i) {
+		if(hemesh.vertexHalfedge(vertices[i]).isValid()) {
+			affected.push_back(vertices[i]);
+		}
+	}
+	for(int i=0; i < dirtyFaces.size(); ++i) {
+		ofxHEMeshFaceCirculator fc = hemesh.faceCirculate(ofxHEMeshFace(dirtyFaces[i]));
+		ofxHEMeshFaceCirculator fce = fc;
+		do {
+			affected.push_back(hemesh.halfedgeVertex(*fc));
+			++fc;
+		} while(fc != fce);
+	}
+	std::sort(affected.begin(), affected.end());
+	affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+}
+
+void ofxHEMeshGeometry::resize() {
+	faceNormals.resize(hemesh.getNumFaces());
+	faceAreas.resize(hemesh.getNumFaces());
+	cornerAngles.resize(hemesh.getNumHalfedges());
+	cornerCotans.resize(hemesh.getNumHalfedges());
+}
+
+// Recompute faces[0 .. n-1], or faces 0 .. n-1 when faces is NULL
+void ofxHEMeshGeometry::updateFaces(int n, const int *faces) {
+	hemesh::parallelFor(0, n, [&](int begin, int end) {
+		ofxHEMeshTriangleBlock block;
+		int i = begin;
+		while(i < end) {
+			block.n = 0;
+			for(; i < end && block.n < ofxHEMeshTriangleBlock::Size; ++i) {
+				ofxHEMeshFace f(faces ? faces[i] : i);
+				ofxHEMeshHalfedge h = hemesh.faceHalfedge(f);
+				if(!h.isValid()) continue;
+
+				if(hemesh.halfedgeNext(hemesh.halfedgeNext(hemesh.halfedgeNext(h))) == h) {
+					block.add(hemesh, f, h);
+					continue;
+				}
+
+				faceNormals[f.idx] = hemesh.faceNormal(f);
+				faceAreas[f.idx] = hemesh.faceArea(f);
+				ofxHEMeshFaceCirculator fc = hemesh.faceCirculate(f);
+				ofxHEMeshFaceCirculator fce = fc;
+				do {
+					cornerAngles[(*fc).idx] = hemesh.angleAtVertex(*fc);
+					cornerCotans[(*fc).idx] = hemesh.halfedgeCotan(hemesh.halfedgePrev(*fc));
+					++fc;
+				} while(fc != fce);
+			}
+
+			computeTriangles(block);
+			for(int j=0; j < block.n; ++j) {
+				int f = block.faces[j];
+				faceNormals[f] = ofxHEMesh::Direction(block.nx[j], block.ny[j], block.nz[j]);
+				faceAreas[f] = block.area[j];
+				for(int k=0; k < 3; ++k) {
+					cornerAngles[block.halfedges[k][j]] = block.angle[k][j];
+					cornerCotans[block.halfedges[k][j]] = block.cotan[k][j];
+				}
+			}
+		}
+	}, faces ? 1024 : ofxHEMeshTriangleBlock::Size*4);
+}
+
+ofxHEMesh::Direction ofxHEMeshGeometry::angleWeightedVertexNormal(ofxHEMeshVertex v) const {
+	ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+	ofxHEMeshVertexCirculator vce = vc;
+	
+	ofxHEMesh::Direction n(0, 0, 0);
+	do {
+		ofxHEMeshFace f = hemesh.halfedgeFace(*vc);
+		if(f.isValid()) {
+			n += faceNormals[f.idx]*cornerAngles[(*vc).idx];
+		}
+		++vc;
+	} while(vc != vce);
+	n.normalize();
+	return n;
+}
+
+ofxHEMesh::Scalar ofxHEMeshGeometry::vertexArea(ofxHEMeshVertex v) const {
+	Scalar A = 0;
+	ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+	ofxHEMeshVertexCirculator vce = vc;
+	do {
+		ofxHEMeshFace f = hemesh.halfedgeFace(*vc);
+		if(f.isValid()) {
+			A += faceAreas[f.idx];
+		}
+		++vc;
+	} while(vc != vce);
+	return A*0.333333333333333;
+}
+
+void ofxHEMeshGeometry::angleWeightedVertexNormals(ofxHEMeshProperty<ofxHEMesh::Direction>& normals) const {
+	normals.unshare(0, normals.size());
+	hemesh.parallelForVertices([&](ofxHEMeshVertex v) {
+		normals.set(v.idx, angleWeightedVertexNormal(v));
+	});
+}
+
+void ofxHEMeshGeometry::angleWeightedVertexNormals(ofxHEMeshProperty<ofxHEMesh::Direction>& normals, const vector<ofxHEMeshVertex>& vertices) const {
+	normals.unshare(0, normals.size());
+	hemesh::parallelFor(0, int(vertices.size()), [&](int begin, int end) {
+		for(int i=begin; i < end; ++i) {
+			normals.set(vertices[i].idx, angleWeightedVertexNormal(vertices[i]));
+		}
+	}, 1024);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "ofxHEMesh.h"
+
+/*
+Whole-mesh geometry computed in batches.  update() makes a single pass over the
+faces, computing each face's normal and area and the interior angle at each of
+its corners.  Vertex normals and areas are then summed from these caches instead
+of recomputing every incident face once per vertex.
+
+Triangles are processed in blocks whose corner coordinates are gathered into
+separate x, y and z arrays so the arithmetic vectorizes.  Other polygons fall
+back to the per-face ofxHEMesh functions.
+
+The caches are indexed by slot.  They aren't tracked against edits, so after
+the mesh changes either call update() or pass the changes read from an
+ofxHEMesh change cursor to update(vertices, faces, affected), which only
+recomputes faces in the one-rings of the changed vertices.
+*/
+class ofxHEMeshGeometry {
+public:
+	ofxHEMeshGeometry(const ofxHEMesh& hemesh);
+
+	void update();
+	// Update the faces touched by the given changes and return the vertices whose
+	// normals and areas depend on them
+	void update(const vector<ofxHEMeshVertex>& vertices, const vector<ofxHEMeshFace>& faces, vector<ofxHEMeshVertex>& affected);
+
+	ofxHEMesh::Direction faceNormal(ofxHEMeshFace f) const { return faceNormals[f.idx]; }
+	ofxHEMesh::Scalar faceArea(ofxHEMeshFace f) const { return faceAreas[f.idx]; }
+	// Angle between h and the next halfedge in h's face, at h's sink
+	ofxHEMesh::Scalar cornerAngle(ofxHEMeshHalfedge h) const { return cornerAngles[h.idx]; }
+	// Cotangent of the angle opposite h in its face (0 on the boundary), see ofxHEMesh::halfedgeCotan
+	ofxHEMesh::Scalar halfedgeCotan(ofxHEMeshHalfedge h) const {
+		return hemesh.halfedgeFace(h).isValid() ? cornerCotans[hemesh.halfedgeNext(h).idx] : 0;
+	}
+
+	ofxHEMesh::Direction angleWeightedVertexNormal(ofxHEMeshVertex v) const;
+	ofxHEMesh::Scalar vertexArea(ofxHEMeshVertex v) const;
+	// Set normals[v] for every live vertex
+	void angleWeightedVertexNormals(ofxHEMeshProperty<ofxHEMesh::Direction>& normals) const;
+	void angleWeightedVertexNormals(ofxHEMeshProperty<ofxHEMesh::Direction>& normals, const vector<ofxHEMeshVertex>& vertices) const;
+
+protected:
+	void resize();
+	void updateFaces(int n, const int *faces);
+
+	const ofxHEMesh& hemesh;
+	vector<ofxHEMesh::Direction> faceNormals;
+	vector<ofxHEMesh::Scalar> faceAreas;
+	vector<ofxHEMesh::Scalar> cornerAngles;
+	vector<ofxHEMesh::Scalar> cornerCotans;
+};
@@ -34,13 +34,7 @@ ofxHEMeshFace* ofxHEMeshFaceIterator::operator->() {
 }
 
 ofxHEMeshFaceIterator& ofxHEMeshFaceIterator::operator++() {
-	int n = hemesh->faceAdjacency->size();
-	do {
-		++f.idx;
-		if(hemesh->faceHalfedge(f).isValid()) {
-			break;
-		}
-	} while(f.idx < n);
+	f.idx = hemesh->liveFaces.next(f.idx+1, hemesh->faceAdjacency->size());
 	return *this;
 }
 
@@ -51,12 +45,7 @@ ofxHEMeshFaceIterator ofxHEMeshFaceIterator::operator++(int) {
 }
 
 ofxHEMeshFaceIterator& ofxHEMeshFaceIterator::operator--() {
-	do {
-		--f.idx;
-		if(hemesh->faceHalfedge(f).isValid()) {
-			break;
-		}
-	} while(f.idx > 0);
+	f.idx = MAX(hemesh->liveFaces.prev(f.idx-1), 0);
 	return *this;
 }
 
@@ -100,14 +89,8 @@ ofxHEMeshHalfedge* ofxHEMeshEdgeIterator::operator->() {
 }
 
 ofxHEMeshEdgeIterator& ofxHEMeshEdgeIterator::operator++() {
-	int n = hemesh->halfedgeAdjacency->size();
-	do {
-		h.idx += 2;
-		if(hemesh->halfedgeVertex(h).isValid()) {
-			break;
-		}
-	} while(h.idx < n);
-	h.idx = MIN(h.idx, n);
+	int n = hemesh->halfedgeAdjacency->size()/2;
+	h.idx = 2*hemesh->liveEdges.next(h.idx/2+1, n);
 	return *this;
 }
 
@@ -118,13 +101,7 @@ ofxHEMeshEdgeIterator ofxHEMeshEdgeIterator::operator++(int) {
 }
 
 ofxHEMeshEdgeIterator& ofxHEMeshEdgeIterator::operator--() {
-	do {
-		h.idx -= 2;
-		if(hemesh->halfedgeVertex(h).isValid()) {
-			break;
-		}
-	} while(h.idx > 0);
-	h.idx = MAX(h.idx, 0);
+	h.idx = 2*MAX(hemesh->liveEdges.prev(h.idx/2-1), 0);
 	return *this;
 }
 
@@ -167,13 +144,7 @@ ofxHEMeshVertex* ofxHEMeshVertexIterator::operator->() {
 }
 
 ofxHEMeshVertexIterator& ofxHEMeshVertexIterator::operator++() {
-	int n = hemesh->vertexAdjacency->size();
-	do {
-		++v.idx;
-		if(hemesh->vertexHalfedge(v).isValid()) {
-			break;
-		}
-	} while(v.idx < n);
+	v.idx = hemesh->liveVertices.next(v.idx+1, hemesh->vertexAdjacency->size());
 	return *this;
 }
 
@@ -184,12 +155,7 @@ ofxHEMeshVertexIterator ofxHEMeshVertexIterator::operator++(int) {
 }
 
 ofxHEMeshVertexIterator& ofxHEMeshVertexIterator::operator--() {
-	do {
-		--v.idx;
-		if(hemesh->vertexHalfedge(v).isValid()) {
-			break;
-		}
-	} while(v.idx > 0);
+	v.idx = MAX(hemesh->liveVertices.prev(v.idx-1), 0);
 	return *this;
 }
 
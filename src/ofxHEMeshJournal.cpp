@@ -0,0 +1,567 @@
+#include "ofxHEMeshJournal.h"
+#include <fstream>
+#include <string.h>
+
+
+static const char Magic[4] = {'H', 'E', 'J', 'L'};
+static const uint32_t Version = 1;
+static const uint32_t ByteOrderMark = 0x01020304;
+
+struct ofxHEMeshJournalHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	int32_t numSteps;
+};
+
+struct ofxHEMeshJournalStepHeader {
+	int32_t numCommands;
+	int32_t numInts;
+	int32_t numPoints;
+};
+
+
+void ofxHEMeshJournal::Scope::begin(Op op, int a, int b) {
+	if(journal->applying > 0) {
+		journal = NULL;
+		return;
+	}
+	if(journal->commandDepth == 0 && journal->isRecording()) {
+		Step& step = journal->current();
+		Command cmd(op, a, b);
+		cmd.intBegin = int(step.ints.size());
+		cmd.pointBegin = int(step.points.size());
+		command = int(step.commands.size());
+		step.commands.push_back(cmd);
+	}
+	++journal->commandDepth;
+
+	if(isBulk(op) && journal->isRecording()) {
+		Step& step = journal->current();
+		step.snapshots.push_back(std::make_shared<ofxHEMesh>(journal->mesh));
+		journal->addDelta(SnapshotDelta, 0, 0, 0, int(step.snapshots.size())-1);
+		bulk = true;
+		++journal->bulkDepth;
+	}
+}
+
+void ofxHEMeshJournal::Scope::end() {
+	if(bulk) --journal->bulkDepth;
+	--journal->commandDepth;
+}
+
+ofxHEMeshJournal::Command * ofxHEMeshJournal::Scope::get() {
+	if(!journal || command < 0) return NULL;
+	return &journal->steps[journal->position].commands[command];
+}
+
+void ofxHEMeshJournal::Scope::setScalar(Scalar s) {
+	Command *cmd = get();
+	if(cmd) cmd->s = s;
+}
+
+void ofxHEMeshJournal::Scope::setPoint(const Point& p) {
+	Command *cmd = get();
+	if(cmd) {
+		cmd->p[0] = p.x;
+		cmd->p[1] = p.y;
+		cmd->p[2] = p.z;
+	}
+}
+
+void ofxHEMeshJournal::Scope::addInt(int v) {
+	Command *cmd = get();
+	if(cmd) {
+		journal->steps[journal->position].ints.push_back(v);
+		++cmd->numInts;
+	}
+}
+
+void ofxHEMeshJournal::Scope::addPoint(const Point& p) {
+	Command *cmd = get();
+	if(cmd) {
+		journal->steps[journal->position].points.push_back(p);
+		++cmd->numPoints;
+	}
+}
+
+void ofxHEMeshJournal::Scope::addPoints(const Point *p, size_t n) {
+	Command *cmd = get();
+	if(cmd) {
+		vector<Point>& points = journal->steps[journal->position].points;
+		points.insert(points.end(), p, p+n);
+		cmd->numPoints += int(n);
+	}
+}
+
+
+ofxHEMeshJournal::ofxHEMeshJournal(ofxHEMesh& mesh)
+:	mesh(mesh),
+	position(0),
+	recording(false),
+	commandDepth(0),
+	bulkDepth(0),
+	applying(0)
+{
+	mesh.setJournal(this);
+}
+
+ofxHEMeshJournal::~ofxHEMeshJournal() {
+	if(mesh.getJournal() == this) {
+		mesh.setJournal(NULL);
+	}
+}
+
+int ofxHEMeshJournal::checkpoint() {
+	if(recording) {
+		recording = false;
+		if(steps[position].empty()) steps.pop_back();
+		else ++position;
+	}
+	return position;
+}
+
+bool ofxHEMeshJournal::undo() {
+	if(applying > 0 || commandDepth > 0) return false;
+	mesh.flushChanges();
+	checkpoint();
+	if(position == 0) return false;
+	--position;
+	apply(steps[position], true);
+	return true;
+}
+
+bool ofxHEMeshJournal::redo() {
+	if(applying > 0 || commandDepth > 0) return false;
+	mesh.flushChanges();
+	checkpoint();
+	if(position >= int(steps.size())) return false;
+	apply(steps[position], false);
+	++position;
+	return true;
+}
+
+bool ofxHEMeshJournal::rollback(int id) {
+	if(id < 0 || id > getNumUndoSteps()) return false;
+	while(getNumUndoSteps() > id) {
+		if(!undo()) return false;
+	}
+	return true;
+}
+
+int ofxHEMeshJournal::getNumUndoSteps() const {
+	// a step is only started when there's something to record in it
+	return position + (recording ? 1 : 0);
+}
+
+int ofxHEMeshJournal::getNumRedoSteps() const {
+	return recording ? 0 : int(steps.size()) - position;
+}
+
+void ofxHEMeshJournal::clear() {
+	steps.clear();
+	position = 0;
+	recording = false;
+}
+
+size_t ofxHEMeshJournal::memoryUsage() const {
+	size_t bytes = 0;
+	for(int i=0; i < steps.size(); ++i) {
+		const Step& step = steps[i];
+		bytes += sizeof(Step);
+		bytes += step.deltas.capacity()*sizeof(Delta);
+		bytes += step.values.capacity();
+		for(int k=0; k < NumElementKinds; ++k) {
+			const ResetItems& saved = step.resets[k];
+			for(int j=0; j < saved.properties.size(); ++j) {
+				const ofxHEMeshPropertyBase *prop = saved.properties[j].get();
+				if(prop) bytes += size_t(prop->capacity())*size_t(prop->elementSize());
+			}
+		}
+		bytes += step.snapshots.capacity()*sizeof(std::shared_ptr<ofxHEMesh>);
+		bytes += step.commands.capacity()*sizeof(Command);
+		bytes += step.ints.capacity()*sizeof(int);
+		bytes += step.points.capacity()*sizeof(Point);
+	}
+	return bytes;
+}
+
+ofxHEMeshJournal::Step& ofxHEMeshJournal::current() {
+	if(!recording) {
+		steps.resize(position);
+		steps.push_back(Step());
+		recording = true;
+	}
+	return steps[position];
+}
+
+void ofxHEMeshJournal::addDelta(int kind, int set, int idx, int from, int to) {
+	Delta delta;
+	delta.kind = (unsigned char)kind;
+	delta.set = (unsigned char)set;
+	delta.idx = idx;
+	delta.from = from;
+	delta.to = to;
+	current().deltas.push_back(delta);
+}
+
+void ofxHEMeshJournal::recordAdjacency(Op op, int idx, int from, int to) {
+	if(commandDepth == 0) {
+		current().commands.push_back(Command(op, idx, to));
+	}
+	if(from != to) {
+		addDelta(op, 0, idx, from, to);
+	}
+}
+
+void ofxHEMeshJournal::recordPoint(int v, const Point& from, const Point& to) {
+	Step& step = current();
+	int offset = int(step.values.size());
+	step.values.resize(offset + 2*sizeof(Point));
+	memcpy(&step.values[offset], &from, sizeof(Point));
+	memcpy(&step.values[offset+sizeof(Point)], &to, sizeof(Point));
+	addDelta(PointDelta, 0, v, offset, 0);
+}
+
+void ofxHEMeshJournal::recordSize(int kind, int from, int to) {
+	addDelta(SizeDelta, kind, 0, from, to);
+}
+
+void ofxHEMeshJournal::recordReset(int kind, int idx) {
+	const ofxHEMeshPropertySet& properties = mesh.elementProperties(kind);
+	ResetItems& saved = current().resets[kind];
+	if(saved.properties.size() < properties.getNumProperties()) {
+		saved.properties.resize(properties.getNumProperties());
+	}
+	int row = saved.count++;
+	for(int i=0; i < properties.getNumProperties(); ++i) {
+		const ofxHEMeshPropertyBase *prop = properties.getProperty(i);
+		if(!prop) continue;
+		if(!saved.properties[i]) saved.properties[i].reset(prop->create());
+		// rows of items reset before the property was added keep the default
+		saved.properties[i]->resize(row+1);
+		saved.properties[i]->copyItemFrom(*prop, idx, row);
+	}
+	addDelta(ResetDelta, kind, idx, row, 0);
+}
+
+void ofxHEMeshJournal::recordFreePush(int kind, int idx) {
+	addDelta(FreePushDelta, kind, idx, 0, 0);
+}
+
+void ofxHEMeshJournal::recordFreePop(int kind, int idx) {
+	addDelta(FreePopDelta, kind, idx, 0, 0);
+}
+
+void ofxHEMeshJournal::apply(Step& step, bool undo) {
+	++applying;
+
+	// Listeners are reset instead of told about single moves when the vertex
+	// set changes, since they may not know the vertices being moved
+	bool verticesChanged = false;
+	for(int i=0; i < step.deltas.size() && !verticesChanged; ++i) {
+		const Delta& d = step.deltas[i];
+		if(d.kind == SizeDelta) {
+			verticesChanged = d.set == ofxHEMesh::VertexElements;
+		}
+		else if(d.kind == SetVertexHalfedge) {
+			verticesChanged = (d.from >= 0) != (d.to >= 0);
+		}
+	}
+
+	int n = int(step.deltas.size());
+	for(int i=0; i < n; ++i) {
+		const Delta& d = step.deltas[undo ? n-1-i : i];
+		int value = undo ? d.from : d.to;
+		switch(d.kind) {
+			case SetVertexHalfedge:
+				mesh.setVertexHalfedge(ofxHEMeshVertex(d.idx), ofxHEMeshHalfedge(value));
+				break;
+			case SetFaceHalfedge:
+				mesh.setFaceHalfedge(ofxHEMeshFace(d.idx), ofxHEMeshHalfedge(value));
+				break;
+			case SetHalfedgeVertex:
+				mesh.setHalfedgeVertex(ofxHEMeshHalfedge(d.idx), ofxHEMeshVertex(value));
+				break;
+			case SetHalfedgeFace:
+				mesh.setHalfedgeFace(ofxHEMeshHalfedge(d.idx), ofxHEMeshFace(value));
+				break;
+			case SetHalfedgeNext:
+				mesh.setHalfedgeNext(ofxHEMeshHalfedge(d.idx), ofxHEMeshHalfedge(value));
+				break;
+			case SetHalfedgePrev:
+				mesh.setHalfedgePrev(ofxHEMeshHalfedge(d.idx), ofxHEMeshHalfedge(value));
+				break;
+
+			case PointDelta: {
+				Point p;
+				memcpy(&p, &step.values[d.from + (undo ? 0 : sizeof(Point))], sizeof(Point));
+				ofxHEMeshVertex v(d.idx);
+				if(!verticesChanged) {
+					mesh.notifyGeometryListeners(v, p, &ofxHEMesh::GeometryListener::vertexWillBeMovedTo);
+				}
+				mesh.points->set(v.idx, p);
+				mesh.changes.markVertex(v.idx);
+				break;
+			}
+
+			case SizeDelta:
+				mesh.elementProperties(d.set).resize(value);
+				mesh.changes.markAll();
+				break;
+
+			case ResetDelta:
+				if(undo) {
+					ofxHEMeshPropertySet& properties = mesh.elementProperties(d.set);
+					const ResetItems& saved = step.resets[d.set];
+					int nprops = std::min(properties.getNumProperties(), int(saved.properties.size()));
+					for(int j=0; j < nprops; ++j) {
+						ofxHEMeshPropertyBase *prop = properties.getProperty(j);
+						const ofxHEMeshPropertyBase *values = saved.properties[j].get();
+						// properties added or replaced since aren't tracked
+						if(!prop || !values || !prop->sameType(*values)) continue;
+						prop->copyItemFrom(*values, d.from, d.idx);
+					}
+				}
+				else {
+					mesh.elementProperties(d.set).resetItem(d.idx);
+				}
+				break;
+
+			case FreePushDelta:
+				if(undo) mesh.freeList(d.set).pop();
+				else mesh.freeList(d.set).push(d.idx);
+				break;
+
+			case FreePopDelta:
+				if(undo) mesh.freeList(d.set).push(d.idx);
+				else mesh.freeList(d.set).pop();
+				break;
+
+			case SnapshotDelta:
+				// swap() shares the snapshot's blocks into the mesh's own property
+				// objects, so pointers to them stay valid, and the snapshot takes
+				// the state being left, for going back again
+				mesh.swap(*step.snapshots[d.to]);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	mesh.topologyDirty = true;
+	mesh.geometryDirty = true;
+	if(verticesChanged) {
+		mesh.changes.markAll();
+		mesh.notifyGeometryListeners(ofxHEMeshVertex(), &ofxHEMesh::GeometryListener::verticesCleared);
+		mesh.notifyGeometryListeners(ofxHEMeshVertex(0), mesh.getNumVertices(), &ofxHEMesh::GeometryListener::verticesAdded);
+	}
+	--applying;
+}
+
+void ofxHEMeshJournal::recordedSteps(vector<const Step *>& done) const {
+	int n = getNumUndoSteps();
+	for(int i=0; i < n; ++i) {
+		done.push_back(&steps[i]);
+	}
+}
+
+bool ofxHEMeshJournal::save(const string& fileName) const {
+	std::ofstream stream(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!stream.is_open()) {
+		ofLogError("ofxHEMeshJournal") << "save(): couldn't open \"" << fileName << "\" for writing";
+		return false;
+	}
+
+	vector<const Step *> done;
+	recordedSteps(done);
+
+	ofxHEMeshJournalHeader header;
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.byteOrder = ByteOrderMark;
+	header.numSteps = int32_t(done.size());
+	stream.write((const char *)&header, sizeof(header));
+
+	for(int i=0; i < done.size(); ++i) {
+		const Step& step = *done[i];
+		ofxHEMeshJournalStepHeader stepHeader;
+		stepHeader.numCommands = int32_t(step.commands.size());
+		stepHeader.numInts = int32_t(step.ints.size());
+		stepHeader.numPoints = int32_t(step.points.size());
+		stream.write((const char *)&stepHeader, sizeof(stepHeader));
+		if(!step.commands.empty()) {
+			stream.write((const char *)&step.commands[0], step.commands.size()*sizeof(Command));
+		}
+		for(int j=0; j < step.ints.size(); ++j) {
+			int32_t v = step.ints[j];
+			stream.write((const char *)&v, sizeof(v));
+		}
+		for(int j=0; j < step.points.size(); ++j) {
+			float p[3] = {step.points[j].x, step.points[j].y, step.points[j].z};
+			stream.write((const char *)p, sizeof(p));
+		}
+	}
+	return stream.good();
+}
+
+bool ofxHEMeshJournal::replay(ofxHEMesh& target) const {
+	// Copy the operations first, replaying onto the journal's own mesh adds steps
+	vector<const Step *> done;
+	recordedSteps(done);
+	vector<Step> session(done.size());
+	for(int i=0; i < done.size(); ++i) {
+		session[i].commands = done[i]->commands;
+		session[i].ints = done[i]->ints;
+		session[i].points = done[i]->points;
+	}
+	return replaySteps(session, target);
+}
+
+bool ofxHEMeshJournal::replay(const string& fileName, ofxHEMesh& mesh) {
+	std::ifstream stream(fileName.c_str(), std::ios::in | std::ios::binary);
+	if(!stream.is_open()) {
+		ofLogError("ofxHEMeshJournal") << "replay(): couldn't read \"" << fileName << "\"";
+		return false;
+	}
+
+	ofxHEMeshJournalHeader header;
+	stream.read((char *)&header, sizeof(header));
+	if(!stream || memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+		ofLogError("ofxHEMeshJournal") << "replay(): \"" << fileName << "\" isn't a journal file";
+		return false;
+	}
+	if(header.byteOrder != ByteOrderMark || header.version != Version || header.numSteps < 0) {
+		ofLogError("ofxHEMeshJournal") << "replay(): unsupported version or byte order in \"" << fileName << "\"";
+		return false;
+	}
+
+	vector<Step> session(header.numSteps);
+	for(int i=0; i < header.numSteps; ++i) {
+		ofxHEMeshJournalStepHeader stepHeader;
+		stream.read((char *)&stepHeader, sizeof(stepHeader));
+		bool valid = stream && stepHeader.numCommands >= 0 && stepHeader.numInts >= 0 && stepHeader.numPoints >= 0;
+		if(valid) {
+			Step& step = session[i];
+			step.commands.resize(stepHeader.numCommands);
+			if(!step.commands.empty()) {
+				stream.read((char *)&step.commands[0], step.commands.size()*sizeof(Command));
+			}
+			step.ints.resize(stepHeader.numInts);
+			for(int j=0; j < step.ints.size(); ++j) {
+				int32_t v;
+				stream.read((char *)&v, sizeof(v));
+				step.ints[j] = v;
+			}
+			step.points.resize(stepHeader.numPoints);
+			for(int j=0; j < step.points.size(); ++j) {
+				float p[3];
+				stream.read((char *)p, sizeof(p));
+				step.points[j] = Point(p[0], p[1], p[2]);
+			}
+			valid = bool(stream);
+			for(int j=0; valid && j < step.commands.size(); ++j) {
+				const Command& cmd = step.commands[j];
+				valid = cmd.intBegin >= 0 && cmd.numInts >= 0 && cmd.intBegin+cmd.numInts <= step.ints.size() &&
+					cmd.pointBegin >= 0 && cmd.numPoints >= 0 && cmd.pointBegin+cmd.numPoints <= step.points.size();
+			}
+		}
+		if(!valid) {
+			ofLogError("ofxHEMeshJournal") << "replay(): \"" << fileName << "\" is truncated or corrupt";
+			return false;
+		}
+	}
+	return replaySteps(session, mesh);
+}
+
+bool ofxHEMeshJournal::replaySteps(const vector<Step>& session, ofxHEMesh& mesh) {
+	for(int i=0; i < session.size(); ++i) {
+		const Step& step = session[i];
+		for(int j=0; j < step.commands.size(); ++j) {
+			if(!run(mesh, step, step.commands[j])) {
+				ofLogError("ofxHEMeshJournal") << "replay(): journal command " << step.commands[j].op << " can't be replayed";
+				return false;
+			}
+		}
+		if(mesh.getJournal()) {
+			mesh.getJournal()->checkpoint();
+		}
+	}
+	return true;
+}
+
+bool ofxHEMeshJournal::run(ofxHEMesh& mesh, const Step& step, const Command& cmd) {
+	const int *ints = cmd.numInts > 0 ? &step.ints[cmd.intBegin] : NULL;
+	const Point *points = cmd.numPoints > 0 ? &step.points[cmd.pointBegin] : NULL;
+	vector<ofxHEMeshVertex> vertices;
+	for(int i=0; i < cmd.numInts; ++i) {
+		vertices.push_back(ofxHEMeshVertex(ints[i]));
+	}
+
+	ofxHEMeshVertex v(cmd.a);
+	ofxHEMeshHalfedge h(cmd.a);
+	ofxHEMeshFace f(cmd.a);
+	switch(cmd.op) {
+		case AddVertex: mesh.addVertex(cmd.point()); break;
+		case AddEdge: mesh.addEdge(); break;
+		case AddEdges: mesh.addEdges(cmd.a); break;
+		case AddFace: mesh.addFace(vertices); break;
+		case RemoveVertex: mesh.removeVertex(v); break;
+		case RemoveVertices: mesh.removeVertices(vertices); break;
+		case RemoveHalfedge: mesh.removeHalfedge(h); break;
+		case EraseHalfedge: mesh.eraseHalfedge(h); break;
+		case RemoveFace: mesh.removeFace(f); break;
+		case RemoveFaceIfDegenerate: mesh.removeFaceIfDegenerate(f); break;
+		case ConnectFacesSimple: mesh.connectFacesSimple(h, ofxHEMeshHalfedge(cmd.b)); break;
+		case ConnectHalfedgesCofacial: mesh.connectHalfedgesCofacial(h, ofxHEMeshHalfedge(cmd.b)); break;
+		case SplitHalfedge: mesh.splitHalfedge(h, Scalar(cmd.s)); break;
+		case SplitHalfedgeAt: mesh.splitHalfedge(h, cmd.point()); break;
+		case SplitHalfedgeQuadraticFit: mesh.splitHalfedgeQuadraticFit(h); break;
+		case CollapseHalfedge: mesh.collapseHalfedge(h, Scalar(cmd.s)); break;
+		case CollapseHalfedgeAt: mesh.collapseHalfedge(h, cmd.point()); break;
+		case CollapseHalfedgeQuadraticFit: mesh.collapseHalfedgeQuadraticFit(h); break;
+		case VertexMove: mesh.vertexMove(v, cmd.point()); break;
+		case VertexMoveTo: mesh.vertexMoveTo(v, cmd.point()); break;
+		case BeginChanges: mesh.beginChanges(); break;
+		case CommitChanges: mesh.commitChanges(); break;
+		case SetVertexHalfedge: mesh.setVertexHalfedge(v, ofxHEMeshHalfedge(cmd.b)); break;
+		case SetFaceHalfedge: mesh.setFaceHalfedge(f, ofxHEMeshHalfedge(cmd.b)); break;
+		case SetHalfedgeVertex: mesh.setHalfedgeVertex(h, ofxHEMeshVertex(cmd.b)); break;
+		case SetHalfedgeFace: mesh.setHalfedgeFace(h, ofxHEMeshFace(cmd.b)); break;
+		case SetHalfedgeNext: mesh.setHalfedgeNext(h, ofxHEMeshHalfedge(cmd.b)); break;
+		case SetHalfedgePrev: mesh.setHalfedgePrev(h, ofxHEMeshHalfedge(cmd.b)); break;
+		case SwapHalfedgeAdjacency: mesh.swapHalfedgeAdjacency(h, ofxHEMeshHalfedge(cmd.b)); break;
+
+		case ClearVertices: mesh.clearVertices(); break;
+		case ClearHalfedges: mesh.clearHalfedges(); break;
+		case ClearFaces: mesh.clearFaces(); break;
+		case RemoveAllVertices: mesh.removeAllVertices(); break;
+		case AddVertices: mesh.addVertices(points, cmd.numPoints); break;
+		case AddFaces: {
+			if(cmd.a < 1 || cmd.numInts < cmd.a+1) return false;
+			vector<int> faceOffsets(ints, ints+cmd.a+1);
+			vector<ofxHEMeshVertex> faceVertices(vertices.begin()+cmd.a+1, vertices.end());
+			mesh.addFaces(faceOffsets, faceVertices);
+			break;
+		}
+		case AddFacesOfSize: mesh.addFaces(vertices, cmd.a); break;
+		case SetAllocationPolicy: mesh.setAllocationPolicy(ofxHEMesh::AllocationPolicy(cmd.a)); break;
+		case Compact: mesh.compact(); break;
+		case RemeshLoop: mesh.remeshLoop(); break;
+		case SubdivideLoop: mesh.subdivideLoop(); break;
+		case SubdivideCatmullClark: mesh.subdivideCatmullClark(); break;
+		case SubdivideDooSabin: mesh.subdivideDooSabin(); break;
+		case SubdivideModifiedCornerCut: mesh.subdivideModifiedCornerCut(Scalar(cmd.s)); break;
+		case FacePeel: mesh.facePeel(Scalar(cmd.s)); break;
+		case Dual: mesh.dual(); break;
+		case Triangulate: mesh.triangulate(); break;
+		case CentroidTriangulation: mesh.centroidTriangulation(); break;
+		case ReverseFaces: mesh.reverseFaces(); break;
+		case Translate: mesh.translate(cmd.point()); break;
+
+		default:
+			return false;
+	}
+	return true;
+}
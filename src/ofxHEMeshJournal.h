@@ -0,0 +1,263 @@
+#pragma once
+#include "ofxHEMesh.h"
+#include <memory>
+#include <stdint.h>
+
+/*
+Undo, redo and replay for the edits made to a mesh.  While a journal is
+attached, every primitive write is recorded as a small delta holding the old
+and new value: adjacency set through the set*() functions, points, elements
+appended or recycled, and free list pushes and pops.  Undoing writes back the
+old values, so its cost is proportional to the edit rather than the mesh.
+
+Operations that rewrite whole property arrays (subdivision, addFaces(),
+compact(), clearing, ...) bypass the setters.  They're recorded as a snapshot of
+the mesh taken before them instead, which shares the property blocks (see
+ofxHEMeshProperty) so it costs O(#blocks) plus the blocks the operation writes.
+Undoing one shares the snapshot's blocks back into the mesh's existing property
+objects, so pointers to properties (e.g. ofxHEMeshDraw's) stay valid.
+
+Edits are grouped into steps by checkpoint(); undo() and redo() move one step
+at a time and rollback() returns to an earlier checkpoint.  Recording an edit
+after undoing drops the steps that could have been redone.
+
+Each step also keeps the operations that were called on the mesh, outermost
+only, with their arguments.  save() writes them out and replay() runs them on a
+mesh again, which starting from the same mesh reproduces the session exactly
+(element indices included) and exercises the real operations, e.g. as a
+performance regression workload.  Operations that load external data
+(loadOBJModel(), loadBinary(), assignment, swap()) can't be replayed.
+
+Properties added by the user are only journaled where elements are appended or
+recycled; writes made directly through an ofxHEMeshProperty aren't seen, and
+properties added or removed while journaling aren't tracked.  Geometry
+listeners are told about moved vertices one by one, and that all vertices were
+cleared and added again when an undo or redo changes which vertices exist.
+*/
+class ofxHEMeshJournal {
+public:
+	typedef ofxHEMesh::Point Point;
+	typedef ofxHEMesh::Scalar Scalar;
+
+	// Recorded operations.  Ops from ClearVertices on rewrite whole property
+	// arrays and are journaled with a snapshot.
+	enum Op {
+		None = 0,
+		AddVertex,
+		AddEdge,
+		AddEdges,
+		AddFace,
+		RemoveVertex,
+		RemoveVertices,
+		RemoveHalfedge,
+		EraseHalfedge,
+		RemoveFace,
+		RemoveFaceIfDegenerate,
+		ConnectFacesSimple,
+		ConnectHalfedgesCofacial,
+		SplitHalfedge,
+		SplitHalfedgeAt,
+		SplitHalfedgeQuadraticFit,
+		CollapseHalfedge,
+		CollapseHalfedgeAt,
+		CollapseHalfedgeQuadraticFit,
+		VertexMove,
+		VertexMoveTo,
+		BeginChanges,
+		CommitChanges,
+		SetVertexHalfedge,
+		SetFaceHalfedge,
+		SetHalfedgeVertex,
+		SetHalfedgeFace,
+		SetHalfedgeNext,
+		SetHalfedgePrev,
+		SwapHalfedgeAdjacency,
+
+		ClearVertices,
+		ClearHalfedges,
+		ClearFaces,
+		RemoveAllVertices,
+		AddVertices,
+		AddFaces,
+		AddFacesOfSize,
+		SetAllocationPolicy,
+		Compact,
+		RemeshLoop,
+		SubdivideLoop,
+		SubdivideCatmullClark,
+		SubdivideDooSabin,
+		SubdivideModifiedCornerCut,
+		FacePeel,
+		Dual,
+		Triangulate,
+		CentroidTriangulation,
+		ReverseFaces,
+		Translate,
+		// Replaces the mesh with data the journal doesn't have
+		External,
+
+		NumOps
+	};
+
+	static bool isBulk(int op) { return op >= ClearVertices; }
+
+	// An operation and its arguments.  Element arguments go in a and b, lists of
+	// elements and points in the step's ints and points.
+	struct Command {
+		Command(int op=None, int a=-1, int b=-1)
+		:	op(op), a(a), b(b), s(0),
+			intBegin(0), numInts(0), pointBegin(0), numPoints(0)
+		{
+			p[0] = p[1] = p[2] = 0;
+		}
+
+		Point point() const { return Point(p[0], p[1], p[2]); }
+
+		int32_t op;
+		int32_t a, b;
+		float s;
+		float p[3];
+		int32_t intBegin, numInts;
+		int32_t pointBegin, numPoints;
+	};
+
+	// Records the outermost operation running on a mesh for as long as it's in
+	// scope, and snapshots the mesh first for bulk operations.  Arguments are
+	// added after construction and dropped when the operation is nested.
+	class Scope {
+	public:
+		Scope(ofxHEMesh& mesh, Op op, int a=-1, int b=-1)
+		:	journal(mesh.getJournal()), command(-1), bulk(false)
+		{
+			if(journal) begin(op, a, b);
+		}
+		~Scope() {
+			if(journal) end();
+		}
+
+		void setScalar(Scalar s);
+		void setPoint(const Point& p);
+		void addInt(int v);
+		void addPoint(const Point& p);
+		void addPoints(const Point *p, size_t n);
+		// Whether the arguments are recorded, so bulk operations can skip
+		// gathering them when they aren't
+		bool hasCommand() const { return command >= 0; }
+
+	protected:
+		void begin(Op op, int a, int b);
+		void end();
+		Command * get();
+
+		ofxHEMeshJournal *journal;
+		int command;
+		bool bulk;
+	};
+
+	// Attaches to mesh, replacing any journal it had
+	ofxHEMeshJournal(ofxHEMesh& mesh);
+	~ofxHEMeshJournal();
+
+	ofxHEMesh& getMesh() { return mesh; }
+
+	// End the current step.  Returns the checkpoint's id, the number of steps
+	// that can be undone.
+	int checkpoint();
+	// Undo the current step or, when it's empty, the one before it
+	bool undo();
+	bool redo();
+	// Undo until checkpoint id is reached
+	bool rollback(int id);
+	int getNumUndoSteps() const;
+	int getNumRedoSteps() const;
+	// Forget all steps, keeping the mesh as it is
+	void clear();
+
+	// Bytes held by the deltas and commands, not counting snapshots
+	size_t memoryUsage() const;
+
+	// Write the operations of the steps that can be undone, in order
+	bool save(const string& fileName) const;
+	// Run the recorded operations on mesh.  With a journal attached to mesh, a
+	// checkpoint is made after each step.  Returns false if an operation can't
+	// be replayed.
+	bool replay(ofxHEMesh& mesh) const;
+	static bool replay(const string& fileName, ofxHEMesh& mesh);
+
+	/////////////////////////////////////////////////////////
+	// Recording, called by ofxHEMesh
+	bool isRecording() const { return applying == 0 && bulkDepth == 0; }
+	// Adjacency write, op is one of the Set* ops
+	void recordAdjacency(Op op, int idx, int from, int to);
+	void recordPoint(int v, const Point& from, const Point& to);
+	void recordSize(int kind, int from, int to);
+	// Before item idx of a property set is reset to the default values
+	void recordReset(int kind, int idx);
+	void recordFreePush(int kind, int idx);
+	void recordFreePop(int kind, int idx);
+	/////////////////////////////////////////////////////////
+
+protected:
+	// Kinds of Delta besides the adjacency ones, which use their Set* op
+	enum {
+		PointDelta = 128,
+		SizeDelta,
+		ResetDelta,
+		FreePushDelta,
+		FreePopDelta,
+		SnapshotDelta
+	};
+
+	enum { NumElementKinds = ofxHEMesh::FaceElements+1 };
+
+	// from and to are the values before and after the write.  Points keep their
+	// values in Step::values starting at from, reset items are row from of
+	// Step::resets[set].
+	struct Delta {
+		unsigned char kind;
+		unsigned char set;
+		int32_t idx;
+		int32_t from;
+		int32_t to;
+	};
+
+	// Items saved before they were reset, in properties created from the
+	// element set's (NULL where it has none) so they're copied by type
+	struct ResetItems {
+		ResetItems() : count(0) {}
+
+		vector<std::shared_ptr<ofxHEMeshPropertyBase> > properties;
+		int count;
+	};
+
+	struct Step {
+		bool empty() const { return deltas.empty() && commands.empty(); }
+
+		vector<Delta> deltas;
+		vector<char> values;
+		ResetItems resets[NumElementKinds];
+		vector<std::shared_ptr<ofxHEMesh> > snapshots;
+		vector<Command> commands;
+		vector<int> ints;
+		vector<Point> points;
+	};
+
+	// The step being recorded, dropping the steps that could be redone
+	Step& current();
+	void addDelta(int kind, int set, int idx, int from, int to);
+	void apply(Step& step, bool undo);
+	// The steps that can be undone, including the one being recorded
+	void recordedSteps(vector<const Step *>& done) const;
+	static bool replaySteps(const vector<Step>& session, ofxHEMesh& mesh);
+	static bool run(ofxHEMesh& mesh, const Step& step, const Command& cmd);
+
+	ofxHEMesh& mesh;
+	// Steps [0, position) are done, the rest can be redone.  steps[position]
+	// is the one being recorded when recording is true.
+	vector<Step> steps;
+	int position;
+	bool recording;
+	int commandDepth;
+	int bulkDepth;
+	int applying;
+};
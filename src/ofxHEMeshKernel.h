@@ -0,0 +1,130 @@
+#pragma once
+#include "ofxHEMeshPlatform.h"
+#include <cmath>
+
+/*
+Geometry kernels bundle the Scalar, Point and Direction types geometry is
+computed with.  Each kernel also converts to and from ofVec3f, which is how
+ofxHEMesh stores its points, so computations can run in another precision by
+converting points as they're read instead of copying the mesh.
+
+	ofxHEMeshFloatKernel	float, ofVec3f (the mesh's own kernel)
+	ofxHEMeshDoubleKernel	double, for precision sensitive solves
+	ofxHEMeshSIMDKernel		float padded to 4 lanes and 16 byte aligned so each
+							operation is a single vector instruction
+*/
+
+// Vector with the subset of ofVec3f's interface the mesh code uses.  N is the
+// number of stored lanes, the lanes past the third are padding and stay zero.
+template<typename T, int N>
+struct alignas(N == 4 ? sizeof(T)*4 : sizeof(T)) ofxHEMeshVec {
+	ofxHEMeshVec() {
+		for(int i=0; i < N; ++i) v[i] = 0;
+	}
+	ofxHEMeshVec(T x, T y, T z) {
+		v[0] = x; v[1] = y; v[2] = z;
+		for(int i=3; i < N; ++i) v[i] = 0;
+	}
+	explicit ofxHEMeshVec(const ofVec3f& p) {
+		v[0] = p.x; v[1] = p.y; v[2] = p.z;
+		for(int i=3; i < N; ++i) v[i] = 0;
+	}
+
+	ofVec3f toVec3f() const { return ofVec3f(v[0], v[1], v[2]); }
+
+	T& operator[](int i) { return v[i]; }
+	const T& operator[](int i) const { return v[i]; }
+	T* getPtr() { return v; }
+	const T* getPtr() const { return v; }
+
+	ofxHEMeshVec operator+(const ofxHEMeshVec& b) const { ofxHEMeshVec r(*this); return r += b; }
+	ofxHEMeshVec operator-(const ofxHEMeshVec& b) const { ofxHEMeshVec r(*this); return r -= b; }
+	ofxHEMeshVec operator*(T s) const { ofxHEMeshVec r(*this); return r *= s; }
+	ofxHEMeshVec operator/(T s) const { ofxHEMeshVec r(*this); return r /= s; }
+	ofxHEMeshVec operator-() const { ofxHEMeshVec r(*this); return r *= T(-1); }
+
+	ofxHEMeshVec& operator+=(const ofxHEMeshVec& b) {
+		for(int i=0; i < N; ++i) v[i] += b.v[i];
+		return *this;
+	}
+	ofxHEMeshVec& operator-=(const ofxHEMeshVec& b) {
+		for(int i=0; i < N; ++i) v[i] -= b.v[i];
+		return *this;
+	}
+	ofxHEMeshVec& operator*=(T s) {
+		for(int i=0; i < N; ++i) v[i] *= s;
+		return *this;
+	}
+	ofxHEMeshVec& operator/=(T s) {
+		return *this *= T(1)/s;
+	}
+	bool operator==(const ofxHEMeshVec& b) const {
+		return v[0] == b.v[0] && v[1] == b.v[1] && v[2] == b.v[2];
+	}
+	bool operator!=(const ofxHEMeshVec& b) const { return !(*this == b); }
+
+	// Padding lanes are zero so they don't contribute
+	T dot(const ofxHEMeshVec& b) const {
+		T r = 0;
+		for(int i=0; i < N; ++i) r += v[i]*b.v[i];
+		return r;
+	}
+	// Cross product in place, like ofVec3f::cross
+	ofxHEMeshVec& cross(const ofxHEMeshVec& b) {
+		*this = getCrossed(b);
+		return *this;
+	}
+	ofxHEMeshVec getCrossed(const ofxHEMeshVec& b) const {
+		return ofxHEMeshVec(
+			v[1]*b.v[2] - v[2]*b.v[1],
+			v[2]*b.v[0] - v[0]*b.v[2],
+			v[0]*b.v[1] - v[1]*b.v[0]
+		);
+	}
+	T lengthSquared() const { return dot(*this); }
+	T length() const { return std::sqrt(lengthSquared()); }
+	T distance(const ofxHEMeshVec& b) const { return (*this-b).length(); }
+	T distanceSquared(const ofxHEMeshVec& b) const { return (*this-b).lengthSquared(); }
+	ofxHEMeshVec& normalize() {
+		T l = length();
+		if(l > 0) *this /= l;
+		return *this;
+	}
+	ofxHEMeshVec getNormalized() const { ofxHEMeshVec r(*this); return r.normalize(); }
+
+	T v[N];
+};
+
+template<typename T, int N>
+inline ofxHEMeshVec<T, N> operator*(T s, const ofxHEMeshVec<T, N>& v) { return v*s; }
+
+typedef ofxHEMeshVec<double, 3> ofxHEMeshVec3d;
+typedef ofxHEMeshVec<float, 4> ofxHEMeshVec4f;
+
+
+struct ofxHEMeshFloatKernel {
+	typedef float Scalar;
+	typedef ofVec3f Point;
+	typedef ofVec3f Direction;
+
+	static Point toPoint(const ofVec3f& p) { return p; }
+	static ofVec3f toVec3f(const Point& p) { return p; }
+};
+
+struct ofxHEMeshDoubleKernel {
+	typedef double Scalar;
+	typedef ofxHEMeshVec3d Point;
+	typedef ofxHEMeshVec3d Direction;
+
+	static Point toPoint(const ofVec3f& p) { return Point(p); }
+	static ofVec3f toVec3f(const Point& p) { return p.toVec3f(); }
+};
+
+struct ofxHEMeshSIMDKernel {
+	typedef float Scalar;
+	typedef ofxHEMeshVec4f Point;
+	typedef ofxHEMeshVec4f Direction;
+
+	static Point toPoint(const ofVec3f& p) { return Point(p); }
+	static ofVec3f toVec3f(const Point& p) { return p.toVec3f(); }
+};
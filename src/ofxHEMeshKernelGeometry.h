@@ -0,0 +1,113 @@
+#pragma once
+#include "ofxHEMesh.h"
+#include "ofxHEMeshKernel.h"
+
+/*
+Geometric quantities of an ofxHEMesh computed with another kernel.  Points are
+converted from the mesh's float storage as they're read, so for example a
+solve can run in double without copying the mesh.  The functions match
+ofxHEMeshGeometry's: boundary faces are skipped and halfedgeCotan() is 0 on
+the boundary.
+*/
+template<typename Kernel>
+class ofxHEMeshKernelGeometry {
+public:
+	typedef typename Kernel::Scalar Scalar;
+	typedef typename Kernel::Point Point;
+	typedef typename Kernel::Direction Direction;
+
+	ofxHEMeshKernelGeometry(const ofxHEMesh& hemesh)
+	:	hemesh(hemesh)
+	{}
+
+	const ofxHEMesh& getMesh() const { return hemesh; }
+
+	Point vertexPoint(ofxHEMeshVertex v) const {
+		return Kernel::toPoint(hemesh.vertexPoint(v));
+	}
+
+	Direction halfedgeDirection(ofxHEMeshHalfedge h) const {
+		return vertexPoint(hemesh.halfedgeSink(h)) - vertexPoint(hemesh.halfedgeSource(h));
+	}
+
+	Scalar halfedgeLength(ofxHEMeshHalfedge h) const {
+		return halfedgeDirection(h).length();
+	}
+
+	Direction faceNormal(ofxHEMeshFace f) const {
+		Direction n = faceCross(f);
+		n.normalize();
+		return n;
+	}
+
+	Scalar faceArea(ofxHEMeshFace f) const {
+		return Scalar(0.5)*faceCross(f).length();
+	}
+
+	// Angle between h and the next halfedge in h's face, at h's sink
+	Scalar angleAtVertex(ofxHEMeshHalfedge h) const {
+		Direction v1 = -halfedgeDirection(h);
+		Direction v2 = halfedgeDirection(hemesh.halfedgeNext(h));
+		v1.normalize();
+		v2.normalize();
+		Scalar dot = std::max(std::min(Scalar(1), v1.dot(v2)), Scalar(-1));
+		return std::acos(dot);
+	}
+
+	// Cotangent of the angle opposite h in its face
+	Scalar halfedgeCotan(ofxHEMeshHalfedge h) const {
+		if(!hemesh.halfedgeFace(h).isValid()) return 0;
+		ofxHEMeshHalfedge h2 = hemesh.halfedgeNext(h);
+		ofxHEMeshHalfedge h3 = hemesh.halfedgeNext(h2);
+		Point p0 = vertexPoint(hemesh.halfedgeVertex(h2));
+		Direction u = vertexPoint(hemesh.halfedgeVertex(h3)) - p0;
+		Direction v = vertexPoint(hemesh.halfedgeVertex(h)) - p0;
+		Scalar d = u.dot(v);
+		return d/u.cross(v).length();
+	}
+
+	// h rotated a quarter turn in its face's plane, see ofxHEMesh::halfedgeRotated
+	Direction halfedgeRotated(ofxHEMeshHalfedge h) const {
+		Direction n = faceNormal(hemesh.halfedgeFace(h));
+		return n.cross(halfedgeDirection(h));
+	}
+
+	Direction angleWeightedVertexNormal(ofxHEMeshVertex v) const {
+		ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+		ofxHEMeshVertexCirculator vce = vc;
+		Direction n(0, 0, 0);
+		do {
+			ofxHEMeshFace f = hemesh.halfedgeFace(*vc);
+			if(f.isValid()) {
+				n += faceNormal(f)*angleAtVertex(*vc);
+			}
+			++vc;
+		} while(vc != vce);
+		n.normalize();
+		return n;
+	}
+
+	Scalar vertexArea(ofxHEMeshVertex v) const {
+		Scalar A = 0;
+		ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+		ofxHEMeshVertexCirculator vce = vc;
+		do {
+			ofxHEMeshFace f = hemesh.halfedgeFace(*vc);
+			if(f.isValid()) {
+				A += faceArea(f);
+			}
+			++vc;
+		} while(vc != vce);
+		return A/Scalar(3);
+	}
+
+protected:
+	// Unnormalized normal of the face's first corner
+	Direction faceCross(ofxHEMeshFace f) const {
+		ofxHEMeshHalfedge h = hemesh.faceHalfedge(f);
+		Direction n = halfedgeDirection(h);
+		return n.cross(halfedgeDirection(hemesh.halfedgeNext(h)));
+	}
+
+	const ofxHEMesh& hemesh;
+};
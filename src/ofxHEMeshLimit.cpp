@@ -0,0 +1,308 @@
+#include "ofxHEMeshLimit.h"
+#include <math.h>
+#include <stdexcept>
+
+ofxHEMeshLimit::ofxHEMeshLimit(ofxHEMesh& hemesh, Scheme scheme)
+:	hemesh(hemesh),
+	scheme(scheme),
+	points(hemesh.addVertexProperty<Point>("limit-points")),
+	normals(hemesh.addVertexProperty<Direction>("limit-normals"))
+{}
+
+void ofxHEMeshLimit::setScheme(Scheme v) {
+	if(scheme != v) acrossMasks.clear();
+	scheme = v;
+}
+
+void ofxHEMeshLimit::update() {
+	if(scheme == Loop) {
+		int nonTriangles = hemesh.parallelReduceFaces(0, [&](ofxHEMeshFace f) {
+			return hemesh.faceSize(f) != 3 ? 1 : 0;
+		}, [](int a, int b) { return a+b; });
+		if(nonTriangles > 0) throw std::invalid_argument("Loop limits require a triangle mesh");
+	}
+
+	// Masks for every boundary valence before the parallel pass reads them
+	int maxFaces = hemesh.parallelReduceVertices(0, [&](ofxHEMeshVertex v) {
+		int k;
+		boundaryStart(v, k);
+		return k;
+	}, [](int a, int b) { return std::max(a, b); });
+	for(int k=int(acrossMasks.size()); k <= maxFaces; ++k) {
+		acrossMasks.push_back(vector<Scalar>());
+		if(k > 0) acrossMask(k, acrossMasks.back());
+	}
+
+	points->unshare(0, points->size());
+	normals->unshare(0, normals->size());
+	// every slot rather than the live vertices, which leave out isolated ones
+	hemesh::parallelFor(0, hemesh.getNumVertices(), [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			ofxHEMeshVertex v(i);
+			Point& p = points->get(i);
+			Direction& n = normals->get(i);
+			if(!hemesh.vertexHalfedge(v).isValid()) {
+				p = hemesh.vertexPoint(v);
+				n = Direction(0, 0, 0);
+			}
+			else if(scheme == Loop) {
+				loopLimit(v, p, n);
+			}
+			else {
+				catmullClarkLimit(v, p, n);
+			}
+		}
+	});
+}
+
+/*
+Spokes are the incoming halfedges h[i] = halfedgeSinkCCW(h[i-1]) and p[i] their
+sources.  The face between spokes i and i+1 is halfedgeFace(halfedgeOpposite(h[i])),
+so a ring of points p[i] turns counter-clockwise about the face normals.  On the
+boundary h[0] follows the gap and the k faces end at spoke k.
+*/
+ofxHEMeshHalfedge ofxHEMeshLimit::boundaryStart(ofxHEMeshVertex v, int& k) const {
+	k = 0;
+	ofxHEMeshHalfedge h0 = hemesh.vertexHalfedge(v);
+	if(!h0.isValid()) return ofxHEMeshHalfedge();
+	ofxHEMeshHalfedge h = h0;
+	while(hemesh.halfedgeFace(h).isValid()) {
+		h = hemesh.halfedgeSinkCCW(h);
+		if(h == h0) return ofxHEMeshHalfedge();
+	}
+	h0 = h;
+	while(hemesh.halfedgeFace(hemesh.halfedgeOpposite(h)).isValid()) {
+		h = hemesh.halfedgeSinkCCW(h);
+		++k;
+	}
+	return h0;
+}
+
+/*
+Mask of the tangent across the boundary at a boundary vertex with k faces.  The
+scheme's rules map the ring around the vertex onto itself, Loop's ring being
+the vertex and p[0 .. k], Catmull-Clark's once refined ring the vertex, the
+edge vertices e[0 .. k] and the face vertices f[0 .. k-1].  Tangent masks are
+left eigenvectors of that matrix summing to zero.  The one along the boundary,
+p[0] - p[k], has eigenvalue 1/2, the one across it is the dominant eigenvector
+among the masks symmetric about the middle of the ring, found by power
+iteration.
+*/
+void ofxHEMeshLimit::acrossMask(int k, vector<Scalar>& mask) const {
+	// Rows of the subdivision matrix, column 0 being the vertex
+	int n = (scheme == Loop) ? k+2 : 2*k+2;
+	vector<double> S(n*n, 0.);
+	double *row = &S[0];
+	row[0] = 0.75;
+	row[1] += 0.125;
+	row[1+k] += 0.125;
+	for(int i=0; i <= k; ++i) {
+		row = &S[(1+i)*n];
+		if(i == 0 || i == k) {
+			row[0] = 0.5;
+			row[1+i] = 0.5;
+		}
+		else if(scheme == Loop) {
+			row[0] = 0.375;
+			row[1+i] = 0.375;
+			row[i] = 0.125;
+			row[2+i] = 0.125;
+		}
+		else {
+			// (v + e[i] + the face vertices either side)/4
+			row[0] = 0.375;
+			row[1+i] = 0.375;
+			row[i] = 0.0625;
+			row[2+i] = 0.0625;
+			row[k+1+i] = 0.0625;
+			row[k+2+i] = 0.0625;
+		}
+	}
+	if(scheme == CatmullClark) {
+		for(int i=0; i < k; ++i) {
+			row = &S[(k+2+i)*n];
+			row[0] = 0.25;
+			row[1+i] = 0.25;
+			row[2+i] = 0.25;
+			row[k+2+i] = 0.25;
+		}
+	}
+
+	// Start from the inside of the ring less the vertex, or from the boundary
+	// curve's second difference when the ring has no inside
+	vector<double> x(n, 0.);
+	vector<double> y(n);
+	for(int i=1; i < n; ++i) {
+		if(i != 1 && i != 1+k) {
+			x[i] = 1;
+			x[0] -= 1;
+		}
+	}
+	if(x[0] == 0) {
+		x[0] = -2;
+		x[1] = x[1+k] = 1;
+	}
+	for(int iter=0; iter < 10000; ++iter) {
+		for(int j=0; j < n; ++j) {
+			y[j] = 0;
+			for(int i=0; i < n; ++i) {
+				y[j] += x[i]*S[i*n+j];
+			}
+		}
+		// Rounding drifts towards the limit mask, 2/3 v + 1/6 (p[0] + p[k]),
+		// whose eigenvalue is 1, so take it back out
+		double sum = 0;
+		for(int j=0; j < n; ++j) sum += y[j];
+		y[0] -= sum*2/3;
+		y[1] -= sum/6;
+		y[1+k] -= sum/6;
+		double len = 0;
+		for(int j=0; j < n; ++j) len += y[j]*y[j];
+		len = sqrt(len);
+		double change = 0;
+		for(int j=0; j < n; ++j) {
+			y[j] /= len;
+			change += fabs(y[j] - x[j]);
+		}
+		x.swap(y);
+		if(change < 1e-13) break;
+	}
+	mask.assign(x.begin(), x.end());
+}
+
+ofxHEMeshLimit::Direction ofxHEMeshLimit::boundaryNormal(ofxHEMeshVertex v, const Direction& along, const Direction& across) const {
+	// The mask's sign is arbitrary, face the same way as the faces
+	Direction n = along.crossed(across);
+	Direction faces(0, 0, 0);
+	ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+	ofxHEMeshVertexCirculator vce = vc;
+	do {
+		ofxHEMeshFace f = hemesh.halfedgeFace(*vc);
+		if(f.isValid()) faces += hemesh.faceNormal(f);
+		++vc;
+	} while(vc != vce);
+	if(n.dot(faces) < 0) n = -n;
+	return n.getNormalized();
+}
+
+void ofxHEMeshLimit::loopLimit(ofxHEMeshVertex v, Point& p, Direction& n) const {
+	Point P = hemesh.vertexPoint(v);
+	int k;
+	ofxHEMeshHalfedge h = boundaryStart(v, k);
+
+	if(h.isValid()) {
+		const vector<Scalar>& mask = acrossMasks[k];
+		Direction across = P*mask[0];
+		Point p0, pk;
+		for(int i=0; i <= k; ++i) {
+			Point pi = hemesh.vertexPoint(hemesh.halfedgeSource(h));
+			across += pi*mask[1+i];
+			if(i == 0) p0 = pi;
+			if(i == k) pk = pi;
+			h = hemesh.halfedgeSinkCCW(h);
+		}
+		p = P*(2./3.) + (p0 + pk)*(1./6.);
+		n = boundaryNormal(v, p0 - pk, across);
+		return;
+	}
+
+	int valence = hemesh.vertexValence(v);
+	Scalar beta = (valence == 3) ? 3./16. : 3./(8.*valence);
+	Scalar chi = 1/(3/(8*beta) + valence);
+
+	// Ring sum and the tangents' cosine and sine weighted rings
+	Point sum(0, 0, 0);
+	Direction t1(0, 0, 0);
+	Direction t2(0, 0, 0);
+	h = hemesh.vertexHalfedge(v);
+	for(int i=0; i < valence; ++i) {
+		Point pi = hemesh.vertexPoint(hemesh.halfedgeSource(h));
+		Scalar a = 2*M_PI*i/valence;
+		sum += pi;
+		t1 += pi*cos(a);
+		t2 += pi*sin(a);
+		h = hemesh.halfedgeSinkCCW(h);
+	}
+	p = P*(1 - valence*chi) + sum*chi;
+	n = t1.crossed(t2).getNormalized();
+}
+
+/*
+After one Catmull-Clark step every face around v is a quad, v's ring being the
+new edge vertices e[i] alternating with the face vertices f[i] of the faces
+between spokes i and i+1.  These are computed here from the unrefined ring and
+Halstead et al.'s masks applied to them, with n the valence:
+
+	limit    (n^2 v + 4 sum e[i] + sum f[i]) / (n (n+5))
+	tangent  sum A cos(2 pi i/n) e[i] + (cos(2 pi i/n) + cos(2 pi (i+1)/n)) f[i]
+	A        1 + cos(2 pi/n) + cos(pi/n) sqrt(2 (9 + cos(2 pi/n)))
+
+and the other tangent with sines.
+*/
+void ofxHEMeshLimit::catmullClarkLimit(ofxHEMeshVertex v, Point& p, Direction& n) const {
+	Point P = hemesh.vertexPoint(v);
+	int k;
+	ofxHEMeshHalfedge h = boundaryStart(v, k);
+
+	if(h.isValid()) {
+		// Boundary edges are split at their midpoints and v moves along the
+		// boundary curve
+		const vector<Scalar>& mask = acrossMasks[k];
+		Direction across(0, 0, 0);
+		Point e0, ek, fprev;
+		for(int i=0; i <= k; ++i) {
+			Point pi = hemesh.vertexPoint(hemesh.halfedgeSource(h));
+			if(i == 0) e0 = (P + pi)*0.5;
+			if(i == k) ek = (P + pi)*0.5;
+			if(i < k) {
+				Point fi = hemesh.faceCentroid(hemesh.halfedgeFace(hemesh.halfedgeOpposite(h)));
+				if(i > 0) across += (P + pi + fprev + fi)*(0.25*mask[1+i]);
+				across += fi*mask[k+2+i];
+				fprev = fi;
+			}
+			h = hemesh.halfedgeSinkCCW(h);
+		}
+		Point V = P*0.5 + (e0 + ek)*0.25;
+		across += V*mask[0] + e0*mask[1] + ek*mask[1+k];
+		p = V*(2./3.) + (e0 + ek)*(1./6.);
+		n = boundaryNormal(v, e0 - ek, across);
+		return;
+	}
+
+	// First pass: the refined vertex, (Q + 2R + (n-3)P)/n
+	int valence = 0;
+	Point Q(0, 0, 0);
+	Point R(0, 0, 0);
+	h = hemesh.vertexHalfedge(v);
+	ofxHEMeshHalfedge hstart = h;
+	do {
+		Q += hemesh.faceCentroid(hemesh.halfedgeFace(h));
+		R += hemesh.vertexPoint(hemesh.halfedgeSource(h));
+		++valence;
+		h = hemesh.halfedgeSinkCCW(h);
+	} while(h != hstart);
+	Scalar nv = valence;
+	R = (R*(1/nv) + P)*0.5;
+	Point V = (Q*(1/nv) + R*2 + P*(nv-3))*(1/nv);
+
+	// Second pass: the refined ring
+	Scalar c = cos(2*M_PI/nv);
+	Scalar A = 1 + c + cos(M_PI/nv)*sqrt(2*(9 + c));
+	Point ring(0, 0, 0);
+	Direction t1(0, 0, 0);
+	Direction t2(0, 0, 0);
+	Point fprev = hemesh.faceCentroid(hemesh.halfedgeFace(h));
+	for(int i=0; i < valence; ++i) {
+		Point fi = hemesh.faceCentroid(hemesh.halfedgeFace(hemesh.halfedgeOpposite(h)));
+		Point ei = (P + hemesh.vertexPoint(hemesh.halfedgeSource(h)) + fprev + fi)*0.25;
+		Scalar a0 = 2*M_PI*i/nv;
+		Scalar a1 = 2*M_PI*(i+1)/nv;
+		ring += ei*4 + fi;
+		t1 += ei*(A*cos(a0)) + fi*(cos(a0) + cos(a1));
+		t2 += ei*(A*sin(a0)) + fi*(sin(a0) + sin(a1));
+		fprev = fi;
+		h = hemesh.halfedgeSinkCCW(h);
+	}
+	p = (V*(nv*nv) + ring)*(1/(nv*(nv+5)));
+	n = t1.crossed(t2).getNormalized();
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "ofxHEMesh.h"
+
+/*
+Limit surface positions and normals at the vertices of a mesh, without
+refining it.  update() makes one parallel pass over the vertices applying the
+scheme's limit masks to each one-ring and caches the results in the vertex
+properties "limit-points" and "limit-normals", which ofxHEMeshDraw can draw in
+place of the mesh's points and vertex normals.
+
+Normals are the cross product of the two limit tangents:
+
+	Loop           Loop's limit masks over the one-ring
+	Catmull-Clark  the quad masks of Halstead et al. over the one-ring after
+	               one subdivision step, worked out from the unrefined ring so
+	               any polygons are handled
+
+Boundary vertices lie on the boundary curve, the cubic B-spline through the
+boundary vertices, and their normals come from masks worked out once per
+number of faces around the vertex.  Sharpness isn't taken into account, the
+limits are those of the smooth scheme.
+
+Like ofxHEMeshGeometry the caches aren't tracked against edits, call update()
+after the mesh changes.
+*/
+class ofxHEMeshLimit {
+public:
+	typedef ofxHEMesh::Scalar Scalar;
+	typedef ofxHEMesh::Point Point;
+	typedef ofxHEMesh::Direction Direction;
+
+	enum Scheme {
+		Loop,
+		CatmullClark
+	};
+
+	ofxHEMeshLimit(ofxHEMesh& hemesh, Scheme scheme=CatmullClark);
+
+	Scheme getScheme() const { return scheme; }
+	void setScheme(Scheme v);
+
+	// Fill the caches for every vertex.  Throws std::invalid_argument if
+	// the scheme is Loop and a face isn't a triangle.
+	void update();
+
+	const ofxHEMeshProperty<Point>& getPoints() const { return *points; }
+	const ofxHEMeshProperty<Direction>& getNormals() const { return *normals; }
+	// Isolated vertices stay where they are with a zero normal
+	Point limitPoint(ofxHEMeshVertex v) const { return points->get(v.idx); }
+	Direction limitNormal(ofxHEMeshVertex v) const { return normals->get(v.idx); }
+
+protected:
+	void loopLimit(ofxHEMeshVertex v, Point& p, Direction& n) const;
+	void catmullClarkLimit(ofxHEMeshVertex v, Point& p, Direction& n) const;
+	// The incoming halfedge after a gap in v's one-ring and the number of faces
+	// up to the next gap, or an invalid halfedge when v is interior
+	ofxHEMeshHalfedge boundaryStart(ofxHEMeshVertex v, int& k) const;
+	void acrossMask(int k, vector<Scalar>& mask) const;
+	Direction boundaryNormal(ofxHEMeshVertex v, const Direction& along, const Direction& across) const;
+
+	ofxHEMesh& hemesh;
+	Scheme scheme;
+	// Indexed by the number of faces around a boundary vertex
+	vector<vector<Scalar> > acrossMasks;
+	ofxHEMeshProperty<Point> *points;
+	ofxHEMeshProperty<Direction> *normals;
+};
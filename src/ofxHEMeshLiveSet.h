@@ -0,0 +1,170 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using std::vector;
+
+/*
+Bitset recording which element slots of a mesh are live.  Bits past the end of
+the stored words are dead, so the set doesn't need to be resized when elements
+are appended; only setting a bit grows it.  next() and prev() skip 64 dead
+slots at a time, which keeps iteration over fragmented meshes cheap.
+
+rank() numbers the live elements densely (e.g. for matrix rows).  The prefix
+counts it uses are rebuilt lazily after the set changes, so concurrent rank()
+calls are only safe after updateRanks().
+*/
+class ofxHEMeshLiveSet {
+public:
+	ofxHEMeshLiveSet()
+	:	numLive(0), ranksDirty(true)
+	{}
+
+	void clear() {
+		words.clear();
+		numLive = 0;
+		ranksDirty = true;
+	}
+
+	// Number of live slots
+	int count() const { return numLive; }
+
+	bool test(int idx) const {
+		int w = idx >> 6;
+		return w < int(words.size()) && ((words[w] >> (idx & 63)) & 1);
+	}
+
+	void set(int idx, bool live) {
+		int w = idx >> 6;
+		uint64_t bit = uint64_t(1) << (idx & 63);
+		if(live) {
+			if(w >= int(words.size())) {
+				words.resize(w+1, 0);
+			}
+			if(!(words[w] & bit)) {
+				words[w] |= bit;
+				++numLive;
+				ranksDirty = true;
+			}
+		}
+		else if(w < int(words.size()) && (words[w] & bit)) {
+			words[w] &= ~bit;
+			--numLive;
+			ranksDirty = true;
+		}
+	}
+
+	// First live slot in [idx, end), or end if there is none
+	int next(int idx, int end) const {
+		if(idx < 0) idx = 0;
+		int nwords = int(words.size());
+		int w = idx >> 6;
+		if(w >= nwords) return end;
+
+		uint64_t bits = words[w] & (~uint64_t(0) << (idx & 63));
+		while(!bits) {
+			if(++w >= nwords) return end;
+			bits = words[w];
+		}
+		int found = (w << 6) + countTrailingZeros(bits);
+		return found < end ? found : end;
+	}
+
+	// Last live slot at or before idx, or -1 if there is none
+	int prev(int idx) const {
+		if(idx < 0) return -1;
+		int w = idx >> 6;
+		uint64_t bits;
+		if(w >= int(words.size())) {
+			w = int(words.size())-1;
+			if(w < 0) return -1;
+			bits = words[w];
+		}
+		else {
+			bits = words[w] & (~uint64_t(0) >> (63 - (idx & 63)));
+		}
+		while(!bits) {
+			if(--w < 0) return -1;
+			bits = words[w];
+		}
+		return (w << 6) + 63 - countLeadingZeros(bits);
+	}
+
+	// Number of live slots before idx
+	int rank(int idx) const {
+		if(idx <= 0) return 0;
+		updateRanks();
+		int w = idx >> 6;
+		if(w >= int(words.size())) return numLive;
+		uint64_t below = words[w] & ((uint64_t(1) << (idx & 63)) - 1);
+		return ranks[w] + popCount(below);
+	}
+
+	// Rebuild the prefix counts if needed, after which rank() only reads
+	void updateRanks() const {
+		if(!ranksDirty) return;
+		ranks.resize(words.size()+1);
+		ranks[0] = 0;
+		for(int i=0; i < words.size(); ++i) {
+			ranks[i+1] = ranks[i] + popCount(words[i]);
+		}
+		ranksDirty = false;
+	}
+
+	// Recompute slots [begin, end) from a predicate and drop everything past end
+	template<typename Pred>
+	void rebuild(int begin, int end, Pred live) {
+		int nwords = (end+63) >> 6;
+		words.resize(nwords, 0);
+		for(int i=begin; i < end; ++i) {
+			uint64_t bit = uint64_t(1) << (i & 63);
+			if(live(i)) words[i >> 6] |= bit;
+			else words[i >> 6] &= ~bit;
+		}
+		if(end & 63) {
+			words[nwords-1] &= (uint64_t(1) << (end & 63)) - 1;
+		}
+		numLive = 0;
+		for(int i=0; i < nwords; ++i) {
+			numLive += popCount(words[i]);
+		}
+		ranksDirty = true;
+	}
+
+protected:
+	static int countTrailingZeros(uint64_t x) {
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanForward64(&idx, x);
+		return int(idx);
+#else
+		return __builtin_ctzll(x);
+#endif
+	}
+
+	static int countLeadingZeros(uint64_t x) {
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanReverse64(&idx, x);
+		return 63 - int(idx);
+#else
+		return __builtin_clzll(x);
+#endif
+	}
+
+	static int popCount(uint64_t x) {
+#ifdef _MSC_VER
+		return int(__popcnt64(x));
+#else
+		return __builtin_popcountll(x);
+#endif
+	}
+
+	vector<uint64_t> words;
+	mutable vector<int> ranks;
+	int numLive;
+	mutable bool ranksDirty;
+};
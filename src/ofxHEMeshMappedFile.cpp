@@ -0,0 +1,83 @@
+#include "ofxHEMeshMappedFile.h"
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+ofxHEMeshMappedFile::ofxHEMeshMappedFile()
+:	fileData(NULL), fileSize(0), opened(false), mapped(false)
+{}
+
+ofxHEMeshMappedFile::~ofxHEMeshMappedFile() {
+	close();
+}
+
+bool ofxHEMeshMappedFile::open(const string& path) {
+	close();
+
+#ifndef _WIN32
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd >= 0) {
+		struct stat st;
+		if(fstat(fd, &st) == 0) {
+			fileSize = size_t(st.st_size);
+			if(fileSize == 0) {
+				opened = true;
+			}
+			else {
+				void *addr = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(addr != MAP_FAILED) {
+					madvise(addr, fileSize, MADV_SEQUENTIAL);
+					fileData = (const char *)addr;
+					opened = true;
+					mapped = true;
+				}
+			}
+		}
+		::close(fd);
+		if(opened) {
+			return true;
+		}
+		fileSize = 0;
+	}
+#endif
+
+	// Fall back to reading the whole file
+	std::ifstream stream(path.c_str(), std::ios::in | std::ios::binary);
+	if(!stream.is_open()) {
+		return false;
+	}
+	stream.seekg(0, std::ios::end);
+	std::streamoff length = stream.tellg();
+	stream.seekg(0, std::ios::beg);
+	if(length < 0) {
+		return false;
+	}
+
+	buffer.resize(size_t(length));
+	if(length > 0) {
+		stream.read(&buffer[0], length);
+		fileData = &buffer[0];
+	}
+	fileSize = size_t(length);
+	opened = true;
+	return true;
+}
+
+void ofxHEMeshMappedFile::close() {
+#ifndef _WIN32
+	if(mapped) {
+		munmap((void *)fileData, fileSize);
+	}
+#endif
+	vector<char>().swap(buffer);
+	fileData = NULL;
+	fileSize = 0;
+	opened = false;
+	mapped = false;
+}
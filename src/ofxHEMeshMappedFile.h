@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+using std::string;
+using std::vector;
+
+/*
+Read-only view of a whole file.  On POSIX systems the file is memory-mapped
+so that large files can be scanned without first being copied into a
+buffer.  Elsewhere the contents are read into memory in one go.
+*/
+class ofxHEMeshMappedFile{
+public:
+	ofxHEMeshMappedFile();
+	~ofxHEMeshMappedFile();
+
+	bool open(const string& path);
+	void close();
+
+	bool isOpen() const { return opened; }
+	const char * data() const { return fileData; }
+	size_t size() const { return fileSize; }
+
+protected:
+	// non-copyable
+	ofxHEMeshMappedFile(const ofxHEMeshMappedFile& src);
+	ofxHEMeshMappedFile& operator=(const ofxHEMeshMappedFile& src);
+
+	const char *fileData;
+	size_t fileSize;
+	bool opened;
+	bool mapped;
+	vector<char> buffer;
+};
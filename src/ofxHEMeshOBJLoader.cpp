@@ -1,129 +1,450 @@
 #include "ofxHEMeshOBJLoader.h"
-#include <iostream>
-#include <fstream>
-
-using std::ifstream;
+#include "ofxHEMeshMappedFile.h"
+#include "ofxHEMeshParallel.h"
+#include <cmath>
+#include <stdint.h>
 
 
 class ofxHEMeshOBJMesh{
 public:
-	vector<ofxHEMesh::Point> vertices;
-	vector<ofxHEMesh::ExplicitFace> faces;
+	ofxHEMeshOBJMesh()
+	:	faceBegin(0), faceEnd(0), vertexBegin(0), vertexEnd(0)
+	{}
+
+	string name;
+	// Range of faces in the loader's face list
+	int faceBegin;
+	int faceEnd;
+	// Range of vertices used by the faces
+	int vertexBegin;
+	int vertexEnd;
+};
+
+
+// A line-aligned piece of the file.  The first pass counts the elements in
+// each chunk, the second parses them into the loader's arrays starting at
+// the chunk's base offsets.
+class ofxHEMeshOBJChunk{
+public:
+	ofxHEMeshOBJChunk()
+	:	begin(NULL), end(NULL),
+		numVertices(0), numFaces(0), numCorners(0),
+		vertexBase(0), faceBase(0), cornerBase(0)
+	{}
+
+	const char *begin;
+	const char *end;
+	int numVertices;
+	int numFaces;
+	int numCorners;
+	// Group names and the chunk-local face they start at
+	vector<std::pair<int, string> > groups;
+	int vertexBase;
+	int faceBase;
+	int cornerBase;
 };
 
+// Files smaller than this aren't worth splitting
+static const size_t MinChunkSize = 1<<20;
+
+static const double PowersOf10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isSpace(char c) {
+	return c == ' ' || c == '\t';
+}
+
+static inline bool isLineEnd(char c) {
+	return c == '\n' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static inline const char * skipSpace(const char *p, const char *end) {
+	while(p < end && isSpace(*p)) ++p;
+	return p;
+}
+
+static inline const char * nextLine(const char *p, const char *end) {
+	while(p < end && *p != '\n') ++p;
+	return p < end ? p+1 : end;
+}
+
+static bool parseFloat(const char *&p, const char *end, double& value) {
+	p = skipSpace(p, end);
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		++p;
+	}
+
+	// Accumulate up to 19 significant digits in an integer and track the
+	// decimal exponent separately
+	uint64_t mantissa = 0;
+	int ndigits = 0;
+	int exponent = 0;
+	bool valid = false;
+	for(; p < end && isDigit(*p); ++p) {
+		valid = true;
+		if(ndigits < 19) {
+			mantissa = mantissa*10 + (*p-'0');
+			if(mantissa) ++ndigits;
+		}
+		else {
+			++exponent;
+		}
+	}
+	if(p < end && *p == '.') {
+		++p;
+		for(; p < end && isDigit(*p); ++p) {
+			valid = true;
+			if(ndigits < 19) {
+				mantissa = mantissa*10 + (*p-'0');
+				if(mantissa) ++ndigits;
+				--exponent;
+			}
+		}
+	}
+	if(!valid) {
+		return false;
+	}
+
+	if(p < end && (*p == 'e' || *p == 'E')) {
+		const char *q = p+1;
+		bool negativeExponent = false;
+		if(q < end && (*q == '-' || *q == '+')) {
+			negativeExponent = *q == '-';
+			++q;
+		}
+		if(q < end && isDigit(*q)) {
+			int e = 0;
+			for(; q < end && isDigit(*q); ++q) {
+				if(e < 10000) e = e*10 + (*q-'0');
+			}
+			exponent += negativeExponent ? -e : e;
+			p = q;
+		}
+	}
+
+	value = double(mantissa);
+	if(exponent < 0) {
+		value = -exponent <= 22 ? value/PowersOf10[-exponent] : value/pow(10., -exponent);
+	}
+	else if(exponent > 0) {
+		value = exponent <= 22 ? value*PowersOf10[exponent] : value*pow(10., exponent);
+	}
+	if(negative) value = -value;
+	return true;
+}
+
+// Parses the position index of a face corner (v, v/t, v/t/n or v//n)
+static bool parseIndex(const char *&p, const char *end, int& value) {
+	p = skipSpace(p, end);
+	bool negative = false;
+	if(p < end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		++p;
+	}
+	if(p >= end || !isDigit(*p)) {
+		return false;
+	}
+
+	int v = 0;
+	for(; p < end && isDigit(*p); ++p) {
+		v = v*10 + (*p-'0');
+	}
+	// skip texcoord and normal indices
+	while(p < end && !isSpace(*p) && !isLineEnd(*p)) ++p;
+	value = negative ? -v : v;
+	return true;
+}
+
+// When store is false, only count the chunk's elements and record its groups
+static void parseChunk(ofxHEMeshOBJChunk& chunk, bool store, ofxHEMesh::Point *points, int *offsets, ofxHEMeshVertex *corners) {
+	int nv = 0;
+	int nf = 0;
+	int nc = 0;
+
+	const char *end = chunk.end;
+	const char *p = chunk.begin;
+	while(p < end) {
+		p = skipSpace(p, end);
+		char c = p < end ? p[0] : '\n';
+		char c1 = p+1 < end ? p[1] : '\n';
+
+		// v, vt, vn
+		if(c == 'v' && isSpace(c1)) {
+			if(store) {
+				const char *q = p+1;
+				double xyz[] = {0, 0, 0};
+				for(int i=0; i < 3 && parseFloat(q, end, xyz[i]); ++i) {}
+				points[nv] = ofxHEMesh::Point(xyz[0], xyz[1], xyz[2]);
+			}
+			++nv;
+		}
+		else if(c == 'f' && isSpace(c1)) {
+			const char *q = p+1;
+			int n = 0;
+			int value;
+			while(parseIndex(q, end, value)) {
+				if(store) {
+					// indices are 1-based, negative indices count back from the last vertex read
+					int idx = value < 0 ? chunk.vertexBase+nv+value : value-1;
+					corners[nc+n] = ofxHEMeshVertex(idx);
+				}
+				++n;
+			}
+			if(n > 0) {
+				nc += n;
+				++nf;
+				if(store) {
+					offsets[nf] = chunk.cornerBase+nc;
+				}
+			}
+		}
+		else if((c == 'o' || c == 'g') && (isSpace(c1) || isLineEnd(c1))) {
+			if(!store) {
+				const char *b = skipSpace(p+1, end);
+				const char *e = b;
+				while(e < end && !isLineEnd(*e)) ++e;
+				while(e > b && isSpace(e[-1])) --e;
+				chunk.groups.push_back(std::pair<int, string>(nf, string(b, e)));
+			}
+		}
+		p = nextLine(p, end);
+	}
+
+	if(!store) {
+		chunk.numVertices = nv;
+		chunk.numFaces = nf;
+		chunk.numCorners = nc;
+	}
+}
+
 
 ofxHEMeshOBJLoader::ofxHEMeshOBJLoader()
 {}
 
 ofxHEMeshOBJLoader::~ofxHEMeshOBJLoader() {
+	clear();
+}
+
+void ofxHEMeshOBJLoader::clear() {
 	for(int i=0; i < objMeshes.size(); ++i) {
 		delete objMeshes[i];
 	}
+	objMeshes.clear();
+	vertices.clear();
+	faceOffsets.clear();
+	faceVertices.clear();
 }
 
 bool ofxHEMeshOBJLoader::loadModel(string modelName) {
+	return parse(modelName, NULL);
+}
+
+bool ofxHEMeshOBJLoader::loadModel(string modelName, ofxHEMesh& hemesh) {
+	return parse(modelName, &hemesh);
+}
+
+bool ofxHEMeshOBJLoader::parse(const string& modelName, ofxHEMesh *hemesh) {
+	clear();
+
 	ofFile file;
 	file.open(modelName, ofFile::ReadOnly, true); // Since it may be a binary file we should read it in binary -Ed
     if(!file.exists()) {
         ofLogVerbose("ofxAssimpModelLoader") << "loadModel(): model does not exist: \"" << modelName << "\"";
         return false;
     }
-	
-	ifstream fileStream(file.getAbsolutePath().c_str());
-	if(fileStream.is_open()) {
-		string line;
-		ofxHEMeshOBJMesh *mesh = new ofxHEMeshOBJMesh();
-		objMeshes.push_back(mesh);
-		
-		while(std::getline(file, line)) {
-			switch(line[0]) {
-				// v, vt, vn
-				case 'v':
-					switch(line[1]) {
-						case 't':
-						case 'n':
-							// ignore texcoord and normals for now
-							break;
-							
-						case ' ': {
-							float x, y, z;
-							sscanf(line.c_str(), "v %f %f %f", &x, &y, &z);
-							mesh->vertices.push_back(ofxHEMesh::Point(x, y, z));
-						}
-						break;
-					}
-					break;
-					
-					
-				case 'f':
-					parseFace(line, mesh);
-					break;
+
+	ofxHEMeshMappedFile mappedFile;
+	if(!mappedFile.open(file.getAbsolutePath())) {
+		ofLogError("ofxHEMeshOBJLoader") << "loadModel(): couldn't read model: \"" << modelName << "\"";
+		return false;
+	}
+
+	// Split the file into chunks that each end just after a newline
+	const char *data = mappedFile.data();
+	const char *dataEnd = data+mappedFile.size();
+	size_t size = mappedFile.size();
+	int nchunks = int(std::min(size_t(hemesh::getNumThreads())*4, size/MinChunkSize+1));
+	vector<ofxHEMeshOBJChunk> chunks(nchunks);
+	const char *prev = data;
+	for(int i=0; i < nchunks; ++i) {
+		const char *e = dataEnd;
+		if(i < nchunks-1) {
+			e = std::max(prev, data + size_t(double(size)*(i+1)/nchunks));
+			while(e < dataEnd && e > data && e[-1] != '\n') ++e;
+		}
+		chunks[i].begin = prev;
+		chunks[i].end = e;
+		prev = e;
+	}
+
+	// Count the elements in each chunk
+	hemesh::parallelFor(0, nchunks, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			parseChunk(chunks[i], false, NULL, NULL, NULL);
+		}
+	}, 1);
+
+	int nverts = 0;
+	int nfaces = 0;
+	int ncorners = 0;
+	for(int i=0; i < nchunks; ++i) {
+		chunks[i].vertexBase = nverts;
+		chunks[i].faceBase = nfaces;
+		chunks[i].cornerBase = ncorners;
+		nverts += chunks[i].numVertices;
+		nfaces += chunks[i].numFaces;
+		ncorners += chunks[i].numCorners;
+	}
+
+	// Parse each chunk in place, positions go straight into the mesh's points
+	ofxHEMesh::Point *points = NULL;
+	int vstart = 0;
+	if(hemesh) {
+		vstart = hemesh->vertexProperties.size();
+		hemesh->vertexProperties.extend(nverts);
+		if(nverts > 0) points = hemesh->points->ptr() + vstart;
+	}
+	else {
+		vertices.resize(nverts);
+		points = vertices.data();
+	}
+	faceOffsets.resize(nfaces+1);
+	faceOffsets[0] = 0;
+	faceVertices.resize(ncorners);
+	hemesh::parallelFor(0, nchunks, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			ofxHEMeshOBJChunk& chunk = chunks[i];
+			parseChunk(
+				chunk, true,
+				points ? points+chunk.vertexBase : NULL,
+				faceOffsets.data()+chunk.faceBase,
+				faceVertices.data()+chunk.cornerBase
+			);
+		}
+	}, 1);
+
+	// Faces before the first group belong to an unnamed one
+	vector<ofxHEMeshOBJMesh *> groups;
+	groups.push_back(new ofxHEMeshOBJMesh());
+	for(int i=0; i < nchunks; ++i) {
+		for(int j=0; j < chunks[i].groups.size(); ++j) {
+			int face = chunks[i].faceBase + chunks[i].groups[j].first;
+			groups.back()->faceEnd = face;
+			groups.push_back(new ofxHEMeshOBJMesh());
+			groups.back()->name = chunks[i].groups[j].second;
+			groups.back()->faceBegin = face;
+		}
+	}
+	groups.back()->faceEnd = nfaces;
+
+	// Only keep groups that have faces
+	for(int i=0; i < groups.size(); ++i) {
+		if(groups[i]->faceEnd > groups[i]->faceBegin) {
+			objMeshes.push_back(groups[i]);
+		}
+		else {
+			delete groups[i];
+		}
+	}
+
+	// A file without faces is a single point set
+	if(objMeshes.empty() && nverts > 0) {
+		objMeshes.push_back(new ofxHEMeshOBJMesh());
+	}
+
+	// Find the range of vertices each mesh uses
+	vector<char> invalid(objMeshes.size(), 0);
+	hemesh::parallelFor(0, objMeshes.size(), [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			ofxHEMeshOBJMesh *mesh = objMeshes[i];
+			int vmin = nverts;
+			int vmax = -1;
+			for(int j=faceOffsets[mesh->faceBegin]; j < faceOffsets[mesh->faceEnd]; ++j) {
+				vmin = std::min(vmin, faceVertices[j].idx);
+				vmax = std::max(vmax, faceVertices[j].idx);
+			}
+			if(vmin < 0 || vmax >= nverts) {
+				invalid[i] = 1;
 			}
+			mesh->vertexBegin = std::min(vmin, vmax+1);
+			mesh->vertexEnd = vmax+1;
+		}
+	}, 1);
+
+	for(int i=0; i < invalid.size(); ++i) {
+		if(invalid[i]) {
+			ofLogError("ofxHEMeshOBJLoader") << "loadModel(): face index out of range in \"" << modelName << "\"";
+			if(hemesh) hemesh->vertexProperties.resize(vstart);
+			clear();
+			return false;
 		}
 	}
-	fileStream.close();
+
+	// With a single mesh keep all of the vertices, even unused ones
+	if(objMeshes.size() == 1) {
+		objMeshes[0]->vertexBegin = 0;
+		objMeshes[0]->vertexEnd = nverts;
+	}
+
+	if(hemesh) {
+		hemesh->verticesAppended(vstart, nverts);
+		addFaces(*hemesh, 0, nfaces, vstart);
+	}
 	return true;
 }
 
+string ofxHEMeshOBJLoader::getMeshName(int idx) const {
+	if(idx >= 0 && idx < objMeshes.size()) {
+		return objMeshes[idx]->name;
+	}
+	return "";
+}
+
 void ofxHEMeshOBJLoader::addToHemesh(ofxHEMesh& hemesh, int idx) {
 	if(idx >= 0 && idx < objMeshes.size()) {
 		ofxHEMeshOBJMesh *mesh = objMeshes[idx];
-		ofxHEMeshVertex vstart(hemesh.getNumVertices());
-		
-		for(int i=0; i < mesh->vertices.size(); ++i) {
-			hemesh.addVertex(mesh->vertices[i]);
-		}
-		
-		vector<ofxHEMesh::ExplicitFace> faces;
-		faces.reserve(mesh->faces.size());
-		for(int i=0; i < mesh->faces.size(); ++i) {
-			faces.push_back(mesh->faces[i]);
+		int nverts = mesh->vertexEnd - mesh->vertexBegin;
+		if(vertices.empty() && nverts > 0) {
+			// the positions were parsed into a mesh by loadModel(modelName, hemesh)
+			return;
 		}
-		hemesh.addFaces(faces);
+		int vstart = hemesh.addVertices(vertices.data()+mesh->vertexBegin, nverts).idx;
+		addFaces(hemesh, mesh->faceBegin, mesh->faceEnd, vstart - mesh->vertexBegin);
 	}
 }
 
+void ofxHEMeshOBJLoader::addFaces(ofxHEMesh& hemesh, int faceBegin, int faceEnd, int vertexShift) {
+	int nfaces = faceEnd - faceBegin;
+	if(nfaces == 0) {
+		return;
+	}
 
-void ofxHEMeshOBJLoader::parseFace(const string& line, ofxHEMeshOBJMesh *mesh) {
-	ofxHEMesh::ExplicitFace face;
-
-	int v, t, n, read, res;
-	int pos = 0;
-	
-	if(line.find("//") != string::npos) {
-		res = sscanf(line.c_str(), "f %d//%d%n", &v, &n, &read);
-		while(res == 2) {
-			face.push_back(ofxHEMeshVertex(v-1));
-			pos += read;
-			res = sscanf(line.c_str()+pos, " %d//%d%n", &v, &n, &read);
-		}
+	if(vertexShift == 0 && nfaces+1 == faceOffsets.size()) {
+		hemesh.addFaces(faceOffsets, faceVertices);
 	}
-	else if(line.find('/') != string::npos) {
-		if(sscanf(line.c_str(), "f %d/%d/%d", &v, &t, &n) == 3) {
-			res = sscanf(line.c_str(), "f %d/%d/%d%n", &v, &t, &n, &read);
-			while(res == 3) {
-				face.push_back(ofxHEMeshVertex(v-1));
-				pos += read;
-				res = sscanf(line.c_str()+pos, " %d/%d/%d%n", &v, &t, &n, &read);
+	else {
+		int cornerBegin = faceOffsets[faceBegin];
+		int ncorners = faceOffsets[faceEnd] - cornerBegin;
+		vector<int> offsets(nfaces+1);
+		vector<ofxHEMeshVertex> corners(ncorners);
+		hemesh::parallelFor(0, nfaces+1, [&](int b, int e) {
+			for(int i=b; i < e; ++i) {
+				offsets[i] = faceOffsets[faceBegin+i] - cornerBegin;
 			}
-		}
-		else {
-			res = sscanf(line.c_str(), "f %d/%d%n", &v, &n, &read);
-			while(res == 2) {
-				face.push_back(ofxHEMeshVertex(v-1));
-				pos += read;
-				res = sscanf(line.c_str()+pos, " %d/%d%n", &v, &n, &read);
+		});
+		hemesh::parallelFor(0, ncorners, [&](int b, int e) {
+			for(int i=b; i < e; ++i) {
+				corners[i] = ofxHEMeshVertex(faceVertices[cornerBegin+i].idx + vertexShift);
 			}
-		}
+		});
+		hemesh.addFaces(offsets, corners);
 	}
-	else {
-		res = sscanf(line.c_str(), "f %d%n", &v, &read);
-		while(res == 1) {
-			face.push_back(ofxHEMeshVertex(v-1));
-			pos += read;
-			res = sscanf(line.c_str()+pos, " %d%n", &v, &read);
-		}
-	}
-
-	mesh->faces.push_back(face);
-}
\ No newline at end of file
+}
@@ -1,21 +1,42 @@
 #pragma once
-#include "ofMain.h"
+#include "ofxHEMeshPlatform.h"
 #include "ofxHEMesh.h"
 
 class ofxHEMeshOBJMesh;
 
-
+/*
+Loads the vertex positions and faces of an OBJ file.  The file is memory-mapped
+and split into line-aligned chunks that are parsed concurrently.  Each 'o' or 'g'
+group holding faces becomes a separate mesh, which addToHemesh() adds on its
+own.  loadModel(modelName, hemesh) instead appends the whole file to one mesh,
+parsing the positions straight into its points.  Texture coordinates and normals
+are ignored.
+*/
 class ofxHEMeshOBJLoader{
 public:
 	ofxHEMeshOBJLoader();
 	~ofxHEMeshOBJLoader();
-	
+
 	bool loadModel(string modelName);
+	// Append every vertex and face of the file to hemesh
+	bool loadModel(string modelName, ofxHEMesh& hemesh);
 	void addToHemesh(ofxHEMesh& hemesh, int idx);
 	int getNumMeshes() const { return objMeshes.size(); }
-	
+	string getMeshName(int idx) const;
+
 protected:
-	void parseFace(const string& line, ofxHEMeshOBJMesh *mesh);
+	void clear();
+	// Parse the file, into hemesh's points when it's given and vertices otherwise
+	bool parse(const string& modelName, ofxHEMesh *hemesh);
+	// Add faces [faceBegin, faceEnd) with their vertex indices shifted
+	void addFaces(ofxHEMesh& hemesh, int faceBegin, int faceEnd, int vertexShift);
 
 	vector<ofxHEMeshOBJMesh *> objMeshes;
-};
\ No newline at end of file
+
+	// All positions and faces in the file.  Face indices are zero-based
+	// into the file's vertices, which are only kept in vertices when they
+	// weren't parsed into a mesh.
+	vector<ofxHEMesh::Point> vertices;
+	vector<int> faceOffsets;
+	vector<ofxHEMeshVertex> faceVertices;
+};
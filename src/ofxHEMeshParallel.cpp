@@ -0,0 +1,253 @@
+#include "ofxHEMeshParallel.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+namespace hemesh {
+
+static int numThreads = 0;
+static int grainSize = 1024;
+static bool deterministicReductions = false;
+
+// Chunks per thread, giving idle threads something to steal
+static const int ChunksPerThread = 8;
+
+int getNumThreads() {
+	if(numThreads <= 0) {
+		numThreads = std::max(1, int(std::thread::hardware_concurrency()));
+	}
+	return numThreads;
+}
+
+void setNumThreads(int n) {
+	numThreads = n;
+}
+
+int getGrainSize() {
+	return grainSize;
+}
+
+void setGrainSize(int n) {
+	grainSize = std::max(1, n);
+}
+
+bool getDeterministicReductions() {
+	return deterministicReductions;
+}
+
+void setDeterministicReductions(bool v) {
+	deterministicReductions = v;
+}
+
+int reductionChunks(int n, int grain) {
+	int nchunks = (n+grain-1)/std::max(grain, 1);
+	if(!deterministicReductions) {
+		nchunks = std::min(nchunks, getNumThreads()*ChunksPerThread);
+	}
+	return std::max(nchunks, 1);
+}
+
+
+/*
+Each participant in a job (the calling thread plus the workers) starts with a
+contiguous run of the job's chunks.  It takes chunks from the front of its own
+run and, once that's empty, steals the back half of another participant's run.
+Runs are only ever locked one at a time.
+*/
+class ofxHEMeshThreadPool {
+public:
+	ofxHEMeshThreadPool()
+	:	job(NULL), generation(0), stopping(false)
+	{}
+
+	~ofxHEMeshThreadPool() {
+		stopWorkers();
+	}
+
+	void run(int begin, int end, int nchunks, const std::function<void (int, int)>& fn) {
+		std::lock_guard<std::mutex> jobLock(jobMutex);
+		startWorkers(getNumThreads()-1);
+		int nparticipants = std::min(int(runs.size()), nchunks);
+
+		Job j(begin, end, nchunks, fn);
+		for(int i=0; i < nparticipants; ++i) {
+			runs[i].lo = int((long long)nchunks*i/nparticipants);
+			runs[i].hi = int((long long)nchunks*(i+1)/nparticipants);
+		}
+		for(int i=nparticipants; i < runs.size(); ++i) {
+			runs[i].lo = runs[i].hi = 0;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			j.active = int(workers.size());
+			job = &j;
+			++generation;
+		}
+		wake.notify_all();
+
+		work(j, 0);
+
+		// the job lives on this stack, so wait for every worker to let go of it
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [&]{ return j.active == 0; });
+			job = NULL;
+		}
+		if(j.error) {
+			std::rethrow_exception(j.error);
+		}
+	}
+
+protected:
+	struct Job {
+		Job(int begin, int end, int nchunks, const std::function<void (int, int)>& fn)
+		:	begin(begin), n(end-begin), nchunks(nchunks), fn(fn), active(0), failed(false)
+		{}
+
+		int chunkBegin(int i) const {
+			return begin + int((long long)n*i/nchunks);
+		}
+
+		int begin;
+		int n;
+		int nchunks;
+		const std::function<void (int, int)>& fn;
+		int active;
+		std::atomic<bool> failed;
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	};
+
+	struct Run {
+		Run() : lo(0), hi(0) {}
+
+		std::mutex mutex;
+		int lo;
+		int hi;
+	};
+
+	static thread_local bool inJob;
+
+	// Next chunk for participant p or -1 when all are taken
+	int take(int p) {
+		{
+			Run& own = runs[p];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if(own.lo < own.hi) return own.lo++;
+		}
+		int nruns = int(runs.size());
+		for(int i=1; i < nruns; ++i) {
+			Run& victim = runs[(p+i)%nruns];
+			int lo, hi;
+			{
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				int avail = victim.hi-victim.lo;
+				if(avail <= 0) continue;
+				hi = victim.hi;
+				lo = victim.hi - (avail+1)/2;
+				victim.hi = lo;
+			}
+			if(lo+1 < hi) {
+				Run& own = runs[p];
+				std::lock_guard<std::mutex> lock(own.mutex);
+				own.lo = lo+1;
+				own.hi = hi;
+			}
+			return lo;
+		}
+		return -1;
+	}
+
+	void work(Job& j, int p) {
+		inJob = true;
+		for(int c = take(p); c >= 0; c = take(p)) {
+			if(j.failed) continue;
+			try {
+				j.fn(j.chunkBegin(c), j.chunkBegin(c+1));
+			}
+			catch(...) {
+				std::lock_guard<std::mutex> lock(j.errorMutex);
+				if(!j.error) j.error = std::current_exception();
+				j.failed = true;
+			}
+		}
+		inJob = false;
+	}
+
+	void workerLoop(int p) {
+		unsigned int seen = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while(true) {
+			wake.wait(lock, [&]{ return stopping || (job && generation != seen); });
+			if(stopping) return;
+			seen = generation;
+			Job *j = job;
+			lock.unlock();
+			work(*j, p);
+			lock.lock();
+			if(--j->active == 0) {
+				done.notify_all();
+			}
+		}
+	}
+
+	void startWorkers(int n) {
+		if(n == int(workers.size())) return;
+		stopWorkers();
+		runs = vector<Run>(n+1);
+		for(int i=0; i < n; ++i) {
+			workers.push_back(std::thread(&ofxHEMeshThreadPool::workerLoop, this, i+1));
+		}
+	}
+
+	void stopWorkers() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for(size_t i=0; i < workers.size(); ++i) {
+			workers[i].join();
+		}
+		workers.clear();
+		stopping = false;
+	}
+
+public:
+	static bool isInJob() { return inJob; }
+
+protected:
+	std::mutex jobMutex;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	vector<std::thread> workers;
+	vector<Run> runs;
+	Job *job;
+	unsigned int generation;
+	bool stopping;
+};
+
+thread_local bool ofxHEMeshThreadPool::inJob = false;
+
+static ofxHEMeshThreadPool& threadPool() {
+	static ofxHEMeshThreadPool pool;
+	return pool;
+}
+
+void parallelFor(int begin, int end, const std::function<void (int, int)>& fn, int grain) {
+	int n = end-begin;
+	if(n <= 0) return;
+
+	int nchunks = std::min(getNumThreads()*ChunksPerThread, (n+grain-1)/std::max(grain, 1));
+	if(nchunks <= 1 || getNumThreads() <= 1 || ofxHEMeshThreadPool::isInJob()) {
+		fn(begin, end);
+		return;
+	}
+	threadPool().run(begin, end, nchunks, fn);
+}
+
+} // hemesh::
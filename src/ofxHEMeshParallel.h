@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+using std::vector;
+
+namespace hemesh {
+
+	// Number of worker threads used by the parallel routines (defaults to the hardware concurrency)
+	int getNumThreads();
+	void setNumThreads(int n);
+
+	// Default number of elements per chunk for the per-element loops and reductions
+	int getGrainSize();
+	void setGrainSize(int n);
+
+	// When set, reductions split their range into chunks of exactly the grain size
+	// regardless of the thread count, so their results are bitwise reproducible
+	// across machines and thread settings.
+	bool getDeterministicReductions();
+	void setDeterministicReductions(bool v);
+
+	// Split [begin, end) into contiguous sub-ranges of at least grain items and
+	// call fn(subBegin, subEnd) on each, returning once all have completed.
+	// Sub-ranges are scheduled on a persistent work-stealing thread pool.  Calls
+	// made from inside fn run serially on the calling thread.  The first
+	// exception thrown by fn is rethrown once the other sub-ranges finish.
+	void parallelFor(int begin, int end, const std::function<void (int, int)>& fn, int grain=4096);
+
+	// Number of chunks a reduction over n items splits into
+	int reductionChunks(int n, int grain);
+
+	// Reduce [begin, end) with fn(subBegin, subEnd) returning each chunk's partial
+	// result.  Partials are combined with combine(a, b) in index order.
+	template<typename T, typename Fn, typename Combine>
+	T parallelReduce(int begin, int end, T identity, Fn fn, Combine combine, int grain) {
+		int n = end-begin;
+		if(n <= 0) return identity;
+
+		int nchunks = reductionChunks(n, grain);
+		vector<T> partials(nchunks, identity);
+		parallelFor(0, nchunks, [&](int b, int e) {
+			for(int i=b; i < e; ++i) {
+				partials[i] = fn(begin + int((long long)n*i/nchunks), begin + int((long long)n*(i+1)/nchunks));
+			}
+		}, 1);
+
+		T res = identity;
+		for(int i=0; i < nchunks; ++i) {
+			res = combine(res, partials[i]);
+		}
+		return res;
+	}
+
+	// Sort chunks concurrently then merge them pairwise.  The result is the same
+	// as std::sort for any strict weak ordering that has no equivalent elements.
+	template<typename T, typename Compare>
+	void parallelSort(vector<T>& values, Compare compare, int grain=1<<16) {
+		int n = int(values.size());
+		int nchunks = std::max(1, std::min(getNumThreads(), n/std::max(grain, 1)));
+		if(nchunks <= 1) {
+			std::sort(values.begin(), values.end(), compare);
+			return;
+		}
+
+		vector<int> bounds(nchunks+1);
+		for(int i=0; i <= nchunks; ++i) {
+			bounds[i] = int((long long)n*i/nchunks);
+		}
+		parallelFor(0, nchunks, [&](int b, int e) {
+			for(int i=b; i < e; ++i) {
+				std::sort(values.begin()+bounds[i], values.begin()+bounds[i+1], compare);
+			}
+		}, 1);
+
+		for(int width=1; width < nchunks; width *= 2) {
+			int npairs = (nchunks+2*width-1)/(2*width);
+			parallelFor(0, npairs, [&](int b, int e) {
+				for(int i=b; i < e; ++i) {
+					int lo = i*2*width;
+					int mid = std::min(lo+width, nchunks);
+					int hi = std::min(lo+2*width, nchunks);
+					if(mid < hi) {
+						std::inplace_merge(
+							values.begin()+bounds[lo],
+							values.begin()+bounds[mid],
+							values.begin()+bounds[hi],
+							compare
+						);
+					}
+				}
+			}, 1);
+		}
+	}
+
+} // hemesh::
@@ -0,0 +1,224 @@
+#pragma once
+
+/*
+The core of the addon (connectivity, properties, IO, subdivision, DEC) only
+needs vector maths, logging and file checks from openFrameworks.  Defining
+OFX_HEMESH_HEADLESS replaces ofMain.h with the minimal versions of those below
+so the core builds and runs without openFrameworks or a display, see
+CMakeLists.txt.  Drawing and selection always need openFrameworks.
+*/
+
+#ifndef OFX_HEMESH_HEADLESS
+
+#include "ofMain.h"
+
+#else
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+
+using namespace std;
+
+#ifndef MIN
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+#endif
+#ifndef MAX
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#endif
+#ifndef ABS
+#define ABS(x) (((x) < 0) ? -(x) : (x))
+#endif
+
+typedef unsigned int ofIndexType;
+
+class ofVec3f {
+public:
+	ofVec3f() : x(0), y(0), z(0) {}
+	ofVec3f(float x, float y, float z=0) : x(x), y(y), z(z) {}
+
+	void set(float x_, float y_, float z_=0) { x = x_; y = y_; z = z_; }
+
+	float& operator[](int i) { return getPtr()[i]; }
+	const float& operator[](int i) const { return getPtr()[i]; }
+	float* getPtr() { return &x; }
+	const float* getPtr() const { return &x; }
+
+	bool operator==(const ofVec3f& v) const { return x == v.x && y == v.y && z == v.z; }
+	bool operator!=(const ofVec3f& v) const { return !(*this == v); }
+
+	ofVec3f operator+(const ofVec3f& v) const { return ofVec3f(x+v.x, y+v.y, z+v.z); }
+	ofVec3f operator-(const ofVec3f& v) const { return ofVec3f(x-v.x, y-v.y, z-v.z); }
+	ofVec3f operator*(const ofVec3f& v) const { return ofVec3f(x*v.x, y*v.y, z*v.z); }
+	ofVec3f operator/(const ofVec3f& v) const { return ofVec3f(x/v.x, y/v.y, z/v.z); }
+	ofVec3f operator*(float s) const { return ofVec3f(x*s, y*s, z*s); }
+	ofVec3f operator/(float s) const { return ofVec3f(x/s, y/s, z/s); }
+	ofVec3f operator-() const { return ofVec3f(-x, -y, -z); }
+
+	ofVec3f& operator+=(const ofVec3f& v) { x += v.x; y += v.y; z += v.z; return *this; }
+	ofVec3f& operator-=(const ofVec3f& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	ofVec3f& operator*=(const ofVec3f& v) { x *= v.x; y *= v.y; z *= v.z; return *this; }
+	ofVec3f& operator*=(float s) { x *= s; y *= s; z *= s; return *this; }
+	ofVec3f& operator/=(float s) { x /= s; y /= s; z /= s; return *this; }
+
+	float dot(const ofVec3f& v) const { return x*v.x + y*v.y + z*v.z; }
+	ofVec3f getCrossed(const ofVec3f& v) const {
+		return ofVec3f(y*v.z - z*v.y, z*v.x - x*v.z, x*v.y - y*v.x);
+	}
+	ofVec3f crossed(const ofVec3f& v) const { return getCrossed(v); }
+	// In place, as in openFrameworks
+	ofVec3f& cross(const ofVec3f& v) { *this = getCrossed(v); return *this; }
+
+	float length() const { return sqrtf(lengthSquared()); }
+	float lengthSquared() const { return x*x + y*y + z*z; }
+	float squareLength() const { return lengthSquared(); }
+	float distance(const ofVec3f& v) const { return (*this-v).length(); }
+	float squareDistance(const ofVec3f& v) const { return (*this-v).lengthSquared(); }
+	float distanceSquared(const ofVec3f& v) const { return squareDistance(v); }
+
+	ofVec3f& normalize() {
+		float l = length();
+		if(l > 0) { x /= l; y /= l; z /= l; }
+		return *this;
+	}
+	ofVec3f getNormalized() const { ofVec3f v(*this); return v.normalize(); }
+	ofVec3f getInterpolated(const ofVec3f& v, float p) const { return *this*(1-p) + v*p; }
+	ofVec3f getMiddle(const ofVec3f& v) const { return (*this+v)*0.5f; }
+
+	float x, y, z;
+};
+
+inline ofVec3f operator*(float s, const ofVec3f& v) { return v*s; }
+
+inline std::ostream& operator<<(std::ostream& os, const ofVec3f& v) {
+	return os << v.x << ", " << v.y << ", " << v.z;
+}
+
+// Row-major like openFrameworks', the default is the identity
+class ofMatrix4x4 {
+public:
+	ofMatrix4x4() { makeIdentityMatrix(); }
+	ofMatrix4x4(float a00, float a01, float a02, float a03,
+				float a10, float a11, float a12, float a13,
+				float a20, float a21, float a22, float a23,
+				float a30, float a31, float a32, float a33)
+	{
+		float *m = getPtr();
+		m[0] = a00; m[1] = a01; m[2] = a02; m[3] = a03;
+		m[4] = a10; m[5] = a11; m[6] = a12; m[7] = a13;
+		m[8] = a20; m[9] = a21; m[10] = a22; m[11] = a23;
+		m[12] = a30; m[13] = a31; m[14] = a32; m[15] = a33;
+	}
+
+	void makeIdentityMatrix() {
+		for(int i=0; i < 4; ++i) {
+			for(int j=0; j < 4; ++j) {
+				_mat[i][j] = i == j ? 1 : 0;
+			}
+		}
+	}
+
+	float& operator()(int row, int col) { return _mat[row][col]; }
+	float operator()(int row, int col) const { return _mat[row][col]; }
+	float* getPtr() { return &_mat[0][0]; }
+	const float* getPtr() const { return &_mat[0][0]; }
+
+	float _mat[4][4];
+};
+
+class ofMatrix3x3 {
+public:
+	ofMatrix3x3(float a=0, float b=0, float c=0, float d=0, float e=0, float f=0, float g=0, float h=0, float i=0)
+	:	a(a), b(b), c(c), d(d), e(e), f(f), g(g), h(h), i(i)
+	{}
+
+	float determinant() const {
+		return a*(e*i - f*h) - b*(d*i - f*g) + c*(d*h - e*g);
+	}
+
+	float a, b, c;
+	float d, e, f;
+	float g, h, i;
+};
+
+class ofMesh {
+public:
+	void addVertex(const ofVec3f& v) { vertices.push_back(v); }
+	void addIndex(ofIndexType i) { indices.push_back(i); }
+	vector<ofVec3f>& getVertices() { return vertices; }
+	const vector<ofVec3f>& getVertices() const { return vertices; }
+	vector<ofIndexType>& getIndices() { return indices; }
+	const vector<ofIndexType>& getIndices() const { return indices; }
+	void clear() { vertices.clear(); indices.clear(); }
+
+protected:
+	vector<ofVec3f> vertices;
+	vector<ofIndexType> indices;
+};
+
+// Paths are used as given, there's no data folder
+class ofFile {
+public:
+	enum Mode { Reference, ReadOnly, WriteOnly, ReadWrite, Append };
+
+	bool open(const string& p, Mode mode=ReadOnly, bool binary=false) {
+		path = p;
+		return exists();
+	}
+	bool exists() const {
+		std::ifstream f(path.c_str());
+		return f.good();
+	}
+	string getAbsolutePath() const { return path; }
+
+protected:
+	string path;
+};
+
+// Messages are written to stderr when the logger goes out of scope
+class ofxHEMeshLogger {
+public:
+	ofxHEMeshLogger(const char *level, const string& module, bool enabled=true)
+	:	enabled(enabled)
+	{
+		if(enabled) ss << "[" << level << "] " << module << ": ";
+	}
+	~ofxHEMeshLogger() {
+		if(enabled) std::cerr << ss.str() << std::endl;
+	}
+
+	template<typename T>
+	ofxHEMeshLogger& operator<<(const T& value) {
+		if(enabled) ss << value;
+		return *this;
+	}
+
+protected:
+	bool enabled;
+	std::stringstream ss;
+};
+
+class ofLogVerbose : public ofxHEMeshLogger {
+public:
+	ofLogVerbose(const string& module) : ofxHEMeshLogger("verbose", module, false) {}
+};
+
+class ofLogNotice : public ofxHEMeshLogger {
+public:
+	ofLogNotice(const string& module) : ofxHEMeshLogger("notice", module) {}
+};
+
+class ofLogWarning : public ofxHEMeshLogger {
+public:
+	ofLogWarning(const string& module) : ofxHEMeshLogger("warning", module) {}
+};
+
+class ofLogError : public ofxHEMeshLogger {
+public:
+	ofLogError(const string& module) : ofxHEMeshLogger("error", module) {}
+};
+
+#endif
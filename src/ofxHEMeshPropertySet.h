@@ -2,6 +2,13 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <utility>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include <cassert>
+#include <stddef.h>
 
 using std::string;
 using std::vector;
@@ -10,175 +17,714 @@ using std::map;
 
 /*
 In order to define generic properties agnostic of type, there has to be a virtual base class
-that is inherited by a templated sub-class such that all instantiations of the template can be 
+that is inherited by a templated sub-class such that all instantiations of the template can be
 stored in a single collection as pointers.
+
+Storage is allocated ahead of the element count.  Slots past size() always hold the
+property's default value, so a property set can add an element by bumping each
+property's count without any per-property virtual calls.  Storage only has to grow
+(through the virtual interface) when the set runs out of capacity.
+
+Items are stored in reference counted blocks of BlockSize, which are shared
+when a property is copied and copied themselves the first time either side
+writes to them.  Copying a mesh is therefore O(#blocks), and a copy can be
+read from other threads while the original keeps changing.  Copies have to
+be taken on the thread that writes to the original.
+
+The blocks of a property nothing shares are slices of one allocation, which
+grows like a vector's, so rawData() is contiguous and can be read or written
+in one go.  Once a property has been copied, growing it appends blocks instead
+(so the copy's items don't move) and writes copy single blocks out, after which
+the items are only contiguous block by block until the non-const rawData()
+gathers them again.
 */
 // interface that doesn't require knowing the array element type
 class ofxHEMeshPropertyBase {
 public:
-	ofxHEMeshPropertyBase() {}
+	friend class ofxHEMeshPropertySet;
+
+	// Type tags identifying the element type when properties are serialized
+	enum Type {
+		Unknown = 0,
+		Int8,
+		UInt8,
+		Int32,
+		UInt32,
+		Float32,
+		Float64,
+		Vec3f,
+		VertexIndex,
+		HalfedgeIndex,
+		FaceIndex,
+		VertexAdjacency,
+		HalfedgeAdjacency,
+		FaceAdjacency
+	};
+
+	enum {
+		BlockBits = 10,
+		BlockSize = 1 << BlockBits,
+		BlockMask = BlockSize-1
+	};
+
+	ofxHEMeshPropertyBase() : count(0) {}
 	virtual ~ofxHEMeshPropertyBase() {}
 
-	virtual int capacity() = 0;
+	virtual const string& getName() const = 0;
+	virtual int getType() const = 0;
+	virtual int elementSize() const = 0;
+	// Contiguous storage of items [b*BlockSize, (b+1)*BlockSize).  The non-const
+	// version copies the block first if it's shared.
+	virtual void * rawBlock(int b) = 0;
+	virtual const void * rawBlock(int b) const = 0;
+	int numBlocks() const { return (capacity() + BlockMask) >> BlockBits; }
+	// Contiguous storage of all capacity() items (NULL when nothing is
+	// allocated).  The non-const version gathers the items into one unshared
+	// allocation first if they aren't already, the const one never copies and
+	// is NULL unless isContiguous().  Writes through the pointer after the
+	// property is copied change the copy too, so get it again after copying.
+	virtual void * rawData() = 0;
+	virtual const void * rawData() const = 0;
+	virtual bool isContiguous() const = 0;
+
+	// Number of allocated slots
+	virtual int capacity() const = 0;
 	virtual void clear() = 0;
 	virtual void extend() = 0;
 	virtual void resize(int n) = 0;
 	virtual void reserve(int n) = 0;
 	virtual void swapItems(int idx1, int idx2) = 0;
-	virtual int size() const = 0;
-	virtual ofxHEMeshPropertyBase * duplicate() = 0;
+	// Set an item back to the property's default value
+	virtual void resetItem(int idx) = 0;
+	virtual void copyItem(int from, int to) = 0;
+	// Move item i to indexMap[i] (dropping it when negative) and shrink to n items.
+	// Requires indexMap[i] <= i.
+	virtual void compactItems(const vector<int>& indexMap, int n) = 0;
+	virtual ofxHEMeshPropertyBase * duplicate() const = 0;
+	// Empty property with the same type, name and default value
+	virtual ofxHEMeshPropertyBase * create() const = 0;
+	// Set item to to item from of src, which has to be of the same type
+	virtual void copyItemFrom(const ofxHEMeshPropertyBase& src, int from, int to) = 0;
+	// Whether other has the same element type
+	virtual bool sameType(const ofxHEMeshPropertyBase& other) const = 0;
+	// Share the items of src, which has to be of the same type, in place of
+	// this property's own
+	virtual void assign(const ofxHEMeshPropertyBase& src) = 0;
+	// Exchange items with other, which has to be of the same type, without
+	// touching the blocks
+	virtual void swapContents(ofxHEMeshPropertyBase& other) = 0;
+
+	int size() const { return count; }
 
 protected:
+	// Reset items [begin, end) to the default value
+	virtual void resetItems(int begin, int end) = 0;
+
+	int count;
 };
 
 
-// wrapper around std::vector
+// Maps an element type to its ofxHEMeshPropertyBase::Type tag.  Properties of
+// Unknown type can't be serialized.
+template <typename T>
+struct ofxHEMeshPropertyTraits {
+	enum { Type = ofxHEMeshPropertyBase::Unknown };
+};
+
+#define OFX_HEMESH_PROPERTY_TYPE(T, tag) \
+	template <> \
+	struct ofxHEMeshPropertyTraits<T> { \
+		enum { Type = ofxHEMeshPropertyBase::tag }; \
+	};
+
+OFX_HEMESH_PROPERTY_TYPE(char, Int8)
+OFX_HEMESH_PROPERTY_TYPE(unsigned char, UInt8)
+OFX_HEMESH_PROPERTY_TYPE(int, Int32)
+OFX_HEMESH_PROPERTY_TYPE(unsigned int, UInt32)
+OFX_HEMESH_PROPERTY_TYPE(float, Float32)
+OFX_HEMESH_PROPERTY_TYPE(double, Float64)
+
+
+// Typed storage in copy-on-write blocks.  const access never copies, get() and
+// set() on a non-const property copy the block they write to when it's shared.
+// Before writing from several threads at once, unshare() the range.
 template <typename T>
 class ofxHEMeshProperty : public ofxHEMeshPropertyBase {
 public:
 	ofxHEMeshProperty(const string &name, T def=T())
-	:	name(name), def(def)
+	:	name(name), segmentSize(0), segmentBlocks(0), def(def)
 	{}
-	
-	ofxHEMeshProperty(const ofxHEMeshProperty& src) {
-		name = src.name;
-		values = src.values;
-		def = src.def;
+
+	// Shares src's blocks, src copies them again before its next write to them
+	ofxHEMeshProperty(const ofxHEMeshProperty& src)
+	:	name(src.name)
+	{
+		assign(src);
+	}
+
+	const string& getName() const { return name; }
+	int getType() const { return ofxHEMeshPropertyTraits<T>::Type; }
+	int elementSize() const { return int(sizeof(T)); }
+	void * rawBlock(int b) { return block(b); }
+	const void * rawBlock(int b) const { return block(b); }
+	void * rawData() { return ptr(); }
+	const void * rawData() const { return ptr(); }
+	bool isContiguous() const { return segmentBlocks == int(blocks.size()); }
+
+	T* ptr() {
+		if(!isContiguous() || !ownsSegment()) {
+			gather(int(blocks.size()));
+		}
+		std::fill(owned.begin(), owned.end(), 1);
+		return data.empty() ? NULL : data[0];
+	}
+	const T* ptr() const {
+		return (isContiguous() && !data.empty()) ? data[0] : NULL;
+	}
+
+	int capacity() const { return int(blocks.size()) << BlockBits; }
+	void clear() {
+		resetItems(0, count);
+		count = 0;
+	}
+	void extend() { resize(count+1); }
+	// idx has to be a slot, invalid elements (-1) aren't
+	T& get(int idx) {
+		assert(idx >= 0 && idx < capacity());
+		int b = idx >> BlockBits;
+		if(!owned[b]) unshareBlock(b);
+		return data[b][idx & BlockMask];
+	}
+	const T& get(int idx) const {
+		assert(idx >= 0 && idx < capacity());
+		return data[idx >> BlockBits][idx & BlockMask];
 	}
-	
-	int capacity() { return int(values.capacity()); }
-	void clear() { values.clear(); }
-	void extend() { values.push_back(def); }
-	T& get(int idx) { return values[idx]; }
-	const T& get(int idx) const { return values[idx]; }
 	T& last() { return get(size()-1); }
 	const T& last() const { return get(size()-1); }
-	void resize(int n) { values.resize(n, def); }
-	void reserve(int n) { values.reserve(n); }
+	void resize(int n) {
+		if(n > capacity()) {
+			reserve(n);
+		}
+		else if(n < count) {
+			resetItems(n, count);
+		}
+		count = n;
+	}
+	// Contiguous storage nothing else shares is reallocated with room to
+	// spare, otherwise blocks are appended and the shared items don't move
+	void reserve(int n) {
+		if(n <= capacity()) return;
+		int nb = (n + BlockMask) >> BlockBits;
+		if(isContiguous() && ownsSegment()) {
+			gather(std::max(nb, 2*int(blocks.size())));
+			return;
+		}
+		while(int(blocks.size()) < nb) {
+			std::shared_ptr<T> block = allocate(1);
+			data.push_back(block.get());
+			blocks.push_back(block);
+			owned.push_back(1);
+		}
+	}
 	void set(int idx, const T &v) {
-		values[idx] = v;
+		get(idx) = v;
 	}
-	int size() const { return int(values.size()); }
 	void swapItems(int idx1, int idx2) {
-		T tmp = values[idx1];
-		values[idx1] = values[idx2];
-		values[idx2] = tmp;
-	}
-	
-	T* ptr() { return &values[0]; }
-	const T* ptr() const { return &values[0]; }
-	
-	vector<T>& getValues() { return values; }
-	const vector<T>& getValues() const { return values; }
-	
-	ofxHEMeshPropertyBase * duplicate() {
-		ofxHEMeshProperty *property = new ofxHEMeshProperty(name, def);
-		property->values = values;
-		return property;
+		T tmp = get(idx1);
+		get(idx1) = get(idx2);
+		get(idx2) = tmp;
+	}
+	void resetItem(int idx) { set(idx, def); }
+	void copyItem(int from, int to) { set(to, T(get(from))); }
+	void compactItems(const vector<int>& indexMap, int n) {
+		int nitems = std::min(count, int(indexMap.size()));
+		int last = 0;
+		for(int i=0; i < nitems; ++i) {
+			if(indexMap[i] >= 0) {
+				if(indexMap[i] != i) set(indexMap[i], get(i));
+				last = indexMap[i]+1;
+			}
+		}
+		// properties that were shorter than the index map stay short
+		int newCount = count >= int(indexMap.size()) ? n : last;
+		resetItems(newCount, count);
+		count = newCount;
+	}
+
+	T* block(int b) {
+		if(!owned[b]) unshareBlock(b);
+		return data[b];
+	}
+	const T* block(int b) const { return data[b]; }
+
+	// Copy the shared blocks holding items [begin, end) so they can be written
+	// concurrently
+	void unshare(int begin, int end) {
+		if(begin >= end) return;
+		for(int b=begin >> BlockBits; b <= ((end-1) >> BlockBits); ++b) {
+			if(!owned[b]) unshareBlock(b);
+		}
+	}
+
+	// Copy items [begin, end) to or from contiguous memory
+	void copyTo(T *dst, int begin, int end) const {
+		while(begin < end) {
+			int n = std::min(end, (begin | BlockMask)+1) - begin;
+			const T *src = data[begin >> BlockBits] + (begin & BlockMask);
+			std::copy(src, src+n, dst);
+			dst += n;
+			begin += n;
+		}
+	}
+	void copyFrom(const T *src, int begin, int end) {
+		while(begin < end) {
+			int n = std::min(end, (begin | BlockMask)+1) - begin;
+			std::copy(src, src+n, block(begin >> BlockBits) + (begin & BlockMask));
+			src += n;
+			begin += n;
+		}
+	}
+
+	ofxHEMeshPropertyBase * duplicate() const {
+		return new ofxHEMeshProperty(*this);
+	}
+
+	ofxHEMeshPropertyBase * create() const {
+		return new ofxHEMeshProperty(name, def);
+	}
+
+	void copyItemFrom(const ofxHEMeshPropertyBase& src, int from, int to) {
+		set(to, static_cast<const ofxHEMeshProperty&>(src).get(from));
+	}
+
+	bool sameType(const ofxHEMeshPropertyBase& other) const {
+		return dynamic_cast<const ofxHEMeshProperty *>(&other) != NULL;
+	}
+
+	// Shares src's blocks like the copy constructor, keeping this property's name
+	void assign(const ofxHEMeshPropertyBase& other) {
+		const ofxHEMeshProperty& src = static_cast<const ofxHEMeshProperty&>(other);
+		if(&src == this) return;
+		blocks = src.blocks;
+		data = src.data;
+		segment = src.segment;
+		segmentSize = src.segmentSize;
+		segmentBlocks = src.segmentBlocks;
+		owned.assign(blocks.size(), 0);
+		src.owned.assign(src.blocks.size(), 0);
+		def = src.def;
+		count = src.count;
+	}
+
+	void swapContents(ofxHEMeshPropertyBase& other) {
+		ofxHEMeshProperty& src = static_cast<ofxHEMeshProperty&>(other);
+		blocks.swap(src.blocks);
+		data.swap(src.data);
+		segment.swap(src.segment);
+		std::swap(segmentSize, src.segmentSize);
+		std::swap(segmentBlocks, src.segmentBlocks);
+		owned.swap(src.owned);
+		std::swap(def, src.def);
+		std::swap(count, src.count);
 	}
 
 protected:
+	// n blocks worth of default items
+	std::shared_ptr<T> allocate(int n) const {
+		std::shared_ptr<T> items(new T[size_t(n) << BlockBits], std::default_delete<T[]>());
+		std::fill(items.get(), items.get() + (size_t(n) << BlockBits), def);
+		return items;
+	}
+
+	// Whether block b is still a slice of the segment
+	bool inSegment(int b) const {
+		return b < segmentSize && data[b] == segment.get() + (size_t(b) << BlockBits);
+	}
+	// The segment is held once by the property and once by each of its slices
+	bool ownsSegment() const {
+		return !segment || segment.use_count() == segmentBlocks+1;
+	}
+
+	// Move the items into a new segment of nb blocks, which all of the
+	// property's blocks are slices of
+	void gather(int nb) {
+		std::shared_ptr<T> items = allocate(nb);
+		for(int b=0; b < int(blocks.size()); ++b) {
+			std::copy(data[b], data[b]+BlockSize, items.get() + (size_t(b) << BlockBits));
+		}
+		blocks.resize(nb);
+		data.resize(nb);
+		owned.assign(nb, 1);
+		for(int b=0; b < nb; ++b) {
+			data[b] = items.get() + (size_t(b) << BlockBits);
+			blocks[b] = std::shared_ptr<T>(items, data[b]);
+		}
+		segment = items;
+		segmentSize = nb;
+		segmentBlocks = nb;
+	}
+
+	void replaceBlock(int b, const std::shared_ptr<T>& block) {
+		if(inSegment(b) && --segmentBlocks == 0) {
+			segment.reset();
+			segmentSize = 0;
+		}
+		data[b] = block.get();
+		blocks[b] = block;
+		owned[b] = 1;
+	}
+
+	void unshareBlock(int b) {
+		// the last other owner may have released the block from another thread
+		if(inSegment(b) ? ownsSegment() : blocks[b].use_count() == 1) {
+			std::atomic_thread_fence(std::memory_order_acquire);
+			owned[b] = 1;
+		}
+		else {
+			std::shared_ptr<T> block(new T[BlockSize], std::default_delete<T[]>());
+			std::copy(data[b], data[b]+BlockSize, block.get());
+			replaceBlock(b, block);
+		}
+	}
+
+	void resetItems(int begin, int end) {
+		while(begin < end) {
+			int b = begin >> BlockBits;
+			int n = std::min(end, (begin | BlockMask)+1) - begin;
+			if(n == BlockSize && !owned[b]) {
+				// replace whole shared blocks instead of copying them
+				replaceBlock(b, allocate(1));
+			}
+			else {
+				T *items = block(b) + (begin & BlockMask);
+				std::fill(items, items+n, def);
+			}
+			begin += n;
+		}
+	}
+
 	string name;
-	vector<T> values;
+	// Blocks of BlockSize items, slices of segment while they're contiguous
+	vector<std::shared_ptr<T> > blocks;
+	// blocks[b].get()
+	vector<T *> data;
+	std::shared_ptr<T> segment;
+	int segmentSize;
+	// Number of blocks that are still slices of segment
+	int segmentBlocks;
+	// Whether blocks[b] is known not to be shared, only touched by the writing thread
+	mutable vector<unsigned char> owned;
 	T def;
 };
 
+
+// Index of a property in an ofxHEMeshPropertySet, valid until the property is removed
+template <typename T>
+struct ofxHEMeshPropertyHandle {
+	explicit ofxHEMeshPropertyHandle(int idx=-1)
+	:	idx(idx)
+	{}
+
+	bool isValid() const { return idx >= 0; }
+
+	int idx;
+};
+
+
+// Owns a group of properties that all have one item per element.  Properties are
+// stored by index; names are only used to look them up.
 class ofxHEMeshPropertySet {
 public:
-	typedef map<string, void*> PropertyMap;
-	typedef map<string, void*>::iterator PropertyMapIterator;
-	typedef map<string, void*>::const_iterator PropertyMapConstIterator;
+	ofxHEMeshPropertySet()
+	:	count(0), allocated(0)
+	{}
+
+	ofxHEMeshPropertySet(const ofxHEMeshPropertySet& src)
+	:	count(0), allocated(0)
+	{
+		try {
+			src.duplicate(*this);
+		}
+		catch(...) {
+			removeAll();
+			throw;
+		}
+	}
+
+	// Takes src's properties, leaving it empty
+	ofxHEMeshPropertySet(ofxHEMeshPropertySet&& src)
+	:	count(0), allocated(0)
+	{
+		swap(src);
+	}
+
+	ofxHEMeshPropertySet& operator=(const ofxHEMeshPropertySet& src) {
+		if(this != &src) {
+			ofxHEMeshPropertySet tmp(src);
+			swap(tmp);
+		}
+		return *this;
+	}
+
+	ofxHEMeshPropertySet& operator=(ofxHEMeshPropertySet&& src) {
+		if(this != &src) {
+			removeAll();
+			swap(src);
+		}
+		return *this;
+	}
 
-	ofxHEMeshPropertySet() {}
 	~ofxHEMeshPropertySet() {
-		clear();
+		removeAll();
 	}
-	
+
 	void clear() {
-		PropertyMapIterator it = properties.begin();
-		PropertyMapIterator ite = properties.end();
-		for(; it != ite; ++it) {
-			((ofxHEMeshPropertyBase *)it->second)->clear();
+		for(int i=0; i < properties.size(); ++i) {
+			if(properties[i]) properties[i]->clear();
 		}
+		count = 0;
 	}
-	
+
+	// Adds a property sized to the set, or returns the existing one of the same name
 	template <typename T>
 	ofxHEMeshProperty<T> * add(const string &name, T def) {
-		ofxHEMeshProperty<T>* prop = new ofxHEMeshProperty<T>(name);
-		properties.insert(std::pair<string, void*>(name, prop));
-		prop->resize(size());
+		map<string, int>::const_iterator it = names.find(name);
+		if(it != names.end()) {
+			ofxHEMeshProperty<T> *prop = dynamic_cast<ofxHEMeshProperty<T> *>(properties[it->second]);
+			if(!prop) throw std::invalid_argument("property " + name + " already exists with a different type");
+			return prop;
+		}
+
+		ofxHEMeshProperty<T>* prop = new ofxHEMeshProperty<T>(name, def);
+		prop->reserve(allocated);
+		prop->count = count;
+		names.insert(std::pair<string, int>(name, int(properties.size())));
+		properties.push_back(prop);
 		return prop;
 	}
-	
+
 	ofxHEMeshPropertyBase * get(const string& name) {
-		ofxHEMeshPropertyBase *prop = NULL;
-		PropertyMap::iterator it = properties.find(name);
-		if(it != properties.end()) {
-			prop = (ofxHEMeshPropertyBase *)it->second;
+		map<string, int>::const_iterator it = names.find(name);
+		return it != names.end() ? properties[it->second] : NULL;
+	}
+
+	template <typename T>
+	ofxHEMeshPropertyHandle<T> handle(const string& name) const {
+		map<string, int>::const_iterator it = names.find(name);
+		if(it != names.end() && dynamic_cast<ofxHEMeshProperty<T> *>(properties[it->second])) {
+			return ofxHEMeshPropertyHandle<T>(it->second);
 		}
-		return prop;
+		return ofxHEMeshPropertyHandle<T>();
+	}
+
+	template <typename T>
+	ofxHEMeshProperty<T>& get(ofxHEMeshPropertyHandle<T> handle) {
+		return *static_cast<ofxHEMeshProperty<T> *>(properties[handle.idx]);
 	}
-	
+
+	template <typename T>
+	const ofxHEMeshProperty<T>& get(ofxHEMeshPropertyHandle<T> handle) const {
+		return *static_cast<const ofxHEMeshProperty<T> *>(properties[handle.idx]);
+	}
+
 	void remove(const string &name) {
-		PropertyMapIterator it = properties.find(name);
-		if(it != properties.end()) {
-			ofxHEMeshPropertyBase *prop = (ofxHEMeshPropertyBase *)it->second;
-			properties.erase(it);
-			delete prop;
+		map<string, int>::iterator it = names.find(name);
+		if(it != names.end()) {
+			// leave a hole so the handles of other properties stay valid
+			delete properties[it->second];
+			properties[it->second] = NULL;
+			names.erase(it);
 		}
 	}
-	
+
+	// Property slots in the order they were added, NULL for removed properties
+	int getNumProperties() const { return int(properties.size()); }
+	ofxHEMeshPropertyBase * getProperty(int idx) { return properties[idx]; }
+	const ofxHEMeshPropertyBase * getProperty(int idx) const { return properties[idx]; }
+
 	void extend() {
-		PropertyMapIterator it = properties.begin();
-		PropertyMapIterator ite = properties.end();
-		for(; it != ite; ++it) {
-			((ofxHEMeshPropertyBase *)it->second)->extend();
+		if(count == allocated) {
+			reserve(std::max(16, allocated*2));
+		}
+		++count;
+		for(int i=0; i < properties.size(); ++i) {
+			if(properties[i]) properties[i]->count = count;
 		}
 	}
-	
+
+	void extend(int n) {
+		resize(count+n);
+	}
+
 	void resize(int n) {
-		PropertyMapIterator it = properties.begin();
-		PropertyMapIterator ite = properties.end();
-		for(; it != ite; ++it) {
-			((ofxHEMeshPropertyBase *)it->second)->resize(n);
+		if(n > allocated) {
+			reserve(std::max(n, allocated*2));
 		}
+		for(int i=0; i < properties.size(); ++i) {
+			if(properties[i]) {
+				if(n < properties[i]->count) {
+					properties[i]->resetItems(n, properties[i]->count);
+				}
+				properties[i]->count = n;
+			}
+		}
+		count = n;
 	}
-	
+
 	void reserve(int n) {
-		PropertyMapIterator it = properties.begin();
-		PropertyMapIterator ite = properties.end();
-		for(; it != ite; ++it) {
-			((ofxHEMeshPropertyBase *)it->second)->reserve(n);
+		if(n > allocated) {
+			for(int i=0; i < properties.size(); ++i) {
+				if(properties[i]) properties[i]->reserve(n);
+			}
+			allocated = n;
 		}
 	}
-	
-	// assumes arrays are always synchonized after an add operation
-	int size() const {
-		PropertyMapConstIterator it = properties.begin();
-		if(it == properties.end()) return 0;
-		else return ((ofxHEMeshPropertyBase *)it->second)->size();
+
+	int size() const { return count; }
+
+	void resetItem(int idx) {
+		for(int i=0; i < properties.size(); ++i) {
+			if(properties[i]) properties[i]->resetItem(idx);
+		}
+	}
+
+	void compactItems(const vector<int>& indexMap, int n) {
+		for(int i=0; i < properties.size(); ++i) {
+			if(properties[i]) properties[i]->compactItems(indexMap, n);
+		}
+		if(count >= int(indexMap.size())) {
+			count = n;
+		}
 	}
-	
+
 	void swapItems(int idx1, int idx2) {
-		PropertyMapIterator it = properties.begin();
-		PropertyMapIterator ite = properties.end();
-		for(; it != ite; ++it) {
-			((ofxHEMeshPropertyBase *)it->second)->swapItems(idx1, idx2);
+		for(int i=0; i < properties.size(); ++i) {
+			if(properties[i]) properties[i]->swapItems(idx1, idx2);
+		}
+	}
+
+	// Take src's properties and items by sharing their blocks.  Properties are
+	// matched by name and this set's property objects are kept, so pointers to
+	// them stay valid.  Properties only src has are copied in, and the ones only
+	// this set has stay with default values.  A property whose type differs
+	// from src's is replaced.
+	void assign(const ofxHEMeshPropertySet& src) {
+		if(this == &src) return;
+		vector<char> matched(properties.size(), 0);
+		for(int i=0; i < src.properties.size(); ++i) {
+			const ofxHEMeshPropertyBase *prop = src.properties[i];
+			if(!prop) continue;
+			map<string, int>::const_iterator it = names.find(prop->getName());
+			if(it != names.end() && properties[it->second]->sameType(*prop)) {
+				properties[it->second]->assign(*prop);
+				matched[it->second] = 1;
+				continue;
+			}
+			if(it != names.end()) remove(prop->getName());
+			names.insert(std::pair<string, int>(prop->getName(), int(properties.size())));
+			properties.push_back(prop->duplicate());
+			matched.push_back(1);
+		}
+		for(int i=0; i < properties.size(); ++i) {
+			if(properties[i] && !matched[i]) {
+				properties[i]->resetItems(0, properties[i]->count);
+				properties[i]->reserve(src.allocated);
+				properties[i]->count = src.count;
+			}
+		}
+		count = src.count;
+		allocated = src.allocated;
+	}
+
+	// Exchange items with other in O(#properties) without touching any blocks.
+	// Properties of the same name and type swap their items in place, so
+	// pointers to them stay valid.  Like assign(), a property only one set has
+	// stays there with default values and the other set gets its items in a new
+	// property, and properties whose types differ trade places.
+	void swapContents(ofxHEMeshPropertySet& other) {
+		if(this == &other) return;
+		int n = int(properties.size());
+		int m = int(other.properties.size());
+		vector<char> emptied(n, 0);
+		vector<char> otherMatched(m, 0);
+		for(int i=0; i < n; ++i) {
+			ofxHEMeshPropertyBase *prop = properties[i];
+			if(!prop) continue;
+			map<string, int>::iterator it = other.names.find(prop->getName());
+			if(it == other.names.end()) {
+				ofxHEMeshPropertyBase *moved = prop->create();
+				moved->swapContents(*prop);
+				other.names.insert(std::pair<string, int>(prop->getName(), int(other.properties.size())));
+				other.properties.push_back(moved);
+				emptied[i] = 1;
+				continue;
+			}
+			if(other.properties[it->second]->sameType(*prop)) {
+				prop->swapContents(*other.properties[it->second]);
+			}
+			else {
+				std::swap(properties[i], other.properties[it->second]);
+			}
+			otherMatched[it->second] = 1;
+		}
+		vector<char> otherEmptied(m, 0);
+		for(int i=0; i < m; ++i) {
+			ofxHEMeshPropertyBase *prop = other.properties[i];
+			if(!prop || otherMatched[i]) continue;
+			ofxHEMeshPropertyBase *moved = prop->create();
+			moved->swapContents(*prop);
+			names.insert(std::pair<string, int>(prop->getName(), int(properties.size())));
+			properties.push_back(moved);
+			otherEmptied[i] = 1;
+		}
+		std::swap(count, other.count);
+		std::swap(allocated, other.allocated);
+		for(int i=0; i < n; ++i) {
+			if(emptied[i]) {
+				properties[i]->reserve(allocated);
+				properties[i]->count = count;
+			}
+		}
+		for(int i=0; i < m; ++i) {
+			if(otherEmptied[i]) {
+				other.properties[i]->reserve(other.allocated);
+				other.properties[i]->count = other.count;
+			}
 		}
 	}
-	
+
+	// Property pointers stay valid, they just change sets
+	void swap(ofxHEMeshPropertySet& other) {
+		properties.swap(other.properties);
+		names.swap(other.names);
+		std::swap(count, other.count);
+		std::swap(allocated, other.allocated);
+	}
+
 	void duplicate(ofxHEMeshPropertySet &dst) const {
-		dst.properties = properties;
-		
-		PropertyMapConstIterator it = properties.begin();
-		PropertyMapConstIterator ite = properties.end();
-		for(; it != ite; ++it) {
-			ofxHEMeshPropertyBase *prop = ((ofxHEMeshPropertyBase *)it->second)->duplicate();
-			dst.properties[it->first] = prop;
-			
+		dst.removeAll();
+		dst.properties.resize(properties.size(), NULL);
+		for(int i=0; i < properties.size(); ++i) {
+			if(properties[i]) dst.properties[i] = properties[i]->duplicate();
 		}
+		dst.names = names;
+		dst.count = count;
+		dst.allocated = allocated;
 	}
 
 protected:
-	PropertyMap properties;
-};
\ No newline at end of file
+	void removeAll() {
+		for(int i=0; i < properties.size(); ++i) {
+			delete properties[i];
+		}
+		properties.clear();
+		names.clear();
+		count = 0;
+		allocated = 0;
+	}
+
+	vector<ofxHEMeshPropertyBase *> properties;
+	map<string, int> names;
+	int count;
+	int allocated;
+};
@@ -0,0 +1,842 @@
+#include "ofxHEMeshRefinement.h"
+#include "ofxHEMeshJournal.h"
+#include "ofxHEMeshParallel.h"
+#include <stdexcept>
+#include <limits>
+
+ofxHEMeshRefinement::ofxHEMeshRefinement(ofxHEMesh& hemesh)
+:	hemesh(hemesh),
+	movesVertices(false),
+	stencilRows(0),
+	defaultRule(InheritRule),
+	splitEdges(&hemesh.liveEdges),
+	splitFaces(&hemesh.liveFaces),
+	V(0), E(0), F(0),
+	numSplitEdges(0), numSplitFaces(0), numClosedFaces(0)
+{}
+
+ofxHEMeshRefinement::~ofxHEMeshRefinement() {}
+
+void ofxHEMeshRefinement::setFaceSelector(const string& property) {
+	ofxHEMeshPropertyHandle<bool> handle = hemesh.getFacePropertyHandle<bool>(property);
+	if(!handle.isValid()) throw std::invalid_argument("no bool face property named " + property);
+	selector = [this, handle](ofxHEMeshFace f) {
+		return hemesh.faceProperty(handle).get(f.idx);
+	};
+}
+
+void ofxHEMeshRefinement::apply(int levels) {
+	// Called directly rather than through an ofxHEMesh operation it can't be replayed
+	ofxHEMeshJournal::Scope scope(hemesh, ofxHEMeshJournal::External);
+	for(int i=0; i < levels; ++i) {
+		checkFaces();
+		refine();
+	}
+}
+
+void ofxHEMeshRefinement::checkFaces() const {
+	int nonTriangles = hemesh.parallelReduceFaces(0, [&](ofxHEMeshFace f) {
+		return hemesh.faceSize(f) != 3 ? 1 : 0;
+	}, [](int a, int b) { return a+b; });
+	if(nonTriangles > 0) throw std::invalid_argument("refinement requires a triangle mesh");
+}
+
+void ofxHEMeshRefinement::select() {
+	if(!selector) {
+		splitEdges = &hemesh.liveEdges;
+		splitFaces = &hemesh.liveFaces;
+		closedFaces.clear();
+	}
+	else {
+		vector<char> selected(F, 0);
+		hemesh.parallelForFaces([&](ofxHEMeshFace f) {
+			selected[f.idx] = selector(f) ? 1 : 0;
+		});
+		closeSelection(selected);
+
+		// An edge is split with either of its faces
+		selectedFaces.rebuild(0, F, [&](int f) { return selected[f] != 0; });
+		selectedEdges.rebuild(0, E, [&](int e) {
+			if(!hemesh.liveEdges.test(e)) return false;
+			ofxHEMeshFace f1 = hemesh.halfedgeFace(ofxHEMeshHalfedge(2*e));
+			ofxHEMeshFace f2 = hemesh.halfedgeFace(ofxHEMeshHalfedge(2*e+1));
+			return (f1.isValid() && selected[f1.idx]) || (f2.isValid() && selected[f2.idx]);
+		});
+		closedFaces.rebuild(0, F, [&](int f) {
+			if(!hemesh.liveFaces.test(f) || selected[f]) return false;
+			ofxHEMeshFaceCirculator fc = hemesh.faceCirculate(ofxHEMeshFace(f));
+			ofxHEMeshFaceCirculator fce = fc;
+			do {
+				if(selectedEdges.test((*fc).idx/2)) return true;
+				++fc;
+			} while(fc != fce);
+			return false;
+		});
+		selectedEdges.updateRanks();
+		selectedFaces.updateRanks();
+		closedFaces.updateRanks();
+		splitEdges = &selectedEdges;
+		splitFaces = &selectedFaces;
+	}
+	numSplitEdges = splitEdges->count();
+	numSplitFaces = splitFaces->count();
+	numClosedFaces = closedFaces.count();
+}
+
+// Faces with two or more split edges join the selection until none are left.
+// Each round only looks at the previous one's selection so it can run in
+// parallel, the closure usually takes a round or two.
+void ofxHEMeshRefinement::closeSelection(vector<char>& selected) const {
+	vector<char> added(F, 0);
+	for(;;) {
+		int numAdded = hemesh.parallelReduceFaces(0, [&](ofxHEMeshFace f) {
+			added[f.idx] = 0;
+			if(selected[f.idx]) return 0;
+			int numSplit = 0;
+			ofxHEMeshFaceCirculator fc = hemesh.faceCirculate(f);
+			ofxHEMeshFaceCirculator fce = fc;
+			do {
+				ofxHEMeshFace g = hemesh.halfedgeFace(hemesh.halfedgeOpposite(*fc));
+				if(g.isValid() && selected[g.idx]) ++numSplit;
+				++fc;
+			} while(fc != fce);
+			if(numSplit < 2) return 0;
+			added[f.idx] = 1;
+			return 1;
+		}, [](int a, int b) { return a+b; });
+		if(numAdded == 0) break;
+		hemesh.parallelForFaces([&](ofxHEMeshFace f) {
+			if(added[f.idx]) selected[f.idx] = 1;
+		});
+	}
+}
+
+void ofxHEMeshRefinement::layout() {
+	newV = V + numSplitEdges;
+	newE = E + numSplitEdges + 3*numSplitFaces + numClosedFaces;
+	newF = F + 3*numSplitFaces + numClosedFaces;
+}
+
+void ofxHEMeshRefinement::childFaces(ofxHEMeshFace f, int& begin, int& count) const {
+	if(splitFaces->test(f.idx)) {
+		begin = F + 3*faceRank(f);
+		count = 3;
+	}
+	else if(closedFaces.test(f.idx)) {
+		begin = F + 3*numSplitFaces + closedFaces.rank(f.idx);
+		count = 1;
+	}
+	else {
+		begin = 0;
+		count = 0;
+	}
+}
+
+void ofxHEMeshRefinement::interiorHalfedges(ofxHEMeshFace f, int& begin, int& count) const {
+	if(splitFaces->test(f.idx)) {
+		begin = 2*(E + numSplitEdges + 3*faceRank(f));
+		count = 6;
+	}
+	else if(closedFaces.test(f.idx)) {
+		begin = 2*(E + numSplitEdges + 3*numSplitFaces + closedFaces.rank(f.idx));
+		count = 2;
+	}
+	else {
+		begin = 0;
+		count = 0;
+	}
+}
+
+ofxHEMeshRefinement::Point ofxHEMeshRefinement::edgePoint(ofxHEMeshHalfedge h) const {
+	return hemesh.halfedgeMidpoint(h);
+}
+
+ofxHEMeshRefinement::Point ofxHEMeshRefinement::vertexPoint(ofxHEMeshVertex v) const {
+	return hemesh.vertexPoint(v);
+}
+
+void ofxHEMeshRefinement::edgeStencil(ofxHEMeshHalfedge h, ofxHEMeshStencil& s) const {
+	s.add(hemesh.halfedgeSource(h), 0.5);
+	s.add(hemesh.halfedgeSink(h), 0.5);
+}
+
+void ofxHEMeshRefinement::vertexStencil(ofxHEMeshVertex v, ofxHEMeshStencil& s) const {
+	s.add(v, 1);
+}
+
+void ofxHEMeshRefinement::stencils(vector<ofxHEMeshStencil>& rows) const {
+	rows.resize(newV);
+	hemesh::parallelFor(0, newV, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			rows[i].clear();
+			// vertices in no face, including removed ones, stay where they are
+			if(i < V && !hemesh.vertexHalfedge(ofxHEMeshVertex(i)).isValid()) rows[i].add(i, 1);
+		}
+	});
+	hemesh.parallelForLive(hemesh.liveVertices, V, [&](int v) {
+		if(movesVertex(ofxHEMeshVertex(v))) vertexStencil(ofxHEMeshVertex(v), rows[v]);
+		else rows[v].add(v, 1);
+	}, 0);
+	hemesh.parallelForLive(*splitEdges, E, [&](int e) {
+		ofxHEMeshHalfedge h(2*e);
+		edgeStencil(h, rows[edgeVertex(h).idx]);
+	}, 0);
+}
+
+ofxHEMeshRefinement::Rule ofxHEMeshRefinement::rule(const map<string, Rule>& rules, const string& name) const {
+	map<string, Rule>::const_iterator it = rules.find(name);
+	return it == rules.end() ? defaultRule : it->second;
+}
+
+bool ofxHEMeshRefinement::movesVertex(ofxHEMeshVertex v) const {
+	if(!selector) return true;
+	ofxHEMeshHalfedge h = hemesh.vertexHalfedge(v);
+	if(!h.isValid()) return false;
+	ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+	ofxHEMeshVertexCirculator vce = vc;
+	do {
+		ofxHEMeshFace f = hemesh.halfedgeFace(*vc);
+		if(f.isValid() && splitFaces->test(f.idx)) return true;
+		++vc;
+	} while(vc != vce);
+	return false;
+}
+
+void ofxHEMeshRefinement::refine() {
+	V = hemesh.getNumVertices();
+	E = hemesh.getNumEdges();
+	F = hemesh.getNumFaces();
+	hemesh.prepareLiveIndices();
+	select();
+	layout();
+	if(stencilRows) stencils(*stencilRows);
+
+	// Smoothed positions of the existing vertices, read from the unrefined mesh
+	vector<ofxHEMeshVertex> movedVertices;
+	vector<Point> movedPoints;
+	if(movesVertices) {
+		movedVertices.resize(hemesh.getNumLiveVertices());
+		movedPoints.resize(hemesh.getNumLiveVertices());
+		hemesh.parallelForVertices([&](ofxHEMeshVertex v) {
+			int i = hemesh.vertexLiveIndex(v);
+			if(movesVertex(v)) {
+				movedVertices[i] = v;
+				movedPoints[i] = vertexPoint(v);
+			}
+		});
+		if(selector) {
+			// drop the vertices left invalid
+			int n = 0;
+			for(int i=0; i < movedVertices.size(); ++i) {
+				if(!movedVertices[i].isValid()) continue;
+				movedVertices[n] = movedVertices[i];
+				movedPoints[n] = movedPoints[i];
+				++n;
+			}
+			movedVertices.resize(n);
+			movedPoints.resize(n);
+		}
+	}
+
+	// One allocation per property
+	hemesh.vertexProperties.resize(newV);
+	hemesh.halfedgeProperties.resize(2*newE);
+	hemesh.faceProperties.resize(newF);
+
+	ofxHEMeshProperty<ofxHEMeshVertexAdjacency>& vadj = *hemesh.vertexAdjacency;
+	ofxHEMeshProperty<ofxHEMeshHalfedgeAdjacency>& hadj = *hemesh.halfedgeAdjacency;
+	ofxHEMeshProperty<ofxHEMeshFaceAdjacency>& fadj = *hemesh.faceAdjacency;
+	ofxHEMeshProperty<Point>& points = *hemesh.points;
+	vadj.unshare(0, newV);
+	hadj.unshare(0, 2*newE);
+	fadj.unshare(0, newF);
+	points.unshare(V, newV);
+
+	// Edge vertex positions, before any adjacency is rewritten
+	hemesh.parallelForLive(*splitEdges, E, [&](int e) {
+		ofxHEMeshHalfedge h(2*e);
+		points.get(edgeVertex(h).idx) = edgePoint(h);
+	}, 0);
+
+	// The halves of every split edge.  Only boundary halfedges are linked here,
+	// the ones in faces are linked with their face.
+	hemesh.parallelForLive(*splitEdges, E, [&](int e) {
+		ofxHEMeshHalfedge h(2*e);
+		ofxHEMeshVertex m = edgeVertex(h);
+		vadj.get(m.idx).he = firstHalf(h);
+		for(int j=0; j < 2; ++j) {
+			ofxHEMeshHalfedge hj(2*e + j);
+			ofxHEMeshHalfedgeAdjacency adj = hadj.get(hj.idx);
+			ofxHEMeshHalfedge first = firstHalf(hj);
+			ofxHEMeshHalfedge second = secondHalf(hj);
+			hadj.get(first.idx).v = m;
+			hadj.get(second.idx).v = adj.v;
+			if(!adj.f.isValid()) {
+				hadj.get(first.idx).f = ofxHEMeshFace();
+				hadj.get(second.idx).f = ofxHEMeshFace();
+				hadj.get(first.idx).next = second;
+				hadj.get(second.idx).prev = first;
+				hadj.get(second.idx).next = firstHalf(adj.next);
+				hadj.get(first.idx).prev = secondHalf(adj.prev);
+				// unsplit neighbours along the boundary aren't visited
+				if(!edgeIsSplit(adj.next)) hadj.get(adj.next.idx).prev = second;
+				if(!edgeIsSplit(adj.prev)) hadj.get(adj.prev.idx).next = first;
+			}
+		}
+	}, 0);
+
+	// Existing vertices keep the half of their incoming halfedge that still ends at them
+	hemesh.parallelForLive(hemesh.liveVertices, V, [&](int v) {
+		ofxHEMeshHalfedge h = vadj.get(v).he;
+		vadj.get(v).he = secondHalf(h);
+	}, 0);
+
+	hemesh.parallelForLive(*splitFaces, F, [&](int f) {
+		splitFace(ofxHEMeshFace(f));
+	}, 0);
+	hemesh.parallelForLive(closedFaces, F, [&](int f) {
+		closeFace(ofxHEMeshFace(f));
+	}, 0);
+
+	// Adjacency was written directly so bring the live sets up to date
+	hemesh.liveVertices.rebuild(V, newV, [](int i) { return true; });
+	hemesh.liveEdges.rebuild(E, newE, [](int i) { return true; });
+	hemesh.liveFaces.rebuild(F, newF, [](int i) { return true; });
+	hemesh.changes.markAll();
+	hemesh.topologyDirty = true;
+	hemesh.geometryDirty = true;
+	hemesh.vertexWasAdded(ofxHEMeshVertex(V), newV-V);
+
+	if(movesVertices) {
+		hemesh.moveVertices(movedVertices, movedPoints);
+	}
+
+	refineProperties();
+}
+
+// Corner faces and the center face, which keeps the parent's index
+void ofxHEMeshRefinement::splitFace(ofxHEMeshFace f) {
+	ofxHEMeshProperty<ofxHEMeshHalfedgeAdjacency>& hadj = *hemesh.halfedgeAdjacency;
+	ofxHEMeshProperty<ofxHEMeshFaceAdjacency>& fadj = *hemesh.faceAdjacency;
+	int interiorStart = E + numSplitEdges;
+	int r = faceRank(f);
+	ofxHEMeshHalfedge hs[3];
+	hs[0] = fadj.get(f.idx).he;
+	hs[1] = hadj.get(hs[0].idx).next;
+	hs[2] = hadj.get(hs[1].idx).next;
+	for(int k=0; k < 3; ++k) {
+		ofxHEMeshHalfedge h = hs[k];
+		ofxHEMeshHalfedge hn = hs[(k+1)%3];
+		ofxHEMeshFace corner(F + 3*r + k);
+		ofxHEMeshHalfedge a = secondHalf(h);
+		ofxHEMeshHalfedge b = firstHalf(hn);
+		// runs from the next edge's vertex to this one's, its opposite is in the center
+		ofxHEMeshHalfedge c(2*(interiorStart + 3*r + k));
+		ofxHEMeshHalfedge co(c.idx+1);
+		ofxHEMeshHalfedge cn(2*(interiorStart + 3*r + (k+1)%3) + 1);
+
+		hadj.get(a.idx).next = b;
+		hadj.get(b.idx).next = c;
+		hadj.get(c.idx).next = a;
+		hadj.get(a.idx).prev = c;
+		hadj.get(b.idx).prev = a;
+		hadj.get(c.idx).prev = b;
+		hadj.get(a.idx).f = corner;
+		hadj.get(b.idx).f = corner;
+		hadj.get(c.idx).f = corner;
+		hadj.get(c.idx).v = edgeVertex(h);
+		fadj.get(corner.idx).he = a;
+
+		hadj.get(co.idx).v = edgeVertex(hn);
+		hadj.get(co.idx).f = f;
+		hadj.get(co.idx).next = cn;
+		hadj.get(cn.idx).prev = co;
+	}
+	fadj.get(f.idx).he = ofxHEMeshHalfedge(2*interiorStart + 6*r + 1);
+}
+
+// A triangle with one split edge, halved by an edge from the edge vertex to the
+// opposite corner.  The half at the split edge's sink keeps the index.
+void ofxHEMeshRefinement::closeFace(ofxHEMeshFace f) {
+	ofxHEMeshProperty<ofxHEMeshHalfedgeAdjacency>& hadj = *hemesh.halfedgeAdjacency;
+	ofxHEMeshProperty<ofxHEMeshFaceAdjacency>& fadj = *hemesh.faceAdjacency;
+	int r = closedFaces.rank(f.idx);
+	ofxHEMeshHalfedge h = fadj.get(f.idx).he;
+	while(!edgeIsSplit(h)) {
+		h = hadj.get(h.idx).next;
+	}
+	ofxHEMeshHalfedge hn = hadj.get(h.idx).next;
+	ofxHEMeshHalfedge hp = hadj.get(hn.idx).next;
+	ofxHEMeshFace half(F + 3*numSplitFaces + r);
+	ofxHEMeshHalfedge a = firstHalf(h);
+	ofxHEMeshHalfedge b = secondHalf(h);
+	// runs from the edge vertex to the opposite corner
+	ofxHEMeshHalfedge c(2*(E + numSplitEdges + 3*numSplitFaces + r));
+	ofxHEMeshHalfedge co(c.idx+1);
+
+	hadj.get(b.idx).next = hn;
+	hadj.get(hn.idx).next = co;
+	hadj.get(co.idx).next = b;
+	hadj.get(b.idx).prev = co;
+	hadj.get(hn.idx).prev = b;
+	hadj.get(co.idx).prev = hn;
+	hadj.get(b.idx).f = f;
+	hadj.get(co.idx).f = f;
+	hadj.get(co.idx).v = edgeVertex(h);
+	fadj.get(f.idx).he = b;
+
+	hadj.get(a.idx).next = c;
+	hadj.get(c.idx).next = hp;
+	hadj.get(hp.idx).next = a;
+	hadj.get(a.idx).prev = hp;
+	hadj.get(c.idx).prev = a;
+	hadj.get(hp.idx).prev = c;
+	hadj.get(a.idx).f = half;
+	hadj.get(c.idx).f = half;
+	hadj.get(hp.idx).f = half;
+	hadj.get(c.idx).v = hadj.get(hn.idx).v;
+	fadj.get(half.idx).he = a;
+}
+
+// Carry the user's halfedge and face properties over to the children
+void ofxHEMeshRefinement::refineProperties() {
+	ofxHEMeshPropertySet& halfedgeProperties = hemesh.halfedgeProperties;
+	for(int i=0; i < halfedgeProperties.getNumProperties(); ++i) {
+		ofxHEMeshPropertyBase *prop = halfedgeProperties.getProperty(i);
+		if(!prop || prop == hemesh.halfedgeAdjacency || ownsProperty(*prop)) continue;
+		Rule r = rule(halfedgeRules, prop->getName());
+		// the new edges all come after E so the old ranks still hold
+		for(int e=splitEdges->next(0, E); e < E; e=splitEdges->next(e+1, E)) {
+			for(int j=0; j < 2; ++j) {
+				ofxHEMeshHalfedge h(2*e + j);
+				ofxHEMeshHalfedge added = (j == 0) ? secondHalf(h) : firstHalf(h);
+				if(r == InheritRule) {
+					prop->copyItem(h.idx, added.idx);
+				}
+				else if(r == ResetRule) {
+					prop->resetItem(h.idx);
+				}
+				else {
+					interpolateHalfedge(*prop, added, h);
+					interpolateHalfedge(*prop, h, h);
+				}
+			}
+		}
+		if(r == CustomRule) {
+			for(int fi=hemesh.liveFaces.next(0, F); fi < F; fi=hemesh.liveFaces.next(fi+1, F)) {
+				int begin, count;
+				interiorHalfedges(ofxHEMeshFace(fi), begin, count);
+				for(int k=0; k < count; ++k) {
+					interpolateHalfedge(*prop, ofxHEMeshHalfedge(begin+k), ofxHEMeshHalfedge());
+				}
+			}
+		}
+	}
+
+	ofxHEMeshPropertySet& faceProperties = hemesh.faceProperties;
+	for(int i=0; i < faceProperties.getNumProperties(); ++i) {
+		ofxHEMeshPropertyBase *prop = faceProperties.getProperty(i);
+		if(!prop || prop == hemesh.faceAdjacency || ownsProperty(*prop)) continue;
+		Rule r = rule(faceRules, prop->getName());
+		for(int fi=hemesh.liveFaces.next(0, F); fi < F; fi=hemesh.liveFaces.next(fi+1, F)) {
+			int begin, count;
+			childFaces(ofxHEMeshFace(fi), begin, count);
+			if(count == 0) continue;
+			for(int k=0; k < count; ++k) {
+				if(r == InheritRule) prop->copyItem(fi, begin+k);
+				else if(r == CustomRule) interpolateFace(*prop, ofxHEMeshFace(begin+k), ofxHEMeshFace(fi));
+			}
+			if(r == ResetRule) prop->resetItem(fi);
+			else if(r == CustomRule) interpolateFace(*prop, ofxHEMeshFace(fi), ofxHEMeshFace(fi));
+		}
+	}
+}
+
+
+ofxHEMeshLoopRefinement::ofxHEMeshLoopRefinement(ofxHEMesh& hemesh)
+:	ofxHEMeshRefinement(hemesh)
+{
+	movesVertices = true;
+}
+
+ofxHEMeshRefinement::Point ofxHEMeshLoopRefinement::edgePoint(ofxHEMeshHalfedge h) const {
+	ofxHEMeshHalfedge ho = hemesh.halfedgeOpposite(h);
+	if(hemesh.halfedgeIsOnBoundary(h) || hemesh.halfedgeIsOnBoundary(ho)) {
+		return hemesh.halfedgeMidpoint(h);
+	}
+	ofxHEMeshHalfedge hn = hemesh.halfedgeNext(h);
+	ofxHEMeshHalfedge hon = hemesh.halfedgeNext(ho);
+	return
+		(hemesh.vertexPoint(hemesh.halfedgeSource(h)) + hemesh.vertexPoint(hemesh.halfedgeSink(h)))*0.375 +
+		(hemesh.vertexPoint(hemesh.halfedgeSink(hn)) + hemesh.vertexPoint(hemesh.halfedgeSink(hon)))*0.125;
+}
+
+ofxHEMeshRefinement::Point ofxHEMeshLoopRefinement::vertexPoint(ofxHEMeshVertex v) const {
+	ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+	ofxHEMeshVertexCirculator vce = vc;
+	int valence = hemesh.vertexValence(v);
+	ofxHEMesh::Scalar beta;
+	if(valence == 3) {
+		beta = 3./16.;
+	}
+	else {
+		beta = 3./(8.*valence);
+	}
+
+	Point nPt = hemesh.vertexPoint(v)*(1.-valence*beta);
+	do {
+		if(hemesh.halfedgeIsOnBoundary(*vc)) {
+			ofxHEMeshHalfedge h1 = *vc;
+			ofxHEMeshHalfedge h2 = hemesh.halfedgeSinkCW(h1);
+			return
+				3./4.*hemesh.vertexPoint(v) +
+				1./8.*(hemesh.vertexPoint(hemesh.halfedgeSource(h1)) + hemesh.vertexPoint(hemesh.halfedgeSource(h2)));
+		}
+		nPt += hemesh.vertexPoint(hemesh.halfedgeSource(*vc))*beta;
+		++vc;
+	} while(vc != vce);
+	return nPt;
+}
+
+
+void ofxHEMeshLoopRefinement::edgeStencil(ofxHEMeshHalfedge h, ofxHEMeshStencil& s) const {
+	ofxHEMeshHalfedge ho = hemesh.halfedgeOpposite(h);
+	if(hemesh.halfedgeIsOnBoundary(h) || hemesh.halfedgeIsOnBoundary(ho)) {
+		ofxHEMeshRefinement::edgeStencil(h, s);
+		return;
+	}
+	s.add(hemesh.halfedgeSource(h), 0.375);
+	s.add(hemesh.halfedgeSink(h), 0.375);
+	s.add(hemesh.halfedgeSink(hemesh.halfedgeNext(h)), 0.125);
+	s.add(hemesh.halfedgeSink(hemesh.halfedgeNext(ho)), 0.125);
+}
+
+void ofxHEMeshLoopRefinement::vertexStencil(ofxHEMeshVertex v, ofxHEMeshStencil& s) const {
+	ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+	ofxHEMeshVertexCirculator vce = vc;
+	int valence = hemesh.vertexValence(v);
+	ofxHEMesh::Scalar beta = (valence == 3) ? 3./16. : 3./(8.*valence);
+	do {
+		if(hemesh.halfedgeIsOnBoundary(*vc)) {
+			ofxHEMeshHalfedge h1 = *vc;
+			ofxHEMeshHalfedge h2 = hemesh.halfedgeSinkCW(h1);
+			s.clear();
+			s.add(v, 0.75);
+			s.add(hemesh.halfedgeSource(h1), 0.125);
+			s.add(hemesh.halfedgeSource(h2), 0.125);
+			return;
+		}
+		s.add(hemesh.halfedgeSource(*vc), beta);
+		++vc;
+	} while(vc != vce);
+	s.add(v, 1.-valence*beta);
+}
+
+ofxHEMeshCatmullClarkRefinement::ofxHEMeshCatmullClarkRefinement(ofxHEMesh& hemesh)
+:	ofxHEMeshRefinement(hemesh),
+	sharpnessName("sharpness")
+{
+	movesVertices = true;
+}
+
+void ofxHEMeshCatmullClarkRefinement::layout() {
+	sharpness = hemesh.getHalfedgePropertyHandle<Scalar>(sharpnessName);
+
+	// Face points of every face, since unsplit faces still shape the edge and
+	// vertex points next to them, and sizes by rank, then the sizes become offsets
+	facePoints.resize(hemesh.getNumLiveFaces());
+	faceOffsets.resize(numSplitFaces+1);
+	hemesh.parallelForFaces([&](ofxHEMeshFace f) {
+		facePoints[hemesh.faceLiveIndex(f)] = hemesh.faceCentroid(f);
+		if(splitFaces->test(f.idx)) faceOffsets[faceRank(f)] = hemesh.faceSize(f);
+	});
+	int offset = 0;
+	for(int r=0; r < numSplitFaces; ++r) {
+		int n = faceOffsets[r];
+		faceOffsets[r] = offset;
+		offset += n;
+	}
+	faceOffsets[numSplitFaces] = offset;
+
+	newV = V + numSplitEdges + numSplitFaces;
+	newE = E + numSplitEdges + offset;
+	newF = F + offset - numSplitFaces;
+}
+
+void ofxHEMeshCatmullClarkRefinement::childFaces(ofxHEMeshFace f, int& begin, int& count) const {
+	if(!splitFaces->test(f.idx)) {
+		begin = 0;
+		count = 0;
+		return;
+	}
+	int r = faceRank(f);
+	begin = F + faceOffsets[r] - r;
+	count = faceOffsets[r+1] - faceOffsets[r] - 1;
+}
+
+void ofxHEMeshCatmullClarkRefinement::interiorHalfedges(ofxHEMeshFace f, int& begin, int& count) const {
+	if(!splitFaces->test(f.idx)) {
+		begin = 0;
+		count = 0;
+		return;
+	}
+	int r = faceRank(f);
+	begin = 2*(E + numSplitEdges + faceOffsets[r]);
+	count = 2*(faceOffsets[r+1] - faceOffsets[r]);
+}
+
+// Quad k sits at the sink of the face's k-th halfedge.  Interior edge k runs
+// from the k-th halfedge's edge vertex to the face vertex.
+void ofxHEMeshCatmullClarkRefinement::splitFace(ofxHEMeshFace f) {
+	ofxHEMeshProperty<ofxHEMeshVertexAdjacency>& vadj = *hemesh.vertexAdjacency;
+	ofxHEMeshProperty<ofxHEMeshHalfedgeAdjacency>& hadj = *hemesh.halfedgeAdjacency;
+	ofxHEMeshProperty<ofxHEMeshFaceAdjacency>& fadj = *hemesh.faceAdjacency;
+	int r = faceRank(f);
+	int n = faceOffsets[r+1] - faceOffsets[r];
+	int interiorStart = E + numSplitEdges + faceOffsets[r];
+	int quadStart = F + faceOffsets[r] - r - 1;
+	ofxHEMeshVertex center(V + numSplitEdges + r);
+
+	// Gather the face before its halfedges are relinked
+	ofxHEMeshHalfedge local[8];
+	vector<ofxHEMeshHalfedge> heap;
+	ofxHEMeshHalfedge *hs = local;
+	if(n > 8) {
+		heap.resize(n);
+		hs = &heap[0];
+	}
+	hs[0] = fadj.get(f.idx).he;
+	for(int k=1; k < n; ++k) {
+		hs[k] = hadj.get(hs[k-1].idx).next;
+	}
+
+	for(int k=0; k < n; ++k) {
+		int kn = (k+1)%n;
+		ofxHEMeshFace quad = (k == 0) ? f : ofxHEMeshFace(quadStart + k);
+		ofxHEMeshHalfedge a = secondHalf(hs[k]);
+		ofxHEMeshHalfedge b = firstHalf(hs[kn]);
+		ofxHEMeshHalfedge c(2*(interiorStart + kn));
+		ofxHEMeshHalfedge d(2*(interiorStart + k) + 1);
+
+		hadj.get(a.idx).next = b;
+		hadj.get(b.idx).next = c;
+		hadj.get(c.idx).next = d;
+		hadj.get(d.idx).next = a;
+		hadj.get(a.idx).prev = d;
+		hadj.get(b.idx).prev = a;
+		hadj.get(c.idx).prev = b;
+		hadj.get(d.idx).prev = c;
+		hadj.get(a.idx).f = quad;
+		hadj.get(b.idx).f = quad;
+		hadj.get(c.idx).f = quad;
+		hadj.get(d.idx).f = quad;
+		hadj.get(c.idx).v = center;
+		hadj.get(d.idx).v = edgeVertex(hs[k]);
+		fadj.get(quad.idx).he = a;
+	}
+	vadj.get(center.idx).he = ofxHEMeshHalfedge(2*interiorStart);
+	hemesh.points->get(center.idx) = facePoint(f);
+}
+
+// The split edges' vertices become corners of the face
+void ofxHEMeshCatmullClarkRefinement::closeFace(ofxHEMeshFace f) {
+	ofxHEMeshProperty<ofxHEMeshHalfedgeAdjacency>& hadj = *hemesh.halfedgeAdjacency;
+	ofxHEMeshProperty<ofxHEMeshFaceAdjacency>& fadj = *hemesh.faceAdjacency;
+	ofxHEMeshHalfedge start = fadj.get(f.idx).he;
+	ofxHEMeshHalfedge h = start;
+	do {
+		ofxHEMeshHalfedge hn = hadj.get(h.idx).next;
+		ofxHEMeshHalfedge a = firstHalf(h);
+		ofxHEMeshHalfedge b = secondHalf(h);
+		if(a != b) {
+			hadj.get(a.idx).next = b;
+			hadj.get(b.idx).prev = a;
+			hadj.get(a.idx).f = f;
+			hadj.get(b.idx).f = f;
+		}
+		hadj.get(b.idx).next = firstHalf(hn);
+		hadj.get(firstHalf(hn).idx).prev = b;
+		h = hn;
+	} while(h != start);
+	fadj.get(f.idx).he = firstHalf(start);
+}
+
+ofxHEMeshCatmullClarkRefinement::Scalar ofxHEMeshCatmullClarkRefinement::edgeSharpness(ofxHEMeshHalfedge h) const {
+	ofxHEMeshHalfedge ho = hemesh.halfedgeOpposite(h);
+	if(hemesh.halfedgeIsOnBoundary(h) || hemesh.halfedgeIsOnBoundary(ho)) {
+		return std::numeric_limits<Scalar>::infinity();
+	}
+	if(!sharpness.isValid()) return 0;
+	const ofxHEMeshProperty<Scalar>& prop = hemesh.halfedgeProperty(sharpness);
+	return std::max(prop.get(h.idx), prop.get(ho.idx));
+}
+
+ofxHEMeshRefinement::Point ofxHEMeshCatmullClarkRefinement::edgePoint(ofxHEMeshHalfedge h) const {
+	Point mid = hemesh.halfedgeMidpoint(h);
+	Scalar s = edgeSharpness(h);
+	if(s >= 1) return mid;
+
+	ofxHEMeshHalfedge ho = hemesh.halfedgeOpposite(h);
+	Point smooth = (
+		hemesh.vertexPoint(hemesh.halfedgeSink(h)) + hemesh.vertexPoint(hemesh.halfedgeSink(ho)) +
+		facePoint(hemesh.halfedgeFace(h)) + facePoint(hemesh.halfedgeFace(ho))
+	)*0.25;
+	if(s <= 0) return smooth;
+	return smooth*(1-s) + mid*s;
+}
+
+ofxHEMeshRefinement::Point ofxHEMeshCatmullClarkRefinement::vertexPoint(ofxHEMeshVertex v) const {
+	Point P = hemesh.vertexPoint(v);
+	if(!hemesh.vertexHalfedge(v).isValid()) return P;
+
+	// Q: average face point, R: average edge midpoint, plus the sharp edges' far ends
+	Point Q(0, 0, 0);
+	Point R(0, 0, 0);
+	Point sharpEnds(0, 0, 0);
+	int valence = 0;
+	int numFaces = 0;
+	int numSharp = 0;
+	Scalar sharpSum = 0;
+	ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+	ofxHEMeshVertexCirculator vce = vc;
+	do {
+		ofxHEMeshHalfedge h = *vc;
+		Point end = hemesh.vertexPoint(hemesh.halfedgeSource(h));
+		R += end;
+		++valence;
+		ofxHEMeshFace f = hemesh.halfedgeFace(h);
+		if(f.isValid()) {
+			Q += facePoint(f);
+			++numFaces;
+		}
+		Scalar s = edgeSharpness(h);
+		if(s > 0) {
+			sharpEnds += end;
+			sharpSum += s;
+			++numSharp;
+		}
+		++vc;
+	} while(vc != vce);
+
+	// Two sharp edges make a crease, more a corner.  Fewer is a dart, which
+	// stays smooth.
+	Point sharp = (numSharp == 2) ? P*0.75 + sharpEnds*0.125 : P;
+	Scalar t = (numSharp < 2) ? 0 : sharpSum/numSharp;
+	if(t >= 1 || numFaces == 0) return sharp;
+
+	Scalar n = valence;
+	Q = Q*(1/Scalar(numFaces));
+	R = (R*(1/n) + P)*0.5;
+	Point smooth = (Q + R*2 + P*(n-3))*(1/n);
+	if(t <= 0) return smooth;
+	return smooth*(1-t) + sharp*t;
+}
+
+void ofxHEMeshCatmullClarkRefinement::faceStencil(ofxHEMeshFace f, ofxHEMeshStencil& s, Scalar w) const {
+	ofxHEMeshFaceCirculator fc = hemesh.faceCirculate(f);
+	ofxHEMeshFaceCirculator fce = fc;
+	w /= hemesh.faceSize(f);
+	do {
+		s.add(hemesh.halfedgeVertex(*fc), w);
+		++fc;
+	} while(fc != fce);
+}
+
+void ofxHEMeshCatmullClarkRefinement::edgeStencil(ofxHEMeshHalfedge h, ofxHEMeshStencil& s) const {
+	Scalar t = std::max(Scalar(0), edgeSharpness(h));
+	if(t >= 1) {
+		ofxHEMeshRefinement::edgeStencil(h, s);
+		return;
+	}
+	ofxHEMeshHalfedge ho = hemesh.halfedgeOpposite(h);
+	Scalar ws = 1-t;
+	s.add(hemesh.halfedgeSink(h), 0.25*ws + 0.5*t);
+	s.add(hemesh.halfedgeSink(ho), 0.25*ws + 0.5*t);
+	faceStencil(hemesh.halfedgeFace(h), s, 0.25*ws);
+	faceStencil(hemesh.halfedgeFace(ho), s, 0.25*ws);
+}
+
+// Expanded form of vertexPoint()
+void ofxHEMeshCatmullClarkRefinement::vertexStencil(ofxHEMeshVertex v, ofxHEMeshStencil& s) const {
+	if(!hemesh.vertexHalfedge(v).isValid()) {
+		s.add(v, 1);
+		return;
+	}
+
+	int valence = 0;
+	int numFaces = 0;
+	int numSharp = 0;
+	Scalar sharpSum = 0;
+	ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(v);
+	ofxHEMeshVertexCirculator vce = vc;
+	do {
+		++valence;
+		if(hemesh.halfedgeFace(*vc).isValid()) ++numFaces;
+		Scalar sh = edgeSharpness(*vc);
+		if(sh > 0) {
+			sharpSum += sh;
+			++numSharp;
+		}
+		++vc;
+	} while(vc != vce);
+
+	Scalar t = (numSharp < 2) ? 0 : sharpSum/numSharp;
+	if(t >= 1 || numFaces == 0) t = 1;
+	if(t > 0) {
+		if(numSharp == 2) {
+			s.add(v, 0.75*t);
+			do {
+				if(edgeSharpness(*vc) > 0) s.add(hemesh.halfedgeSource(*vc), 0.125*t);
+				++vc;
+			} while(vc != vce);
+		}
+		else {
+			s.add(v, t);
+		}
+	}
+	if(t >= 1) return;
+
+	// (Q + 2R + (n-3)P)/n with Q the average face point and R the average edge midpoint
+	Scalar ws = 1-t;
+	Scalar n = valence;
+	s.add(v, ws*(n-2)/n);
+	do {
+		s.add(hemesh.halfedgeSource(*vc), ws/(n*n));
+		ofxHEMeshFace f = hemesh.halfedgeFace(*vc);
+		if(f.isValid()) faceStencil(f, s, ws/(n*numFaces));
+		++vc;
+	} while(vc != vce);
+}
+
+void ofxHEMeshCatmullClarkRefinement::stencils(vector<ofxHEMeshStencil>& rows) const {
+	ofxHEMeshRefinement::stencils(rows);
+	hemesh.parallelForLive(*splitFaces, F, [&](int f) {
+		faceStencil(ofxHEMeshFace(f), rows[V + numSplitEdges + faceRank(ofxHEMeshFace(f))], 1);
+	}, 0);
+}
+
+bool ofxHEMeshCatmullClarkRefinement::ownsProperty(const ofxHEMeshPropertyBase& prop) const {
+	return sharpness.isValid() && &prop == &hemesh.halfedgeProperty(sharpness);
+}
+
+void ofxHEMeshCatmullClarkRefinement::refineProperties() {
+	ofxHEMeshRefinement::refineProperties();
+	if(!sharpness.isValid()) return;
+
+	// Split edges get one less on both halves, the edges inside faces are smooth
+	ofxHEMeshProperty<Scalar>& prop = hemesh.halfedgeProperty(sharpness);
+	prop.unshare(0, 2*newE);
+	hemesh.parallelForLive(*splitEdges, E, [&](int e) {
+		ofxHEMeshHalfedge h(2*e);
+		Scalar s = std::max(Scalar(0), std::max(prop.get(h.idx), prop.get(h.idx+1)) - 1);
+		prop.get(h.idx) = s;
+		prop.get(h.idx+1) = s;
+		prop.get(secondHalf(h).idx) = s;
+		prop.get(firstHalf(ofxHEMeshHalfedge(h.idx+1)).idx) = s;
+	}, 0);
+	hemesh::parallelFor(2*(E + numSplitEdges), 2*newE, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			prop.get(i) = 0;
+		}
+	});
+}
@@ -0,0 +1,237 @@
+#pragma once
+#include "ofxHEMesh.h"
+#include "ofxHEMeshStencilTable.h"
+#include <functional>
+
+/*
+1-to-4 refinement of a triangle mesh written in place.  Every edge gets a new
+vertex and every face is split into a center face, which keeps the parent's
+index, and three corner faces.  All new indices are computed up front from the
+ranks of the split edges and faces, so with V vertex, E edge and F face slots
+(Ve, Fe of them split):
+
+	new vertex of edge e               V + rank(e)
+	second half of edge e              edge E + rank(e)
+	interior edges of face f           edges E + Ve + 3*rank(f) + (0, 1, 2)
+	corner faces of face f             faces F + 3*rank(f) + (0, 1, 2)
+
+Without a face selector every live edge and face is split.  With one only the
+selected faces are, together with their edges, and the faces next to them are
+closed so no vertex is left in the middle of an edge (no T-junctions).  Here a
+face with two or three split edges is split as well, repeating until none is
+left, and a face with one is halved by an edge to the new vertex (red-green
+refinement).  With Fg halved faces, ranked among themselves:
+
+	halving edge of face g             edge E + Ve + 3*Fe + rank(g)
+	other half of face g               face F + 3*Fe + rank(g)
+
+Only vertices with a split face around them are moved, so flat or distant
+regions stay coarse while the rest is refined level by level.
+
+Each property set is resized once per level and the adjacency is written
+directly, so a level runs in linear time.  Removed elements stay where they
+are, free lists are untouched.
+
+Halfedge and face properties besides the adjacency are carried over to the
+children by a Rule, chosen per property name.  Vertex properties of the new
+vertices get their default values.
+
+Subclasses can split faces differently by overriding layout(), splitFace() and
+the child queries; edges are always split in two as above.
+*/
+class ofxHEMeshRefinement {
+	friend class ofxHEMeshStencilTable;
+public:
+	typedef ofxHEMesh::Point Point;
+
+	enum Rule {
+		// Children get the property's default value
+		ResetRule,
+		// Children copy their parent's value, halfedges inside a face get the default
+		InheritRule,
+		// Children are set by interpolateHalfedge() and interpolateFace()
+		CustomRule
+	};
+
+	ofxHEMeshRefinement(ofxHEMesh& hemesh);
+	virtual ~ofxHEMeshRefinement();
+
+	// Rule for properties without one of their own, InheritRule by default
+	void setDefaultRule(Rule rule) { defaultRule = rule; }
+	void setHalfedgeRule(const string& name, Rule rule) { halfedgeRules[name] = rule; }
+	void setFaceRule(const string& name, Rule rule) { faceRules[name] = rule; }
+
+	// Adaptive refinement: only faces fn accepts are split, see above.  fn is
+	// called concurrently on each level's unrefined mesh, so it can look at
+	// curvature, screen size and so on as the mesh is refined.
+	void setFaceSelector(const std::function<bool (ofxHEMeshFace)>& fn) { selector = fn; }
+	// Split the faces whose bool face property of this name is set.  Children
+	// inherit it unless its rule says otherwise, so the same region is refined
+	// at each level.  Throws std::invalid_argument if there's no such property.
+	void setFaceSelector(const string& property);
+	// Split every face again
+	void clearFaceSelector() { selector = nullptr; }
+	bool isAdaptive() const { return bool(selector); }
+
+	// Throws std::invalid_argument if a face isn't a triangle
+	void apply(int levels=1);
+
+	// While set, each level fills rows with the stencils of its refined vertices
+	// over its unrefined ones, see ofxHEMeshStencilTable
+	void recordStencils(vector<ofxHEMeshStencil> *rows) { stencilRows = rows; }
+
+protected:
+	// Positions of the refined mesh, called concurrently on the unrefined mesh.
+	// The default splits edges at their midpoint and leaves vertices in place.
+	virtual Point edgePoint(ofxHEMeshHalfedge h) const;
+	virtual Point vertexPoint(ofxHEMeshVertex v) const;
+	// The same rules as weights on the unrefined vertices
+	virtual void edgeStencil(ofxHEMeshHalfedge h, ofxHEMeshStencil& s) const;
+	virtual void vertexStencil(ofxHEMeshVertex v, ofxHEMeshStencil& s) const;
+
+	// CustomRule interpolation, called on the refined mesh.  Children that keep
+	// their parent's index are visited after their siblings.  parent is invalid
+	// for the halfedges inside a face.
+	virtual void interpolateHalfedge(ofxHEMeshPropertyBase& prop, ofxHEMeshHalfedge child, ofxHEMeshHalfedge parent) {}
+	virtual void interpolateFace(ofxHEMeshPropertyBase& prop, ofxHEMeshFace child, ofxHEMeshFace parent) {}
+
+	// Throws std::invalid_argument if a face can't be split, the default
+	// accepts triangles
+	virtual void checkFaces() const;
+	// Sets newV, newE and newF, called on the unrefined mesh
+	virtual void layout();
+	// Adds to the selection the faces that have to be split to close it, flags
+	// are indexed by face slot.  The default does the red-green closure above.
+	virtual void closeSelection(vector<char>& selected) const;
+	// Splits face f once its edges are split, called concurrently
+	virtual void splitFace(ofxHEMeshFace f);
+	// Relinks unsplit face f around its split edges, called concurrently.  The
+	// default halves it.
+	virtual void closeFace(ofxHEMeshFace f);
+	// Faces added for face f and the halfedges inside it, in the unrefined
+	// mesh's numbering
+	virtual void childFaces(ofxHEMeshFace f, int& begin, int& count) const;
+	virtual void interiorHalfedges(ofxHEMeshFace f, int& begin, int& count) const;
+	// Fills rows[i] with the stencil of refined vertex i, called on the
+	// unrefined mesh after layout()
+	virtual void stencils(vector<ofxHEMeshStencil>& rows) const;
+	// Properties the scheme refines itself, the rules skip them
+	virtual bool ownsProperty(const ofxHEMeshPropertyBase& prop) const { return false; }
+
+	void refine();
+	// Sets the split and closed sets for the level, called on the unrefined mesh
+	void select();
+	virtual void refineProperties();
+	Rule rule(const map<string, Rule>& rules, const string& name) const;
+	// Whether vertex v is moved, i.e. it has a split face around it
+	bool movesVertex(ofxHEMeshVertex v) const;
+
+	// Halves of old halfedge h: source to edge vertex, edge vertex to sink.
+	// Both are h if its edge isn't split.
+	ofxHEMeshHalfedge firstHalf(ofxHEMeshHalfedge h) const {
+		if(!edgeIsSplit(h)) return h;
+		return (h.idx & 1) ? ofxHEMeshHalfedge(2*(E + edgeRank(h)) + 1) : h;
+	}
+	ofxHEMeshHalfedge secondHalf(ofxHEMeshHalfedge h) const {
+		if(!edgeIsSplit(h)) return h;
+		return (h.idx & 1) ? h : ofxHEMeshHalfedge(2*(E + edgeRank(h)));
+	}
+	bool edgeIsSplit(ofxHEMeshHalfedge h) const { return splitEdges->test(h.idx/2); }
+	int edgeRank(ofxHEMeshHalfedge h) const { return splitEdges->rank(h.idx/2); }
+	int faceRank(ofxHEMeshFace f) const { return splitFaces->rank(f.idx); }
+	ofxHEMeshVertex edgeVertex(ofxHEMeshHalfedge h) const { return ofxHEMeshVertex(V + edgeRank(h)); }
+
+	ofxHEMesh& hemesh;
+	bool movesVertices;
+	vector<ofxHEMeshStencil> *stencilRows;
+	Rule defaultRule;
+	map<string, Rule> halfedgeRules;
+	map<string, Rule> faceRules;
+	std::function<bool (ofxHEMeshFace)> selector;
+
+	// Edges and faces the level splits, the mesh's live sets unless there's a
+	// selector, and the unsplit faces with split edges
+	const ofxHEMeshLiveSet *splitEdges;
+	const ofxHEMeshLiveSet *splitFaces;
+	ofxHEMeshLiveSet selectedEdges;
+	ofxHEMeshLiveSet selectedFaces;
+	ofxHEMeshLiveSet closedFaces;
+
+	// Slot and split counts of the level being refined and the slot counts after it
+	int V, E, F;
+	int numSplitEdges, numSplitFaces, numClosedFaces;
+	int newV, newE, newF;
+};
+
+
+// Loop subdivision: edge vertices and smoothed vertices from Loop's masks, with
+// the boundary rules of the mesh's other subdivision schemes
+class ofxHEMeshLoopRefinement : public ofxHEMeshRefinement {
+public:
+	ofxHEMeshLoopRefinement(ofxHEMesh& hemesh);
+
+protected:
+	Point edgePoint(ofxHEMeshHalfedge h) const;
+	Point vertexPoint(ofxHEMeshVertex v) const;
+	void edgeStencil(ofxHEMeshHalfedge h, ofxHEMeshStencil& s) const;
+	void vertexStencil(ofxHEMeshVertex v, ofxHEMeshStencil& s) const;
+};
+
+
+/*
+Catmull-Clark subdivision of a polygon mesh.  A face with n sides becomes n
+quads around a new face vertex, the first of which keeps the face's index.
+With Ve, Fe split edges and faces and face f having O(f) sides among the split
+faces before it:
+
+	face vertex of face f              V + Ve + rank(f)
+	interior edges of face f           edges E + Ve + O(f) + (0 .. n-1)
+	quads of face f                    faces F + O(f) - rank(f) + (0 .. n-2)
+
+Boundary edges and vertices follow the boundary curve.  Creases come from the
+Scalar halfedge property named by setSharpnessProperty() ("sharpness" by
+default), an edge's sharpness being the larger of its halves'.  Edges with
+sharpness of 1 or more are split at their midpoint, fractional values blend the
+smooth and sharp rules, and the halves of a split edge get one less.
+
+With a face selector the unsplit faces next to split ones simply gain the new
+edge vertices as extra corners.  They're refined into quads like any other
+polygon when they're selected at a later level.
+*/
+class ofxHEMeshCatmullClarkRefinement : public ofxHEMeshRefinement {
+public:
+	typedef ofxHEMesh::Scalar Scalar;
+
+	ofxHEMeshCatmullClarkRefinement(ofxHEMesh& hemesh);
+
+	void setSharpnessProperty(const string& name) { sharpnessName = name; }
+
+protected:
+	void checkFaces() const {}
+	void layout();
+	void closeSelection(vector<char>& selected) const {}
+	void splitFace(ofxHEMeshFace f);
+	void closeFace(ofxHEMeshFace f);
+	void childFaces(ofxHEMeshFace f, int& begin, int& count) const;
+	void interiorHalfedges(ofxHEMeshFace f, int& begin, int& count) const;
+	bool ownsProperty(const ofxHEMeshPropertyBase& prop) const;
+	void refineProperties();
+
+	Point edgePoint(ofxHEMeshHalfedge h) const;
+	Point vertexPoint(ofxHEMeshVertex v) const;
+	void edgeStencil(ofxHEMeshHalfedge h, ofxHEMeshStencil& s) const;
+	void vertexStencil(ofxHEMeshVertex v, ofxHEMeshStencil& s) const;
+	void faceStencil(ofxHEMeshFace f, ofxHEMeshStencil& s, Scalar w) const;
+	void stencils(vector<ofxHEMeshStencil>& rows) const;
+
+	// Infinite for boundary edges
+	Scalar edgeSharpness(ofxHEMeshHalfedge h) const;
+	const Point& facePoint(ofxHEMeshFace f) const { return facePoints[hemesh.faceLiveIndex(f)]; }
+
+	string sharpnessName;
+	ofxHEMeshPropertyHandle<Scalar> sharpness;
+	// facePoints by live index, faceOffsets by split rank with an extra entry
+	// for the total
+	vector<Point> facePoints;
+	vector<int> faceOffsets;
+};
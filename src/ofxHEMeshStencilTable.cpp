@@ -0,0 +1,148 @@
+#include "ofxHEMeshStencilTable.h"
+#include "ofxHEMeshRefinement.h"
+#include "ofxHEMeshJournal.h"
+#include "ofxHEMeshParallel.h"
+#include <stdexcept>
+
+ofxHEMeshStencilTable::ofxHEMeshStencilTable()
+:	numControlVertices(0),
+	offsets(1, 0)
+{}
+
+void ofxHEMeshStencilTable::build(ofxHEMeshRefinement& refinement, int levels) {
+	ofxHEMesh& hemesh = refinement.hemesh;
+	numControlVertices = hemesh.getNumVertices();
+
+	// Stencils over the control vertices, composed with each level's stencils
+	// over the one before it
+	vector<ofxHEMeshStencil> rows(numControlVertices);
+	hemesh::parallelFor(0, numControlVertices, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			rows[i].add(i, 1);
+		}
+	});
+	vector<ofxHEMeshStencil> level;
+	vector<ofxHEMeshStencil> composed;
+	refinement.recordStencils(&level);
+	try {
+		for(int l=0; l < levels; ++l) {
+			refinement.apply();
+			composed.resize(level.size());
+			hemesh::parallelFor(0, int(level.size()), [&](int b, int e) {
+				for(int i=b; i < e; ++i) {
+					ofxHEMeshStencil& s = composed[i];
+					s.clear();
+					for(int j=0; j < level[i].size(); ++j) {
+						s.add(rows[level[i].indices[j]], level[i].weights[j]);
+					}
+				}
+			}, 256);
+			rows.swap(composed);
+		}
+	}
+	catch(...) {
+		refinement.recordStencils(0);
+		throw;
+	}
+	refinement.recordStencils(0);
+
+	int n = int(rows.size());
+	offsets.resize(n+1);
+	offsets[0] = 0;
+	for(int i=0; i < n; ++i) {
+		offsets[i+1] = offsets[i] + rows[i].size();
+	}
+	indices.resize(offsets[n]);
+	weights.resize(offsets[n]);
+	hemesh::parallelFor(0, n, [&](int b, int e) {
+		vector<std::pair<int, Scalar> > entries;
+		for(int i=b; i < e; ++i) {
+			const ofxHEMeshStencil& s = rows[i];
+			entries.resize(s.size());
+			for(int j=0; j < s.size(); ++j) {
+				entries[j] = std::pair<int, Scalar>(s.indices[j], s.weights[j]);
+			}
+			// neighbouring rows then read nearby control points
+			std::sort(entries.begin(), entries.end());
+			for(int j=0; j < s.size(); ++j) {
+				indices[offsets[i]+j] = entries[j].first;
+				weights[offsets[i]+j] = entries[j].second;
+			}
+		}
+	}, 1024);
+}
+
+void ofxHEMeshStencilTable::gatherControlPoints(const ofxHEMesh& cage, vector<ofxHEMeshVec4f>& control) const {
+	if(cage.getNumVertices() != numControlVertices) {
+		throw std::invalid_argument("cage doesn't match the stencil table");
+	}
+	control.resize(numControlVertices);
+	const ofxHEMeshProperty<Point>& points = *cage.points;
+	hemesh::parallelFor(0, numControlVertices, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			control[i] = ofxHEMeshVec4f(points.get(i));
+		}
+	});
+}
+
+ofxHEMeshStencilTable::Point ofxHEMeshStencilTable::evaluateStencil(const vector<ofxHEMeshVec4f>& control, int i) const {
+	ofxHEMeshVec4f p;
+	for(int j=offsets[i]; j < offsets[i+1]; ++j) {
+		p += control[indices[j]]*weights[j];
+	}
+	return p.toVec3f();
+}
+
+void ofxHEMeshStencilTable::evaluate(const ofxHEMesh& cage, Point *points) const {
+	vector<ofxHEMeshVec4f> control;
+	gatherControlPoints(cage, control);
+	hemesh::parallelFor(0, getNumStencils(), [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			if(offsets[i] < offsets[i+1]) points[i] = evaluateStencil(control, i);
+		}
+	});
+}
+
+void ofxHEMeshStencilTable::evaluate(const ofxHEMesh& cage, ofxHEMesh& refined) const {
+	// Points are written directly so it can't be replayed
+	ofxHEMeshJournal::Scope scope(refined, ofxHEMeshJournal::External);
+	int n = getNumStencils();
+	if(refined.getNumVertices() != n) {
+		throw std::invalid_argument("refined mesh doesn't match the stencil table");
+	}
+	if(n == 0) return;
+
+	// Listeners and transactions need the moves as a batch
+	if(refined.isChanging() || !refined.geometryListeners.empty()) {
+		vector<Point> points(n);
+		evaluate(cage, &points[0]);
+		vector<ofxHEMeshVertex> moved;
+		vector<Point> movedPoints;
+		moved.reserve(n);
+		movedPoints.reserve(n);
+		for(int i=0; i < n; ++i) {
+			if(offsets[i] < offsets[i+1]) {
+				moved.push_back(ofxHEMeshVertex(i));
+				movedPoints.push_back(points[i]);
+			}
+		}
+		refined.moveVertices(moved, movedPoints);
+		return;
+	}
+
+	vector<ofxHEMeshVec4f> control;
+	gatherControlPoints(cage, control);
+	ofxHEMeshProperty<Point>& points = *refined.points;
+	points.unshare(0, n);
+	hemesh::parallelFor(0, n, [&](int b, int e) {
+		for(int i=b; i < e; ++i) {
+			if(offsets[i] < offsets[i+1]) points.get(i) = evaluateStencil(control, i);
+		}
+	});
+	if(refined.changes.isTracking()) {
+		for(int i=0; i < n; ++i) {
+			if(offsets[i] < offsets[i+1]) refined.changes.markVertex(i);
+		}
+	}
+	refined.geometryDirty = true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "ofxHEMesh.h"
+
+class ofxHEMeshRefinement;
+
+// Sparse weighted sum of vertices.  Adding a vertex that's already in the
+// stencil adds to its weight.
+struct ofxHEMeshStencil {
+	typedef ofxHEMesh::Scalar Scalar;
+
+	void clear() {
+		indices.clear();
+		weights.clear();
+	}
+	int size() const { return int(indices.size()); }
+	bool empty() const { return indices.empty(); }
+
+	void add(int idx, Scalar w) {
+		for(int i=0; i < indices.size(); ++i) {
+			if(indices[i] == idx) {
+				weights[i] += w;
+				return;
+			}
+		}
+		indices.push_back(idx);
+		weights.push_back(w);
+	}
+	void add(ofxHEMeshVertex v, Scalar w) { add(v.idx, w); }
+	void add(const ofxHEMeshStencil& s, Scalar w) {
+		for(int i=0; i < s.size(); ++i) {
+			add(s.indices[i], s.weights[i]*w);
+		}
+	}
+
+	vector<int> indices;
+	vector<Scalar> weights;
+};
+
+
+/*
+Refined positions as fixed weighted sums of control vertices.  build() refines
+a mesh once and records, for every refined vertex, the weights the refinement's
+rules give the vertices of the mesh it started from.  When only the control
+points change (an animated cage) the refined points are a sparse
+matrix-vector product, evaluate(), and the refined connectivity is reused.
+
+	ofxHEMesh refined(cage);
+	ofxHEMeshCatmullClarkRefinement refinement(refined);
+	ofxHEMeshStencilTable table;
+	table.build(refinement, 3);
+	...
+	// each frame, after moving the cage's points
+	table.evaluate(cage, refined);
+
+Stencils are stored in compressed rows, sorted by control vertex.  evaluate()
+gathers the control points into padded 4-lane vectors and sums each row with
+one vector multiply-add per weight, rows are split across threads.
+*/
+class ofxHEMeshStencilTable {
+public:
+	typedef ofxHEMesh::Scalar Scalar;
+	typedef ofxHEMesh::Point Point;
+
+	ofxHEMeshStencilTable();
+
+	// Refine the refinement's mesh levels times.  Its vertex slots before
+	// refining are the control vertices.
+	void build(ofxHEMeshRefinement& refinement, int levels);
+
+	// Set the refined mesh's points from the cage's points.  Throws
+	// std::invalid_argument if either mesh doesn't match the table.
+	void evaluate(const ofxHEMesh& cage, ofxHEMesh& refined) const;
+	// Refined points into a buffer of getNumStencils() points.  Vertices in no
+	// face, which includes removed slots, take their control vertex's point.
+	void evaluate(const ofxHEMesh& cage, Point *points) const;
+
+	int getNumControlVertices() const { return numControlVertices; }
+	int getNumStencils() const { return int(offsets.size())-1; }
+
+	// Stencil i is the sum of weights[j] times control vertex indices[j] for j
+	// in [offsets[i], offsets[i+1])
+	const vector<int>& getOffsets() const { return offsets; }
+	const vector<int>& getIndices() const { return indices; }
+	const vector<Scalar>& getWeights() const { return weights; }
+
+protected:
+	void gatherControlPoints(const ofxHEMesh& cage, vector<ofxHEMeshVec4f>& control) const;
+	Point evaluateStencil(const vector<ofxHEMeshVec4f>& control, int i) const;
+
+	int numControlVertices;
+	vector<int> offsets;
+	vector<int> indices;
+	vector<Scalar> weights;
+};
@@ -3,7 +3,9 @@
 ofxHEMeshCornerCutSubdivision::ofxHEMeshCornerCutSubdivision(ofxHEMesh& hemesh)
 : hemesh(hemesh)
 {
-	faces.reserve(hemesh.getNumVertices()+hemesh.getNumEdges()+hemesh.getNumFaces());
+	faceOffsets.reserve(hemesh.getNumVertices()+hemesh.getNumEdges()+hemesh.getNumFaces()+1);
+	faceVertices.reserve(hemesh.getNumHalfedges()*3);
+	faceOffsets.push_back(0);
 }
 
 ofxHEMeshCornerCutSubdivision::~ofxHEMeshCornerCutSubdivision() {}
@@ -26,10 +28,6 @@ void ofxHEMeshCornerCutSubdivision::processFaces() {
 		hemesh.facePoints(*fit, points);
 		int k = points.size();
 		
-		// New indices for face
-		ofxHEMesh::ExplicitFace face;
-		face.reserve(k);
-		
 		cornerVertices.insert(std::pair<ofxHEMeshFace, VertexMap>(*fit, VertexMap()));
 		
 		vector<ofxHEMesh::Scalar> weights(k);
@@ -59,8 +57,8 @@ void ofxHEMeshCornerCutSubdivision::processFaces() {
 				ofxHEMeshVertex vn1(i);
 				i++;
 				ofxHEMeshVertex vn2(i);
-				face.push_back(vn1);
-				face.push_back(vn2);
+				faceVertices.push_back(vn1);
+				faceVertices.push_back(vn2);
 			}
 			else {
 				// move the existing vertex
@@ -83,7 +81,7 @@ void ofxHEMeshCornerCutSubdivision::processFaces() {
 				}
 				cornerPoints.push_back(pt);
 				newVertices.insert(std::pair<ofxHEMeshVertex, ofxHEMeshVertex>(v, vn));
-				face.push_back(vn);
+				faceVertices.push_back(vn);
 			}
 			
 			boundary = nextBoundary;
@@ -92,7 +90,7 @@ void ofxHEMeshCornerCutSubdivision::processFaces() {
 			++fc;
 		} while(fc != fce);
 		
-		faces.push_back(face);
+		faceOffsets.push_back(faceVertices.size());
 	}
 }
 	
@@ -101,15 +99,14 @@ void ofxHEMeshCornerCutSubdivision::createVertexFaces() {
 	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
 	for(; vit != vite; ++vit) {
 		if(boundaryVertices.find(*vit) == boundaryVertices.end()) {
-			ofxHEMesh::ExplicitFace face;
 			ofxHEMeshVertexCirculator vc = hemesh.vertexCirculate(*vit);
 			ofxHEMeshVertexCirculator vce = vc;
 			do {
 				ofxHEMeshFace f = hemesh.halfedgeFace(*vc);
-				face.push_back(cornerVertices[f][*vit]);
+				faceVertices.push_back(cornerVertices[f][*vit]);
 				++vc;
 			} while(vc != vce);
-			faces.push_back(face);
+			faceOffsets.push_back(faceVertices.size());
 		}
 	}
 }
@@ -118,7 +115,6 @@ void ofxHEMeshCornerCutSubdivision::createHalfedgeFaces() {
 	ofxHEMeshEdgeIterator eit = hemesh.edgesBegin();
 	ofxHEMeshEdgeIterator eite = hemesh.edgesEnd();
 	for(; eit != eite; ++eit) {
-		ofxHEMesh::ExplicitFace face(4);
 		ofxHEMeshHalfedge h = *eit;
 		ofxHEMeshHalfedge ho = hemesh.halfedgeOpposite(h);
 		if(!(hemesh.halfedgeIsOnBoundary(h) || hemesh.halfedgeIsOnBoundary(ho))) {
@@ -126,11 +122,11 @@ void ofxHEMeshCornerCutSubdivision::createHalfedgeFaces() {
 			ofxHEMeshFace fo = hemesh.halfedgeFace(ho);
 			ofxHEMeshVertex v = hemesh.halfedgeVertex(h);
 			ofxHEMeshVertex vo = hemesh.halfedgeVertex(ho);
-			face[0] = cornerVertices[fo][vo];
-			face[1] = cornerVertices[fo][v];
-			face[2] = cornerVertices[f][v];
-			face[3] = cornerVertices[f][vo];
-			faces.push_back(face);
+			faceVertices.push_back(cornerVertices[fo][vo]);
+			faceVertices.push_back(cornerVertices[fo][v]);
+			faceVertices.push_back(cornerVertices[f][v]);
+			faceVertices.push_back(cornerVertices[f][vo]);
+			faceOffsets.push_back(faceVertices.size());
 		}
 	}
 }
@@ -138,36 +134,16 @@ void ofxHEMeshCornerCutSubdivision::createHalfedgeFaces() {
 void ofxHEMeshCornerCutSubdivision::createNewVertices() {
 	hemesh.clearVertices();
 	
-	ofxHEMeshFaceIterator fit = hemesh.facesBegin();
-	ofxHEMeshFaceIterator fite = hemesh.facesEnd();
-	int i = 0;
-	for(; fit != fite; ++fit) {
-		ofxHEMeshFaceCirculator fc = hemesh.faceCirculate(*fit);
-		ofxHEMeshFaceCirculator fce = fc;
-		bool nextBoundary = false;
-		bool boundary = hemesh.halfedgeIsOnBoundary(hemesh.halfedgeOpposite(*fc));
-		do {
-			ofxHEMeshHalfedge hnext = hemesh.halfedgeNext(*fc);
-			nextBoundary = hemesh.halfedgeIsOnBoundary(hemesh.halfedgeOpposite(hnext));
-			if(boundary && nextBoundary) {
-				hemesh.addVertex(cornerPoints[i]);
-				++i;
-				hemesh.addVertex(cornerPoints[i]);
-			}
-			else {
-				hemesh.addVertex(cornerPoints[i]);
-			}
-			boundary = nextBoundary;
-			++i;
-			++fc;
-		} while(fc != fce);
+	// cornerPoints was filled in the same order the new vertices were numbered
+	if(!cornerPoints.empty()) {
+		hemesh.addVertices(&cornerPoints[0], cornerPoints.size());
 	}
 }
 
 void ofxHEMeshCornerCutSubdivision::createNewFaces() {
 	hemesh.clearHalfedges();
 	hemesh.clearFaces();
-	hemesh.addFaces(faces);
+	hemesh.addFaces(faceOffsets, faceVertices);
 }
 
 
@@ -211,7 +187,7 @@ void ofxHEMeshFacePeel::apply() {
 
 void ofxHEMeshFacePeel::subdivide() {
 	processFaces();
-	numFaces = faces.size();
+	numFaces = faceOffsets.size()-1;
 	
 	createVertexFaces();
 	createHalfedgeFaces();
@@ -227,7 +203,8 @@ void ofxHEMeshFacePeel::createCrust() {
 	// add to existing hemesh
 	// track corresponding face faces
 
-	innerHemesh = hemesh;
+	// local so the copy is freed once the crust has been added
+	ofxHEMesh innerHemesh(hemesh);
 	
 	// can assume there are no holes in the faceProperties arrays
 	// since the subdivide() operation creates consecutive faces
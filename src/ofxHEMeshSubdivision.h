@@ -25,7 +25,9 @@ protected:
 
 
 	ofxHEMesh& hemesh;
-	vector<ofxHEMesh::ExplicitFace> faces;
+	// Flattened face list (see ofxHEMesh::addFaces)
+	vector<int> faceOffsets;
+	vector<ofxHEMeshVertex> faceVertices;
 	CornerMap cornerVertices;
 	vector<ofxHEMesh::Point> cornerPoints;
 	set<ofxHEMeshVertex> boundaryVertices;
@@ -64,6 +66,5 @@ protected:
 	void subdivide();
 	void createCrust();
 
-	ofxHEMesh innerHemesh;
 	int numFaces;
 };
\ No newline at end of file
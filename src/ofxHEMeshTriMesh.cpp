@@ -0,0 +1,244 @@
+#include "ofxHEMeshTriMesh.h"
+#include "ofxHEMeshEdgeHash.h"
+#include "ofxHEMeshParallel.h"
+#include <sstream>
+
+// Face halfedge sorted by its undirected edge
+struct ofxHEMeshTriMeshEdgeKey {
+	uint64_t key;
+	int h;
+};
+
+static bool edgeKeyLess(const ofxHEMeshTriMeshEdgeKey& a, const ofxHEMeshTriMeshEdgeKey& b) {
+	return a.key < b.key || (a.key == b.key && a.h < b.h);
+}
+
+ofxHEMeshTriMesh::ofxHEMeshTriMesh(const ofxHEMesh& hemesh)
+:	nfaceHalfedges(0)
+{
+	build(hemesh);
+}
+
+void ofxHEMeshTriMesh::clear() {
+	points.clear();
+	vertexHalfedges.clear();
+	opposites.clear();
+	vertices.clear();
+	boundaryNext.clear();
+	boundaryPrev.clear();
+	nfaceHalfedges = 0;
+}
+
+void ofxHEMeshTriMesh::build(const vector<Point>& pts, const vector<int>& triangles) {
+	int nvertices = int(pts.size());
+	int nfaces = int(triangles.size())/3;
+	for(int i=0; i < nfaces*3; ++i) {
+		if(triangles[i] < 0 || triangles[i] >= nvertices) {
+			throw std::invalid_argument("ofxHEMeshTriMesh::build(): vertex index out of range");
+		}
+	}
+
+	clear();
+	points = pts;
+	nfaceHalfedges = nfaces*3;
+	vertices.resize(nfaceHalfedges);
+	opposites.resize(nfaceHalfedges);
+
+	// halfedge 3f+k runs from corner k to corner k+1 of triangle f
+	vector<ofxHEMeshTriMeshEdgeKey> keys(nfaceHalfedges);
+	hemesh::parallelFor(0, nfaces, [&](int b, int e) {
+		for(int f=b; f < e; ++f) {
+			for(int k=0; k < 3; ++k) {
+				int h = f*3+k;
+				vertices[h] = triangles[f*3 + (k+1)%3];
+				keys[h].key = ofxHEMeshEdgeHash::key(triangles[h], vertices[h]);
+				keys[h].h = h;
+			}
+		}
+	});
+	hemesh::parallelSort(keys, edgeKeyLess);
+
+	// pair up halfedges sharing an edge, the unpaired ones get boundary opposites
+	vector<int> boundaryOut(nvertices, -1);
+	for(int i=0; i < nfaceHalfedges; ) {
+		int j = i+1;
+		while(j < nfaceHalfedges && keys[j].key == keys[i].key) ++j;
+		int h1 = keys[i].h;
+		if(j-i == 1) {
+			int b = int(vertices.size());
+			int source = triangles[h1];
+			vertices.push_back(source);
+			opposites.push_back(h1);
+			opposites[h1] = b;
+			boundaryOut[vertices[h1]] = b;
+		}
+		else if(j-i == 2) {
+			int h2 = keys[i+1].h;
+			if(vertices[h1] == vertices[h2]) {
+				std::stringstream ss;
+				ss << "ofxHEMeshTriMesh::build(): triangles " << h1/3 << " and " << h2/3 << " have opposite orientations";
+				throw std::invalid_argument(ss.str());
+			}
+			opposites[h1] = h2;
+			opposites[h2] = h1;
+		}
+		else {
+			std::stringstream ss;
+			ss << "ofxHEMeshTriMesh::build(): edge " << triangles[h1] << "-" << vertices[h1] << " is shared by " << (j-i) << " triangles";
+			throw std::invalid_argument(ss.str());
+		}
+		i = j;
+	}
+
+	// link boundary halfedges into loops
+	int nboundary = int(vertices.size()) - nfaceHalfedges;
+	boundaryNext.resize(nboundary);
+	boundaryPrev.resize(nboundary);
+	for(int i=0; i < nboundary; ++i) {
+		int b = nfaceHalfedges+i;
+		int next = boundaryOut[vertices[b]];
+		boundaryNext[i] = next;
+		boundaryPrev[next-nfaceHalfedges] = b;
+	}
+
+	// vertices link to an incoming halfedge, on the boundary if there is one
+	vertexHalfedges.assign(nvertices, -1);
+	for(int h=0; h < nfaceHalfedges; ++h) {
+		vertexHalfedges[vertices[h]] = h;
+	}
+	for(int i=0; i < nboundary; ++i) {
+		int b = nfaceHalfedges+i;
+		vertexHalfedges[vertices[b]] = b;
+	}
+}
+
+void ofxHEMeshTriMesh::build(const ofxHEMesh& hemesh) {
+	vector<Point> pts(hemesh.getNumLiveVertices());
+	ofxHEMeshVertexIterator vit = hemesh.verticesBegin();
+	ofxHEMeshVertexIterator vite = hemesh.verticesEnd();
+	for(; vit != vite; ++vit) {
+		pts[hemesh.vertexLiveIndex(*vit)] = hemesh.vertexPoint(*vit);
+	}
+
+	vector<int> triangles;
+	triangles.reserve(hemesh.getNumLiveFaces()*3);
+	ofxHEMeshFaceIterator fit = hemesh.facesBegin();
+	ofxHEMeshFaceIterator fite = hemesh.facesEnd();
+	for(; fit != fite; ++fit) {
+		if(hemesh.faceSize(*fit) != 3) {
+			throw std::invalid_argument("ofxHEMeshTriMesh::build(): mesh has faces that aren't triangles");
+		}
+		ofxHEMeshFaceCirculator fc = hemesh.faceCirculate(*fit);
+		ofxHEMeshFaceCirculator fce = fc;
+		do {
+			triangles.push_back(hemesh.vertexLiveIndex(hemesh.halfedgeSource(*fc)));
+			++fc;
+		} while(fc != fce);
+	}
+	build(pts, triangles);
+}
+
+void ofxHEMeshTriMesh::toHEMesh(ofxHEMesh& dst) const {
+	dst = ofxHEMesh();
+	if(!points.empty()) {
+		dst.addVertices(&points[0], points.size());
+	}
+
+	vector<ofxHEMeshVertex> faceVertices(nfaceHalfedges);
+	for(int h=0; h < nfaceHalfedges; ++h) {
+		faceVertices[h] = halfedgeSource(ofxHEMeshHalfedge(h));
+	}
+	dst.addFaces(faceVertices, 3);
+}
+
+ofxHEMeshHalfedge ofxHEMeshTriMesh::findHalfedge(ofxHEMeshVertex v1, ofxHEMeshVertex v2) const {
+	ofxHEMeshHalfedge h2 = vertexHalfedge(v2);
+	if(vertexHalfedge(v1).isValid() && h2.isValid()) {
+		ofxHEMeshHalfedge hStart = h2;
+		do {
+			if(halfedgeSource(h2) == v1) {
+				return h2;
+			}
+			h2 = halfedgeSinkCCW(h2);
+		} while(h2 != hStart);
+	}
+	return ofxHEMeshHalfedge();
+}
+
+int ofxHEMeshTriMesh::vertexValence(ofxHEMeshVertex v) const {
+	int n = 0;
+	ofxHEMeshTriMeshVertexCirculator vc = vertexCirculate(v);
+	ofxHEMeshTriMeshVertexCirculator vce = vc;
+	do {
+		++n;
+		++vc;
+	} while(vc != vce);
+	return n;
+}
+
+ofxHEMeshTriMesh::Scalar ofxHEMeshTriMesh::faceArea(ofxHEMeshFace f) const {
+	ofxHEMeshHalfedge h = faceHalfedge(f);
+	Direction n = halfedgeDirection(h).cross(halfedgeDirection(halfedgeNext(h)));
+	return 0.5*n.length();
+}
+
+ofxHEMeshTriMesh::Point ofxHEMeshTriMesh::faceCentroid(ofxHEMeshFace f) const {
+	int h = f.idx*3;
+	return (points[vertices[h]] + points[vertices[h+1]] + points[vertices[h+2]])*(1./3.);
+}
+
+ofxHEMeshTriMesh::Direction ofxHEMeshTriMesh::faceNormal(ofxHEMeshFace f) const {
+	ofxHEMeshHalfedge h = faceHalfedge(f);
+	Direction n = halfedgeDirection(h).cross(halfedgeDirection(halfedgeNext(h)));
+	n.normalize();
+	return n;
+}
+
+ofxHEMeshTriMesh::Scalar ofxHEMeshTriMesh::angleAtVertex(ofxHEMeshHalfedge h) const {
+	Direction v1 = -halfedgeDirection(h);
+	Direction v2 = halfedgeDirection(halfedgeNext(h));
+	v1.normalize();
+	v2.normalize();
+	Scalar dot = MAX(MIN(1, v1.dot(v2)), -1);
+	return acos(dot);
+}
+
+ofxHEMeshTriMesh::Scalar ofxHEMeshTriMesh::halfedgeCotan(ofxHEMeshHalfedge h) const {
+	ofxHEMeshHalfedge h2 = halfedgeNext(h);
+	ofxHEMeshHalfedge h3 = halfedgeNext(h2);
+	Point p0 = vertexPoint(halfedgeVertex(h2));
+	Point p1 = vertexPoint(halfedgeVertex(h3));
+	Point p2 = vertexPoint(halfedgeVertex(h));
+	Direction u = p1-p0;
+	Direction v = p2-p0;
+	return u.dot(v)/u.cross(v).length();
+}
+
+ofxHEMeshTriMesh::Direction ofxHEMeshTriMesh::angleWeightedVertexNormal(ofxHEMeshVertex v) const {
+	ofxHEMeshTriMeshVertexCirculator vc = vertexCirculate(v);
+	ofxHEMeshTriMeshVertexCirculator vce = vc;
+	Direction n(0, 0, 0);
+	do {
+		ofxHEMeshFace f = halfedgeFace(*vc);
+		if(f.isValid()) {
+			n += faceNormal(f)*angleAtVertex(*vc);
+		}
+		++vc;
+	} while(vc != vce);
+	n.normalize();
+	return n;
+}
+
+ofxHEMeshTriMesh::Scalar ofxHEMeshTriMesh::vertexArea(ofxHEMeshVertex v) const {
+	Scalar A = 0;
+	ofxHEMeshTriMeshVertexCirculator vc = vertexCirculate(v);
+	ofxHEMeshTriMeshVertexCirculator vce = vc;
+	do {
+		ofxHEMeshFace f = halfedgeFace(*vc);
+		if(f.isValid()) {
+			A += faceArea(f);
+		}
+		++vc;
+	} while(vc != vce);
+	return A*0.333333333333333;
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include "ofxHEMesh.h"
+
+class ofxHEMeshTriMesh;
+
+struct ofxHEMeshTriMeshVertexCirculator {
+	ofxHEMeshTriMeshVertexCirculator(const ofxHEMeshTriMesh* mesh, ofxHEMeshHalfedge h)
+	:	mesh(mesh), h(h)
+	{}
+
+	bool operator==(const ofxHEMeshTriMeshVertexCirculator& right) const { return h == right.h; }
+	bool operator!=(const ofxHEMeshTriMeshVertexCirculator& right) const { return !(h == right.h); }
+
+	ofxHEMeshHalfedge& operator*() { return h; }
+	ofxHEMeshHalfedge* operator->() { return &h; }
+
+	inline ofxHEMeshTriMeshVertexCirculator& operator++();
+	inline ofxHEMeshTriMeshVertexCirculator& operator--();
+
+	const ofxHEMeshTriMesh* mesh;
+	ofxHEMeshHalfedge h;
+};
+
+struct ofxHEMeshTriMeshFaceCirculator {
+	ofxHEMeshTriMeshFaceCirculator(const ofxHEMeshTriMesh* mesh, ofxHEMeshHalfedge h)
+	:	mesh(mesh), h(h)
+	{}
+
+	bool operator==(const ofxHEMeshTriMeshFaceCirculator& right) const { return h == right.h; }
+	bool operator!=(const ofxHEMeshTriMeshFaceCirculator& right) const { return !(h == right.h); }
+
+	ofxHEMeshHalfedge& operator*() { return h; }
+	ofxHEMeshHalfedge* operator->() { return &h; }
+
+	inline ofxHEMeshTriMeshFaceCirculator& operator++();
+	inline ofxHEMeshTriMeshFaceCirculator& operator--();
+
+	const ofxHEMeshTriMesh* mesh;
+	ofxHEMeshHalfedge h;
+};
+
+
+/*
+Triangle-only mesh with implicit connectivity.  The halfedges of face f are 3f,
+3f+1 and 3f+2 in order around the face, so next, prev, face and faceHalfedge are
+computed rather than stored; each halfedge only stores its opposite and its sink
+vertex.  Boundary halfedges (which have no face) are numbered after the face
+halfedges and are the only ones with explicit next/prev links, so boundary loops
+and circulators behave as they do in ofxHEMesh.
+
+The query functions mirror ofxHEMesh's so algorithms can be written against
+either.  Connectivity is fixed once built, only vertex positions can change.
+Elements are numbered densely: building from an ofxHEMesh numbers vertices by
+vertexLiveIndex() and faces in iteration order.
+*/
+class ofxHEMeshTriMesh {
+public:
+	typedef ofxHEMesh::Scalar Scalar;
+	typedef ofxHEMesh::Point Point;
+	typedef ofxHEMesh::Direction Direction;
+
+	ofxHEMeshTriMesh() : nfaceHalfedges(0) {}
+	// Throws std::invalid_argument if hemesh has faces that aren't triangles
+	explicit ofxHEMeshTriMesh(const ofxHEMesh& hemesh);
+
+	void clear();
+	// Build from vertex positions and three vertex indices per triangle.  Throws
+	// std::invalid_argument for bad indices, edges shared by more than two
+	// triangles or neighbouring triangles with opposite orientations.
+	void build(const vector<Point>& points, const vector<int>& triangles);
+	void build(const ofxHEMesh& hemesh);
+	// Replace dst's contents with this mesh
+	void toHEMesh(ofxHEMesh& dst) const;
+
+	int getNumVertices() const { return int(points.size()); }
+	int getNumEdges() const { return int(opposites.size())/2; }
+	int getNumHalfedges() const { return int(opposites.size()); }
+	int getNumFaces() const { return nfaceHalfedges/3; }
+	int getNumBoundaryHalfedges() const { return int(opposites.size()) - nfaceHalfedges; }
+
+	ofxHEMeshTriMeshFaceCirculator faceCirculate(const ofxHEMeshFace& f) const {
+		return ofxHEMeshTriMeshFaceCirculator(this, faceHalfedge(f));
+	}
+	ofxHEMeshTriMeshVertexCirculator vertexCirculate(const ofxHEMeshVertex& v) const {
+		return ofxHEMeshTriMeshVertexCirculator(this, vertexHalfedge(v));
+	}
+
+	// Connectivity
+	ofxHEMeshHalfedge vertexHalfedge(ofxHEMeshVertex v) const { return ofxHEMeshHalfedge(vertexHalfedges[v.idx]); }
+	ofxHEMeshHalfedge faceHalfedge(ofxHEMeshFace f) const { return ofxHEMeshHalfedge(f.idx*3); }
+	ofxHEMeshHalfedge halfedgeOpposite(ofxHEMeshHalfedge h) const { return ofxHEMeshHalfedge(opposites[h.idx]); }
+	ofxHEMeshVertex halfedgeVertex(ofxHEMeshHalfedge h) const { return ofxHEMeshVertex(vertices[h.idx]); }
+	ofxHEMeshFace halfedgeFace(ofxHEMeshHalfedge h) const {
+		return h.idx < nfaceHalfedges ? ofxHEMeshFace(h.idx/3) : ofxHEMeshFace();
+	}
+	ofxHEMeshVertex halfedgeSource(ofxHEMeshHalfedge h) const { return halfedgeVertex(halfedgeOpposite(h)); }
+	ofxHEMeshVertex halfedgeSink(ofxHEMeshHalfedge h) const { return halfedgeVertex(h); }
+	ofxHEMeshHalfedge halfedgeNext(ofxHEMeshHalfedge h) const {
+		if(h.idx >= nfaceHalfedges) return ofxHEMeshHalfedge(boundaryNext[h.idx-nfaceHalfedges]);
+		return ofxHEMeshHalfedge(h.idx%3 == 2 ? h.idx-2 : h.idx+1);
+	}
+	ofxHEMeshHalfedge halfedgePrev(ofxHEMeshHalfedge h) const {
+		if(h.idx >= nfaceHalfedges) return ofxHEMeshHalfedge(boundaryPrev[h.idx-nfaceHalfedges]);
+		return ofxHEMeshHalfedge(h.idx%3 == 0 ? h.idx+2 : h.idx-1);
+	}
+	ofxHEMeshHalfedge halfedgeSourceCW(ofxHEMeshHalfedge h) const { return halfedgeNext(halfedgeOpposite(h)); }
+	ofxHEMeshHalfedge halfedgeSourceCCW(ofxHEMeshHalfedge h) const { return halfedgeOpposite(halfedgePrev(h)); }
+	ofxHEMeshHalfedge halfedgeSinkCW(ofxHEMeshHalfedge h) const { return halfedgeOpposite(halfedgeNext(h)); }
+	ofxHEMeshHalfedge halfedgeSinkCCW(ofxHEMeshHalfedge h) const { return halfedgePrev(halfedgeOpposite(h)); }
+	ofxHEMeshHalfedge findHalfedge(ofxHEMeshVertex v1, ofxHEMeshVertex v2) const;
+	bool halfedgeIsOnBoundary(ofxHEMeshHalfedge h) const { return h.idx >= nfaceHalfedges; }
+	// Boundary vertices link to their incoming boundary halfedge
+	bool vertexIsOnBoundary(ofxHEMeshVertex v) const { return halfedgeIsOnBoundary(vertexHalfedge(v)); }
+	int vertexValence(ofxHEMeshVertex v) const;
+	int faceSize(ofxHEMeshFace f) const { return 3; }
+
+	// Geometry
+	Point vertexPoint(ofxHEMeshVertex v) const { return points[v.idx]; }
+	void vertexMoveTo(ofxHEMeshVertex v, const Point& p) { points[v.idx] = p; }
+	const vector<Point>& getPoints() const { return points; }
+	Direction halfedgeDirection(ofxHEMeshHalfedge h) const {
+		return vertexPoint(halfedgeSink(h)) - vertexPoint(halfedgeSource(h));
+	}
+	Scalar halfedgeLength(ofxHEMeshHalfedge h) const { return halfedgeDirection(h).length(); }
+	Scalar faceArea(ofxHEMeshFace f) const;
+	Point faceCentroid(ofxHEMeshFace f) const;
+	Direction faceNormal(ofxHEMeshFace f) const;
+	Scalar angleAtVertex(ofxHEMeshHalfedge h) const;
+	Scalar halfedgeCotan(ofxHEMeshHalfedge h) const;
+	Direction angleWeightedVertexNormal(ofxHEMeshVertex v) const;
+	Scalar vertexArea(ofxHEMeshVertex v) const;
+
+protected:
+	vector<Point> points;
+	vector<int> vertexHalfedges;
+	// Per halfedge
+	vector<int> opposites;
+	vector<int> vertices;
+	// Per boundary halfedge, indexed from nfaceHalfedges
+	vector<int> boundaryNext;
+	vector<int> boundaryPrev;
+	int nfaceHalfedges;
+};
+
+
+ofxHEMeshTriMeshVertexCirculator& ofxHEMeshTriMeshVertexCirculator::operator++() {
+	h = mesh->halfedgeSinkCCW(h);
+	return *this;
+}
+
+ofxHEMeshTriMeshVertexCirculator& ofxHEMeshTriMeshVertexCirculator::operator--() {
+	h = mesh->halfedgeSinkCW(h);
+	return *this;
+}
+
+ofxHEMeshTriMeshFaceCirculator& ofxHEMeshTriMeshFaceCirculator::operator++() {
+	h = mesh->halfedgeNext(h);
+	return *this;
+}
+
+ofxHEMeshTriMeshFaceCirculator& ofxHEMeshTriMeshFaceCirculator::operator--() {
+	h = mesh->halfedgePrev(h);
+	return *this;
+}
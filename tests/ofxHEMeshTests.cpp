@@ -0,0 +1,151 @@
+#include "ofxHEMesh.h"
+#include "ofxHEMeshLimit.h"
+#include "ofxHEMeshRefinement.h"
+#include "ofxHEMeshStencilTable.h"
+#include <cstdio>
+#include <cstring>
+
+/*
+Regression tests for the core library, run through ctest.  Each test is a
+function registered in Tests below and is run by name:
+
+	ofxHEMeshTests <test>
+*/
+
+#ifndef OFX_HEMESH_TEST_DATA
+#define OFX_HEMESH_TEST_DATA "hemeshExample/bin/data"
+#endif
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if(!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			++failures; \
+		} \
+	} while(0)
+
+static string dataPath(const string& name) {
+	return string(OFX_HEMESH_TEST_DATA) + "/" + name;
+}
+
+static const char *BoundaryModels[] = {"cube.boundary.obj", "tetra.boundary.obj"};
+
+
+// Boundary halfedges have no face, which must not be looked up
+static void boundaryConnectivity() {
+	for(int i=0; i < 2; ++i) {
+		ofxHEMesh hemesh;
+		CHECK(hemesh.loadOBJModel(dataPath(BoundaryModels[i])));
+		CHECK(hemesh.verifyConnectivity());
+
+		// vertex 0 of both models lies on the boundary
+		int nfaces = hemesh.getNumLiveFaces();
+		hemesh.removeVertex(ofxHEMeshVertex(0));
+		CHECK(hemesh.getNumLiveFaces() < nfaces);
+		CHECK(hemesh.verifyConnectivity());
+	}
+}
+
+// Moves hand the property blocks over without copying or reallocating them
+static void moveKeepsBlocks() {
+	ofxHEMesh a;
+	CHECK(a.loadOBJModel(dataPath("sphere.obj")));
+	ofxHEMeshProperty<float> *weights = a.addVertexProperty<float>("weights", 1.f);
+	const ofxHEMeshPropertyBase& points = *a.addVertexProperty<ofxHEMesh::Point>("points");
+	int nvertices = a.getNumVertices();
+	int nblocks = points.numBlocks();
+	const void *first = points.rawBlock(0);
+	const void *weightsFirst = static_cast<const ofxHEMeshPropertyBase *>(weights)->rawBlock(0);
+	CHECK(nblocks > 0);
+
+	ofxHEMesh b(std::move(a));
+	const ofxHEMeshPropertyBase& bpoints = *b.addVertexProperty<ofxHEMesh::Point>("points");
+	CHECK(b.getNumVertices() == nvertices);
+	CHECK(bpoints.numBlocks() == nblocks);
+	CHECK(bpoints.rawBlock(0) == first);
+	CHECK(a.getNumVertices() == 0);
+	// a keeps its property objects, emptied
+	CHECK(weights->size() == 0);
+
+	ofxHEMesh c;
+	ofxHEMeshProperty<float> *cweights = c.addVertexProperty<float>("weights", 0.f);
+	c = std::move(b);
+	const ofxHEMeshPropertyBase& cpoints = *c.addVertexProperty<ofxHEMesh::Point>("points");
+	CHECK(c.getNumVertices() == nvertices);
+	CHECK(cpoints.numBlocks() == nblocks);
+	CHECK(cpoints.rawBlock(0) == first);
+	CHECK(static_cast<const ofxHEMeshPropertyBase *>(cweights)->rawBlock(0) == weightsFirst);
+	CHECK(cweights->size() == nvertices && cweights->get(0) == 1.f);
+	CHECK(b.getNumVertices() == 0);
+	CHECK(c.verifyConnectivity());
+}
+
+// Vertex 7 of cube.boundary.obj is in no face, so its limit is the vertex itself
+static void limitIsolatedVertices() {
+	ofxHEMesh hemesh;
+	CHECK(hemesh.loadOBJModel(dataPath("cube.boundary.obj")));
+	ofxHEMeshVertex v(7);
+	CHECK(!hemesh.vertexHalfedge(v).isValid());
+
+	ofxHEMeshLimit limit(hemesh);
+	limit.update();
+	CHECK(limit.limitPoint(v) == ofxHEMesh::Point(-1, -1, 1));
+	CHECK(limit.limitNormal(v) == ofxHEMesh::Direction(0, 0, 0));
+}
+
+// Evaluating the stencils after moving the cage matches refining the moved
+// cage, including cube.boundary.obj's vertex 7, which is in no face
+static void stencilsFollowCage() {
+	ofxHEMesh cage;
+	CHECK(cage.loadOBJModel(dataPath("cube.boundary.obj")));
+	ofxHEMesh refined(cage);
+	ofxHEMeshCatmullClarkRefinement refinement(refined);
+	ofxHEMeshStencilTable table;
+	table.build(refinement, 2);
+
+	for(int i=0; i < cage.getNumVertices(); ++i) {
+		ofxHEMeshVertex v(i);
+		cage.vertexMoveTo(v, cage.vertexPoint(v)*1.5 + ofxHEMesh::Point(0.25, -0.5, 1));
+	}
+	table.evaluate(cage, refined);
+
+	ofxHEMesh expected(cage);
+	ofxHEMeshCatmullClarkRefinement expectedRefinement(expected);
+	expectedRefinement.apply(2);
+	CHECK(refined.getNumVertices() == expected.getNumVertices());
+	for(int i=0; i < std::min(refined.getNumVertices(), expected.getNumVertices()); ++i) {
+		ofxHEMeshVertex v(i);
+		CHECK(refined.vertexPoint(v).distance(expected.vertexPoint(v)) < 1e-4);
+	}
+	CHECK(refined.vertexPoint(ofxHEMeshVertex(7)) == cage.vertexPoint(ofxHEMeshVertex(7)));
+}
+
+
+struct Test {
+	const char *name;
+	void (*fn)();
+};
+
+static const Test Tests[] = {
+	{"boundaryConnectivity", boundaryConnectivity},
+	{"moveKeepsBlocks", moveKeepsBlocks},
+	{"limitIsolatedVertices", limitIsolatedVertices},
+	{"stencilsFollowCage", stencilsFollowCage},
+};
+
+int main(int argc, char *argv[]) {
+	int ntests = int(sizeof(Tests)/sizeof(Tests[0]));
+	for(int i=0; i < ntests; ++i) {
+		if(argc < 2 || strcmp(argv[1], Tests[i].name) == 0) {
+			Tests[i].fn();
+			if(argc >= 2) return failures > 0;
+		}
+	}
+	if(argc >= 2) {
+		printf("no test named %s\n", argv[1]);
+		return 1;
+	}
+	return failures > 0;
+}